@@ -0,0 +1,20 @@
+from heapq import heappop, heappush
+from random import randrange
+from timeit import timeit
+
+timers = []
+cancelled = set()
+
+def test():
+    for i in range(10):
+        ids = []
+
+        for j in range(50000):
+            t = (randrange(60000) + 1, i*50000 + j, lambda: None)
+            heappush(timers, t)
+            ids.append(t[1])
+
+        for id in ids:
+            cancelled.add(id)
+
+print(int(timeit(test, number=1) * 1000))
@@ -0,0 +1,31 @@
+from socket import socket, SOL_SOCKET, SO_REUSEADDR, SO_REUSEPORT
+from timeit import timeit
+
+server = socket()
+server.setsockopt(SOL_SOCKET, SO_REUSEADDR, 1)
+server.setsockopt(SOL_SOCKET, SO_REUSEPORT, 1)
+server.bind(('127.0.0.1', 7090))
+server.listen(1000)
+server.setblocking(False)
+
+def test():
+    for i in range(100):
+        cs = []
+        
+        for j in range(500):
+            c = socket()
+            c.setblocking(False)
+            c.connect_ex(('127.0.0.1', 7090))
+            cs.append(c)
+
+        while True:
+            try:
+                a, _ = server.accept()
+                a.close()
+            except BlockingIOError:
+                break
+
+        for c in cs:
+            c.close()
+
+print(int(timeit(test, number=1) * 1000))
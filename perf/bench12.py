@@ -0,0 +1,23 @@
+from socket import socket
+from timeit import timeit
+
+server = socket()
+server.bind(('127.0.0.1', 7100))
+server.listen(1)
+c = socket()
+c.connect(('127.0.0.1', 7100))
+a, _ = server.accept()
+c.setblocking(False)
+
+def test():
+    for i in range(1000):
+        for j in range(100):
+            a.send(b'message')
+
+        while True:
+            try:
+                c.recv(65536)
+            except BlockingIOError:
+                break
+
+print(int(timeit(test, number=1) * 1000))
@@ -0,0 +1,9 @@
+from sys import argv
+from timeit import timeit
+
+def test():
+    with open(argv[1]) as f:
+        for l in f:
+            pass
+
+print(int(timeit(test, number=1) * 1000))
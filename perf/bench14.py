@@ -0,0 +1,16 @@
+from sys import argv
+from timeit import timeit
+
+def words():
+    with open(argv[1]) as f:
+        for l in f:
+            for w in l.split():
+                pass
+
+def blocks():
+    with open(argv[1], 'rb') as f:
+        while f.read(65536):
+            pass
+
+print(int(timeit(words, number=1) * 1000))
+print(int(timeit(blocks, number=1) * 1000))
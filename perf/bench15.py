@@ -0,0 +1,40 @@
+import json, pickle
+from timeit import timeit
+
+n = 1000000
+e = {'msg': 'lorem ipsum dolor sit amet', 'lvl': 'info'}
+
+def write_text():
+    with open('/tmp/bench15.txt', 'w') as f:
+        for i in range(n):
+            e['id'] = i
+            f.write(json.dumps(e))
+            f.write('\n')
+
+def read_text():
+    with open('/tmp/bench15.txt') as f:
+        for l in f:
+            json.loads(l)
+
+def write_bin():
+    with open('/tmp/bench15.bin', 'wb') as f:
+        p = pickle.Pickler(f)
+        
+        for i in range(n):
+            e['id'] = i
+            p.dump(e)
+
+def read_bin():
+    with open('/tmp/bench15.bin', 'rb') as f:
+        u = pickle.Unpickler(f)
+
+        try:
+            while True:
+                u.load()
+        except EOFError:
+            pass
+
+print(int(timeit(write_text, number=1) * 1000))
+print(int(timeit(read_text, number=1) * 1000))
+print(int(timeit(write_bin, number=1) * 1000))
+print(int(timeit(read_bin, number=1) * 1000))
@@ -0,0 +1,30 @@
+import os, pickle
+from timeit import timeit
+
+n = 300000
+e = {'msg': 'lorem ipsum dolor sit amet', 'lvl': 'info'}
+
+def write_log():
+    with open('/tmp/bench16.bin', 'wb') as f:
+        p = pickle.Pickler(f)
+        
+        for i in range(n):
+            e['id'] = i
+            p.dump(('upsert', e))
+            f.flush()
+            
+def load_log():
+    t = {}
+    
+    with open('/tmp/bench16.bin', 'rb') as f:
+        u = pickle.Unpickler(f)
+
+        try:
+            while True:
+                op, r = u.load()
+                t[r['id']] = r
+        except EOFError:
+            pass
+
+print(int(timeit(write_log, number=1) * 1000))
+print(int(timeit(load_log, number=1) * 1000))
@@ -0,0 +1,24 @@
+from bisect import bisect_left
+from timeit import timeit
+
+n = 100000
+t = {i: {'id': i, 'grp': i % 1000} for i in range(n)}
+
+def scan():
+    for g in range(100):
+        for r in t.values():
+            if r['grp'] == g:
+                pass
+
+idx = sorted((r['grp'], r['id']) for r in t.values())
+
+def find():
+    for g in range(100):
+        i = bisect_left(idx, (g,))
+
+        while i < len(idx) and idx[i][0] == g:
+            t[idx[i][1]]
+            i += 1
+
+print(int(timeit(scan, number=1) * 1000))
+print(int(timeit(find, number=1) * 1000))
@@ -0,0 +1,25 @@
+from multiprocessing import Pool
+from timeit import timeit
+
+n = 4
+
+def _fib(a, b, n):
+    return _fib(b, a+b, n-1) if n > 0 else a
+
+def fib(n):
+    return _fib(0, 1, n)
+
+def work(_):
+    for i in range(10000):
+        fib(50)
+
+def serial():
+    for i in range(n):
+        work(i)
+
+def parallel():
+    with Pool(n) as p:
+        p.map(work, range(n))
+
+print(int(timeit(serial, number=1) * 1000))
+print(int(timeit(parallel, number=1) * 1000))
@@ -0,0 +1,34 @@
+from threading import Thread
+from queue import Queue
+from timeit import timeit
+
+n = 120000
+
+def produce(q, n):
+    for i in range(n):
+        q.put(i)
+
+def throughput(m):
+    q = Queue(1024)
+    ts = [Thread(target=produce, args=(q, n // m)) for _ in range(m)]
+    for t in ts: t.start()
+    for _ in range(n): q.get()
+    for t in ts: t.join()
+
+def echo(i, o):
+    for _ in range(10000):
+        o.put(i.get())
+
+def latency():
+    i, o = Queue(1), Queue(1)
+    t = Thread(target=echo, args=(i, o))
+    t.start()
+    for _ in range(10000):
+        i.put(42)
+        o.get()
+    t.join()
+
+for m in [1, 2, 4]:
+    print(int(timeit(lambda: throughput(m), number=1) * 1000))
+
+print(int(timeit(latency, number=1) * 1000))
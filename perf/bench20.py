@@ -0,0 +1,27 @@
+from multiprocessing import Pool
+from timeit import timeit
+
+n = 64
+
+def _fib(a, b, n):
+    return _fib(b, a+b, n-1) if n > 0 else a
+
+def fib(n):
+    return _fib(0, 1, n)
+
+def work(_):
+    for i in range(1000):
+        fib(50)
+    return 42
+
+def serial():
+    list(map(work, range(n)))
+
+def parallel(m):
+    with Pool(m) as p:
+        p.map(work, range(n))
+
+print(int(timeit(serial, number=1) * 1000))
+
+for m in [1, 2, 4, 8]:
+    print(int(timeit(lambda: parallel(m), number=1) * 1000))
@@ -0,0 +1,19 @@
+import asyncio
+from timeit import timeit
+
+n = 100000
+
+async def nop():
+    pass
+
+async def spawn():
+    for _ in range(n):
+        asyncio.get_running_loop().create_task(nop())
+    await asyncio.sleep(0)
+
+async def switch():
+    for _ in range(n):
+        await asyncio.sleep(0)
+
+print(int(timeit(lambda: asyncio.run(spawn()), number=1) * 1000))
+print(int(timeit(lambda: asyncio.run(switch()), number=1) * 1000))
@@ -0,0 +1,12 @@
+from timeit import timeit
+
+s = ' '.join(['Lorem Ipsum Dolor Sit Amet'] * 100000)
+
+def test():
+    global s
+    
+    for i in range(1000):
+        s = s.upper()
+        s = s.lower()
+
+print(int(timeit(test, number=1) * 1000))
@@ -0,0 +1,12 @@
+from timeit import timeit
+import re
+
+s = '\n'.join(['Lorem ipsum, dolor sit amet'] * 100000)
+ws = re.compile('[a-zA-Z]+')
+
+def test():
+    for i in range(10):
+        for l in s.splitlines(): pass
+        for w in ws.finditer(s): pass
+
+print(int(timeit(test, number=1) * 1000))
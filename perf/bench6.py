@@ -0,0 +1,9 @@
+from timeit import timeit
+
+s = ' '.join(['Lorem ipsum dolor sit amet'] * 100000)
+
+def test():
+    for i in range(1000):
+        s.find('consectetur')
+
+print(int(timeit(test, number=1) * 1000))
@@ -0,0 +1,11 @@
+from base64 import b64encode
+from timeit import timeit
+
+s = ' '.join(['Lorem ipsum dolor sit amet'] * 100000).encode()
+
+def test():
+    for i in range(100):
+        s.hex()
+        b64encode(s)
+
+print(int(timeit(test, number=1) * 1000))
@@ -0,0 +1,23 @@
+from selectors import DefaultSelector, EVENT_READ
+from socket import socket
+from timeit import timeit
+
+sel = DefaultSelector()
+server = socket()
+server.bind(('127.0.0.1', 7070))
+server.listen(1000)
+fs = []
+
+for i in range(5000):
+    c = socket()
+    c.connect(('127.0.0.1', 7070))
+    a, _ = server.accept()
+    fs += [c, a]
+    sel.register(c, EVENT_READ)
+    sel.register(a, EVENT_READ)
+
+def test():
+    for i in range(10000):
+        sel.select(0)
+
+print(int(timeit(test, number=1) * 1000))
@@ -0,0 +1,34 @@
+from selectors import DefaultSelector, EVENT_READ, EVENT_WRITE
+from socket import socket
+from timeit import timeit
+
+server = socket()
+server.bind(('127.0.0.1', 7080))
+server.listen(1000)
+ps = []
+
+for i in range(100):
+    c = socket()
+    c.connect(('127.0.0.1', 7080))
+    a, _ = server.accept()
+    c.setblocking(False)
+    a.setblocking(False)
+    ps.append((c, a))
+
+sel = DefaultSelector()
+
+def test():
+    for i in range(1000):
+        for c, a in ps:
+            sel.register(c, EVENT_WRITE, lambda c=c: c.send(b'ping'))
+            sel.register(a, EVENT_READ, lambda a=a: a.recv(4))
+
+        n = 0
+        
+        while n < len(ps) * 2:
+            for k, _ in sel.select():
+                k.data()
+                sel.unregister(k.fileobj)
+                n += 1
+
+print(int(timeit(test, number=1) * 1000))
@@ -1,5 +1,6 @@
 #include "cixl/cx.h"
 #include "cixl/bin.h"
+#include "cixl/coro.h"
 #include "cixl/error.h"
 #include "cixl/func.h"
 #include "cixl/op.h"
@@ -115,6 +116,7 @@ void cx_init_ops(struct cx_bin *bin) {
 }
 
 bool cx_eval(struct cx_bin *bin, size_t start_pc, ssize_t stop_pc, struct cx *cx) {
+  if (cx->coro && !cx_coro_check(cx->coro)) { return false; }
   struct cx_bin *prev_bin = cx->bin;
   size_t prev_pc = cx->pc;
   cx->bin = bin;
@@ -155,17 +157,110 @@ static const void *get_func_id(const void *v) {
   return &(*f)->id;
 }
 
+struct emit_unit {
+  size_t start_pc, end_pc;
+};
+
+static bool get_unit(struct cx_op *op, struct emit_unit *out) {
+  if (op->type == CX_OFIMP()) {
+    out->start_pc = op->pc+1;
+    out->end_pc = out->start_pc+op->as_fimp.imp->nops;
+    return true;
+  }
+
+  if (op->type == CX_OLAMBDA()) {
+    out->start_pc = op->as_lambda.start_op;
+    out->end_pc = out->start_pc+op->as_lambda.nops;
+    return true;
+  }
+
+  return false;
+}
+
+static bool emit_unit(struct cx_bin *bin,
+		      struct emit_unit *u,
+		      size_t ui,
+		      size_t *owners,
+		      struct cx_set *labels,
+		      FILE *out,
+		      struct cx *cx) {
+  bool is_label(size_t pc) {
+    return pc == u->start_pc || pc == u->end_pc ||
+      (owners[pc] == ui && cx_set_get(labels, &pc));
+  }
+  
+  fprintf(out,
+	  "static bool unit%zd(struct cx *cx, ssize_t stop_pc) {\n"
+	  "  static void *op_labels[%zd] = {\n    ",
+	  u->start_pc, u->end_pc-u->start_pc+1);
+  
+  for (size_t pc = u->start_pc; pc <= u->end_pc; pc++) {
+    if (is_label(pc)) {
+      fprintf(out, "&&op%zd", pc);
+    } else {
+      fputs("NULL", out);
+    }
+    
+    if (pc < u->end_pc) { fputs(", ", out); }
+  }
+  
+  fprintf(out,
+	  "};\n\n"
+	  "  bool ok = false;\n"
+	  "  goto *op_labels[cx->pc-%zd];\n\n",
+	  u->start_pc);
+  
+  // Errors are only checked after ops that may leave them behind,
+  // and stops are always labels.
+  bool check = false;
+  
+  for (size_t pc = u->start_pc; pc < u->end_pc; pc++) {
+    if (owners[pc] != ui) { continue; }
+    struct cx_op *op = cx_vec_get(&bin->ops, pc);
+    cx->row = op->row; cx->col = op->col;
+    struct cx_tok *tok = cx_vec_get(&bin->toks, op->tok_idx);
+    bool label = is_label(pc);
+    if (label) { fprintf(out, "op%zd: ", pc); }
+    fprintf(out, "{ /* %s %s */\n", tok->type->id, op->type->id);
+    if (label || check) { fputs("if (cx->errors.count) { goto exit; }\n", out); }
+    
+    if (label) {
+      fprintf(out,
+	      "if (stop_pc == %zd) {\n"
+	      "  ok = true;\n"
+	      "  goto exit;\n"
+	      "}\n",
+	      pc);
+    }
+    
+    if (op->type->emit_pos) {
+      fprintf(out, "cx->row = %d; cx->col = %d;\n", cx->row, cx->col);
+    }
+
+    fputs("\n", out);
+    
+    if (op->type->emit && !cx_test(op->type->emit)(op, bin, out, cx)) {
+      return false;
+    }
+    
+    fputs("}\n\n", out);
+    check = op->type->emit_check;
+  }
+
+  fprintf(out,
+	  " op%zd:\n"
+	  "  ok = !cx->errors.count;\n"
+	  " exit:\n"
+	  "  return ok;\n"
+	  "}\n\n",
+	  u->end_pc);
+
+  return true;
+}
+
 bool cx_emit(struct cx_bin *bin, FILE *out, struct cx *cx) {
   cx_init_ops(bin);
 
-  fputs("bool eval(struct cx *cx) {\n"
-	"bool _eval(struct cx *cx, ssize_t stop_pc) {\n"
-        "  static bool init = true;\n"
-	"  ssize_t prev_stop_pc = cx->stop_pc;\n"
-	"  cx->stop_pc = stop_pc;\n"
-	"  bool ok = false;\n\n",
-	out);
-  
   struct cx_set labels, libs, types, funcs, fimps, syms;
   cx_set_init(&labels, sizeof(size_t), cx_cmp_size);  
   cx_set_init(&libs, sizeof(struct cx_lib *), cx_cmp_ptr);
@@ -203,149 +298,210 @@ bool cx_emit(struct cx_bin *bin, FILE *out, struct cx *cx) {
     if (ok) { *ok = (*f)->lib; }
   }
 
+  // Caches are per thread and reset for each cx, label tables are shared
+  fputs("static __thread bool init;\n", out);
+
   cx_do_set(&syms, struct cx_sym, s) {
-    fprintf(out, "  static struct cx_sym %s;\n", s->emit_id);
+    fprintf(out, "static __thread struct cx_sym %s;\n", s->emit_id);
+  }
+
+  cx_do_set(&libs, struct cx_lib *, l) {
+    fprintf(out, "static __thread struct cx_lib *%s_ptr;\n", (*l)->emit_id);
+  }
+
+  cx_do_set(&types, struct cx_type *, t) {
+    fprintf(out, "static __thread struct cx_type *%s_ptr;\n", (*t)->emit_id);
+  }
+
+  cx_do_set(&funcs, struct cx_func *, f) {
+    fprintf(out, "static __thread struct cx_func *%s_ptr;\n", (*f)->emit_id);
   }
 
-  if (syms.members.count) { fputc('\n', out); }
+  cx_do_set(&fimps, struct cx_fimp *, f) {
+    fprintf(out, "static __thread struct cx_fimp *%s_ptr;\n", (*f)->emit_id);
+  }
+
+  fputc('\n', out);
   
   cx_do_set(&libs, struct cx_lib *, l) {
     fprintf(out,
-	    "  struct cx_lib *%s() {\n"
-	    "    static struct cx_lib *l = NULL;\n"
-	    "    if (!l) { l = cx_test(cx_get_lib(cx, \"%s\", false)); }\n"
-	    "    return l;\n"
-	    "  }\n\n",
-	    (*l)->emit_id, (*l)->id.id);
+	    "static struct cx_lib *%s(struct cx *cx) {\n"
+	    "  if (!%s_ptr) {\n"
+	    "    %s_ptr = cx_test(cx_get_lib(cx, \"%s\", false));\n"
+	    "  }\n\n"
+	    "  return %s_ptr;\n"
+	    "}\n\n",
+	    (*l)->emit_id, (*l)->emit_id, (*l)->emit_id, (*l)->id.id,
+	    (*l)->emit_id);
   }
 
   cx_do_set(&types, struct cx_type *, t) {
     fprintf(out,
-	    "  struct cx_type *%s() {\n"
-	    "    static struct cx_type *t = NULL;\n"
-	    "    if (!t) { t = cx_test(cx_get_type(cx, \"%s\", false)); }\n"
-	    "    return t;\n"
-	    "  }\n\n",
-	    (*t)->emit_id, (*t)->id);
+	    "static struct cx_type *%s(struct cx *cx) {\n"
+	    "  if (!%s_ptr) {\n"
+	    "    %s_ptr = cx_test(cx_get_type(cx, \"%s\", false));\n"
+	    "  }\n\n"
+	    "  return %s_ptr;\n"
+	    "}\n\n",
+	    (*t)->emit_id, (*t)->emit_id, (*t)->emit_id, (*t)->id,
+	    (*t)->emit_id);
   }
 
   cx_do_set(&funcs, struct cx_func *, f) {
     fprintf(out,
-	    "  struct cx_func *%s() {\n"
-	    "    static struct cx_func *f = NULL;\n"
-	    "    if (!f) { f = cx_test(cx_get_func(cx, \"%s\", false)); }\n"
-	    "    return f;\n"
-	    "  }\n\n",
-	    (*f)->emit_id, (*f)->id);
+	    "static struct cx_func *%s(struct cx *cx) {\n"
+	    "  if (!%s_ptr) {\n"
+	    "    %s_ptr = cx_test(cx_get_func(cx, \"%s\", false));\n"
+	    "  }\n\n"
+	    "  return %s_ptr;\n"
+	    "}\n\n",
+	    (*f)->emit_id, (*f)->emit_id, (*f)->emit_id, (*f)->id,
+	    (*f)->emit_id);
   }
 
   cx_do_set(&fimps, struct cx_fimp *, f) {
     fprintf(out,
-	    "  struct cx_fimp *%s() {\n"
-	    "    static struct cx_fimp *f = NULL;\n"
-	    "    if (!f) { f = cx_test(cx_get_fimp(%s(), \"%s\", false)); }\n"
-	    "    return f;\n"
-	    "  }\n\n",
-	    (*f)->emit_id, (*f)->func->emit_id, (*f)->id);
+	    "static struct cx_fimp *%s(struct cx *cx) {\n"
+	    "  if (!%s_ptr) {\n"
+	    "    %s_ptr = cx_test(cx_get_fimp(%s(cx), \"%s\", false));\n"
+	    "  }\n\n"
+	    "  return %s_ptr;\n"
+	    "}\n\n",
+	    (*f)->emit_id, (*f)->emit_id, (*f)->emit_id, (*f)->func->emit_id,
+	    (*f)->id, (*f)->emit_id);
   }
 
-  fputs("\n"
-	"  if (init) {\n"
-	"    init = false;\n",
-	out);
+  struct cx_vec units;
+  cx_vec_init(&units, sizeof(struct emit_unit));
+  *(struct emit_unit *)cx_vec_push(&units) = (struct emit_unit){0, bin->ops.count};
 
-  cx_do_vec(&cx->inits, struct cx_str *, i) {
-    fprintf(out,
-	    "if (!cx_init_%s(cx)) { goto exit; }\n",
-	    (*i)->data);
+  for (struct cx_op *op = cx_vec_start(&bin->ops);
+       op != cx_vec_end(&bin->ops);
+       op++) {
+    struct emit_unit u;
+    if (get_unit(op, &u)) { *(struct emit_unit *)cx_vec_push(&units) = u; }
   }
+
+  // Units are nested in op order, so inner units overwrite their parents
+  size_t *owners = malloc(sizeof(size_t)*(bin->ops.count+1)), ui = 0;
+  owners[bin->ops.count] = 0;
   
-  fputc('\n', out);
+  cx_do_vec(&units, struct emit_unit, u) {
+    for (size_t pc = u->start_pc; pc < u->end_pc; pc++) { owners[pc] = ui; }
+    ui++;
+  }
 
-  cx_do_set(&syms, struct cx_sym, s) {
-    fprintf(out, "    %s = cx_sym(cx, \"%s\");\n", s->emit_id, s->id);
+  cx_do_vec(&units, struct emit_unit, u) {
+    fprintf(out,
+	    "static bool unit%zd(struct cx *cx, ssize_t stop_pc);\n",
+	    u->start_pc);
   }
 
   fputc('\n', out);
+  bool ok = true;
+  ui = 0;
   
-  for (struct cx_op *op = cx_vec_start(&bin->ops);
-       op != cx_vec_end(&bin->ops);
-       op++) {
-    if (op->type->emit_init) { op->type->emit_init(op, bin, out, cx); }
+  cx_do_vec(&units, struct emit_unit, u) {
+    if (!(ok = emit_unit(bin, u, ui++, owners, &labels, out, cx))) { break; }
   }
 
-  cx_set_deinit(&libs);
-  cx_set_deinit(&types);
-  cx_set_deinit(&funcs);
-  cx_set_deinit(&fimps);
-  cx_set_deinit(&syms);
-		
-  fputs("  }\n\n", out);  
-  
-  fprintf(out, "  static void *op_labels[%zd] = {\n    ", bin->ops.count+1);
-  
-  for (size_t i = 0; i < bin->ops.count+1; i++) {
-    if (i == 0 || cx_set_get(&labels, &i)) {      
-      fprintf(out, "&&op%zd", i);
-    } else {
-      fputs("NULL", out);
+  if (ok) {
+    fputs("static bool _eval(struct cx *cx, ssize_t stop_pc) {\n"
+	  "  ssize_t prev_stop_pc = cx->stop_pc;\n"
+	  "  cx->stop_pc = stop_pc;\n"
+	  "  bool ok = false;\n\n"
+	  "  if (init) {\n"
+	  "    init = false;\n",
+	  out);
+
+    cx_do_vec(&cx->inits, struct cx_str *, i) {
+      fprintf(out,
+	      "if (!cx_init_%s(cx)) { goto exit; }\n",
+	      (*i)->data);
     }
-    
-    if (i < bin->ops.count) { fputs(", ", out); }
-  }
-  
-  fputs("};\n\n"
-	"  goto *op_labels[cx->pc];\n\n",
-	out);
   
-  for (struct cx_op *op = cx_vec_start(&bin->ops);
-       op != cx_vec_end(&bin->ops);
-       op++) {
-    cx->row = op->row; cx->col = op->col;
-    struct cx_tok *tok = cx_vec_get(&bin->toks, op->tok_idx);
+    fputc('\n', out);
 
-    if (op->pc == 0 || cx_set_get(&labels, &op->pc)) {
-      fprintf(out, "op%zd: ", op->pc);
+    cx_do_set(&syms, struct cx_sym, s) {
+      fprintf(out, "    %s = cx_sym(cx, \"%s\");\n", s->emit_id, s->id);
     }
+
+    fputc('\n', out);
+  
+    for (struct cx_op *op = cx_vec_start(&bin->ops);
+	 op != cx_vec_end(&bin->ops);
+	 op++) {
+      if (op->type->emit_init) { op->type->emit_init(op, bin, out, cx); }
+    }
+
+    fprintf(out,
+	    "  }\n\n"
+	    "  static const unsigned int op_units[%zd] = {\n    ",
+	    bin->ops.count+1);
     
-    fprintf(out, "{ /* %s %s */\n", tok->type->id, op->type->id);
+    for (size_t pc = 0; pc < bin->ops.count+1; pc++) {
+      fprintf(out, "%zd", owners[pc]);
+      if (pc < bin->ops.count) { fputs(", ", out); }
+    }
     
-    fprintf(out,
-	    "cx->pc = %zd; cx->row = %d; cx->col = %d;\n",
-	    op->pc, cx->row, cx->col);
-
-    fputs("if (cx->errors.count) { goto exit; }\n\n"
-	  "if (cx->pc == stop_pc) {\n"
-          "  ok = true;\n"
-          "  goto exit;\n"
-          "}\n\n",
+    fputs("};\n\n"
+	  "  switch (op_units[cx->pc]) {\n",
 	  out);
 
-    if (op->type->emit && !cx_test(op->type->emit)(op, bin, out, cx)) {
-      return false;
+    ui = 0;
+  
+    cx_do_vec(&units, struct emit_unit, u) {
+      fprintf(out,
+	      "  case %zd:\n"
+	      "    ok = unit%zd(cx, stop_pc);\n"
+	      "    break;\n",
+	      ui++, u->start_pc);
     }
-    
-    fputs("}\n\n", out);
-  }
 
-  fprintf(out, " op%zd:\n", bin->ops.count);
-
-  fputs("  ok = true;\n"
-	"exit:\n"
-	"  cx->stop_pc = prev_stop_pc;\n"
-	"  return ok;\n"
-	"}\n\n"
-	
-	"  struct cx_bin *bin = cx_bin_new();\n"
-	"  bin->eval = _eval;\n"
-	"  bool ok = cx_eval(bin, 0, -1, cx);\n"
-	"  cx_bin_deref(bin);\n"
-	"  return ok;\n"
-	"}\n",
-	out);
+    fputs("  }\n\n"
+	  "exit:\n"
+	  "  cx->stop_pc = prev_stop_pc;\n"
+	  "  return ok;\n"
+	  "}\n\n"
+	  "bool eval(struct cx *cx) {\n"
+	  "  init = true;\n",
+	  out);
+
+    cx_do_set(&libs, struct cx_lib *, l) {
+      fprintf(out, "  %s_ptr = NULL;\n", (*l)->emit_id);
+    }
+
+    cx_do_set(&types, struct cx_type *, t) {
+      fprintf(out, "  %s_ptr = NULL;\n", (*t)->emit_id);
+    }
+
+    cx_do_set(&funcs, struct cx_func *, f) {
+      fprintf(out, "  %s_ptr = NULL;\n", (*f)->emit_id);
+    }
+
+    cx_do_set(&fimps, struct cx_fimp *, f) {
+      fprintf(out, "  %s_ptr = NULL;\n", (*f)->emit_id);
+    }
+
+    fputs("\n"
+	  "  struct cx_bin *bin = cx_bin_new();\n"
+	  "  bin->eval = _eval;\n"
+	  "  bool ok = cx_eval(bin, 0, -1, cx);\n"
+	  "  cx_bin_deref(bin);\n"
+	  "  return ok;\n"
+	  "}\n",
+	  out);
+  }
   
+  free(owners);
+  cx_vec_deinit(&units);
+  cx_set_deinit(&libs);
+  cx_set_deinit(&types);
+  cx_set_deinit(&funcs);
+  cx_set_deinit(&fimps);
+  cx_set_deinit(&syms);
   cx_set_deinit(&labels);
-  return true;
+  return ok;
 }
 
 static void new_imp(struct cx_box *out) {
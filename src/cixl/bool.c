@@ -2,6 +2,7 @@
 #include "cixl/cx.h"
 #include "cixl/box.h"
 #include "cixl/error.h"
+#include "cixl/pack.h"
 #include "cixl/scope.h"
 
 static bool equid_imp(struct cx_box *x, struct cx_box *y) {
@@ -23,6 +24,20 @@ static bool emit_imp(struct cx_box *v, const char *exp, FILE *out) {
   return true;
 }
 
+static bool pack_imp(struct cx_box *v, struct cx_buf *out) {
+  cx_pack_uint(out, v->as_bool);
+  return true;
+}
+
+static bool unpack_imp(struct cx_type *t,
+		       struct cx_unpack *in,
+		       struct cx_box *out) {
+  uint64_t v = 0;
+  if (!cx_unpack_uint(in, &v)) { return false; }
+  cx_box_init(out, t)->as_bool = v;
+  return true;
+}
+
 struct cx_type *cx_init_bool_type(struct cx_lib *lib) {
   struct cx *cx = lib->cx;
   struct cx_type *t = cx_add_type(lib, "Bool", cx->any_type);
@@ -31,5 +46,7 @@ struct cx_type *cx_init_bool_type(struct cx_lib *lib) {
   t->write = dump_imp;
   t->dump = dump_imp;
   t->emit = emit_imp;  
+  t->pack = pack_imp;
+  t->unpack = unpack_imp;
   return t;
 }
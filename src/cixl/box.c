@@ -75,6 +75,34 @@ struct cx_iter *cx_iter(struct cx_box *box) {
   return cx_test(box->type->iter)(box);
 }
 
+bool cx_freeze(struct cx_box *box) {
+  if (box->type->freeze) { return box->type->freeze(box); }
+  
+  // Types without copy are plain values and immutable as is
+  if (box->type->copy) {
+    struct cx *cx = box->type->lib->cx;
+    
+    cx_error(cx, cx->row, cx->col,
+	     "Freeze not implemented for type: %s",
+	     box->type->id);
+
+    return false;
+  }
+
+  return true;
+}
+
+bool cx_is_frozen(struct cx_box *box) {
+  return box->type->frozen ? box->type->frozen(box) : !box->type->copy;
+}
+
+bool cx_check_mut(struct cx_box *box) {
+  if (!box->type->frozen || !box->type->frozen(box)) { return true; }
+  struct cx *cx = box->type->lib->cx;
+  cx_error(cx, cx->row, cx->col, "Frozen value: %s", box->type->id);
+  return false;
+}
+
 bool cx_write(struct cx_box *box, FILE *out) {
   if (!box->type->write) {
     struct cx *cx = box->type->lib->cx;
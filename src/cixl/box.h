@@ -18,6 +18,7 @@ struct cx_pair;
 struct cx_poll;
 struct cx_queue;
 struct cx_ref;
+struct cx_ring;
 struct cx_scope;
 struct cx_str;
 struct cx_table;
@@ -39,6 +40,7 @@ struct cx_box {
     struct cx_queue *as_queue;
     struct cx_rat    as_rat;
     struct cx_ref   *as_ref;
+    struct cx_ring  *as_ring;
     struct cx_str   *as_str;
     struct cx_sym    as_sym;
     struct cx_table *as_table;
@@ -60,6 +62,9 @@ struct cx_box *cx_copy(struct cx_box *dst, const struct cx_box *src);
 struct cx_box *cx_clone(struct cx_box *dst, struct cx_box *src);
 struct cx_iter *cx_iter(struct cx_box *box);
 bool cx_write(struct cx_box *box, FILE *out);
+bool cx_freeze(struct cx_box *box);
+bool cx_is_frozen(struct cx_box *box);
+bool cx_check_mut(struct cx_box *box);
 void cx_dump(struct cx_box *box, FILE *out);
 void cx_print(struct cx_box *box, FILE *out);
 
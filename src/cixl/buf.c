@@ -1,4 +1,5 @@
-#include <ctype.h>
+#define _GNU_SOURCE
+
 #include <string.h>
 
 #include "cixl/box.h"
@@ -6,25 +7,83 @@
 #include "cixl/cx.h"
 #include "cixl/error.h"
 #include "cixl/malloc.h"
-#include "cixl/mfile.h"
+#include "cixl/util.h"
+
+#define CX_BUF_MIN_CAPAC 64
+
+static ssize_t cookie_read(void *cookie, char *out, size_t len) {
+  struct cx_buf *b = cookie;
+  const char *data = cx_buf_view(b, &len);
+  memcpy(out, data, len);
+  cx_buf_consume(b, len);
+  return len;
+}
+
+static ssize_t cookie_write(void *cookie, const char *in, size_t len) {
+  cx_buf_write(cookie, in, len);
+  return len;
+}
 
 struct cx_buf *cx_buf_new(struct cx *cx) {
   struct cx_buf *b = cx_malloc(&cx->buf_alloc);
   b->data = NULL;
-  b->len = 0;
-  FILE *f = cx_mopen(&b->data, &b->len);
+  b->capac = b->rpos = b->wpos = 0;
+
+  FILE *f = fopencookie(b, "w+", (cookie_io_functions_t){
+      .read = cookie_read,
+      .write = cookie_write
+    });
+
+  setvbuf(f, NULL, _IONBF, 0);
   cx_file_init(&b->file, cx, -1, "w+", f);
-  b->pos = 0;
   return b;
 }
 
 size_t cx_buf_len(struct cx_buf *b) {
-  return ftell(b->file._ptr) - b->pos;
+  return b->wpos - b->rpos;
 }
 
 void cx_buf_clear(struct cx_buf *b) {
-  fseek(b->file._ptr, 0, SEEK_SET);
-  b->pos = 0;
+  b->rpos = b->wpos = 0;
+}
+
+void cx_buf_compact(struct cx_buf *b) {
+  if (!b->rpos) { return; }
+  memmove(b->data, b->data+b->rpos, b->wpos-b->rpos);
+  b->wpos -= b->rpos;
+  b->rpos = 0;
+}
+
+char *cx_buf_reserve(struct cx_buf *b, size_t len) {
+  if (b->wpos+len > b->capac && b->rpos >= b->capac/2) { cx_buf_compact(b); }
+  
+  if (b->wpos+len > b->capac) {
+    b->capac = cx_max(cx_max(b->capac*2, b->wpos+len), (size_t)CX_BUF_MIN_CAPAC);
+    b->data = realloc(b->data, b->capac);
+  }
+
+  return b->data+b->wpos;
+}
+
+void cx_buf_commit(struct cx_buf *b, size_t len) {
+  cx_test(b->wpos+len <= b->capac);
+  b->wpos += len;
+}
+
+void cx_buf_write(struct cx_buf *b, const void *data, size_t len) {
+  memcpy(cx_buf_reserve(b, len), data, len);
+  cx_buf_commit(b, len);
+}
+
+const char *cx_buf_view(struct cx_buf *b, size_t *len) {
+  *len = cx_min(*len, b->wpos-b->rpos);
+  return b->data+b->rpos;
+}
+
+void cx_buf_consume(struct cx_buf *b, size_t len) {
+  cx_test(b->rpos+len <= b->wpos);
+  b->rpos += len;
+  if (b->rpos == b->wpos) { cx_buf_clear(b); }
 }
 
 static void new_imp(struct cx_box *out) {
@@ -10,12 +10,20 @@ struct cx_type;
 struct cx_buf {
   struct cx_file file;
   char *data;
-  size_t len, pos;  
+  size_t capac, rpos, wpos;
 };
 
 struct cx_buf *cx_buf_new(struct cx *cx);
 size_t cx_buf_len(struct cx_buf *b);
 void cx_buf_clear(struct cx_buf *b);
+void cx_buf_compact(struct cx_buf *b);
+
+char *cx_buf_reserve(struct cx_buf *b, size_t len);
+void cx_buf_commit(struct cx_buf *b, size_t len);
+void cx_buf_write(struct cx_buf *b, const void *data, size_t len);
+
+const char *cx_buf_view(struct cx_buf *b, size_t *len);
+void cx_buf_consume(struct cx_buf *b, size_t len);
 
 struct cx_type *cx_init_buf_type(struct cx_lib *lib);
 
@@ -0,0 +1,343 @@
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "cixl/buf.h"
+#include "cixl/chan.h"
+#include "cixl/cx.h"
+#include "cixl/error.h"
+#include "cixl/pack.h"
+#include "cixl/str.h"
+
+bool cx_msg_init(struct cx_msg *m, struct cx *cx, struct cx_box *v) {
+  m->chan = NULL;
+  m->str = NULL;
+  m->data = NULL;
+  m->len = 0;
+  m->frozen = false;
+
+  // Channels and frozen strings are shared as is, everything else is packed
+  if (v->type == cx->chan_type) {
+    m->chan = cx_chan_ref(v->as_ptr);
+    return true;
+  }
+
+  if (v->type == cx->str_type && v->as_str->frozen) {
+    m->str = cx_str_ref(v->as_str);
+    return true;
+  }
+
+  struct cx_box b;
+  cx_box_init(&b, cx->buf_type)->as_file = &cx_buf_new(cx)->file;
+  struct cx_buf *buf = cx_baseof(b.as_file, struct cx_buf, file);
+  bool ok = cx_pack(v, buf);
+
+  if (ok) {
+    // Boxes point to types of the sending cx, frozen containers are
+    // packed like the rest and frozen again on arrival
+    m->frozen = cx_is_frozen(v);
+    m->len = cx_buf_len(buf);
+    const char *data = cx_buf_view(buf, &m->len);
+    m->data = malloc(m->len);
+    memcpy(m->data, data, m->len);
+  }
+
+  cx_box_deinit(&b);
+  return ok;
+}
+
+bool cx_msg_get(struct cx_msg *m, struct cx *cx, struct cx_box *out) {
+  if (m->chan) {
+    cx_box_init(out, cx->chan_type)->as_ptr = cx_chan_ref(m->chan);
+    return true;
+  }
+
+  if (m->str) {
+    cx_box_init(out, cx->str_type)->as_str = cx_str_ref(m->str);
+    return true;
+  }
+
+  struct cx_set types;
+  cx_unpack_types_init(&types);
+  struct cx_unpack in;
+  cx_unpack_init(&in, cx, m->data, m->len, &types);
+  bool ok = cx_unpack(&in, out);
+  if (!ok && in.eof) { cx_error(cx, cx->row, cx->col, "Truncated message"); }
+  if (ok && m->frozen && !cx_freeze(out)) { cx_box_deinit(out); ok = false; }
+  cx_set_deinit(&types);
+  return ok;
+}
+
+void cx_msg_deinit(struct cx_msg *m) {
+  if (m->chan) { cx_chan_deref(m->chan); }
+  if (m->str) { cx_str_deref(m->str); }
+  free(m->data);
+}
+
+static void signal_init(struct cx_chan_signal *s) {
+  s->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  s->waiters = 0;
+}
+
+static void signal_write(struct cx_chan_signal *s) {
+  uint64_t one = 1;
+  while (write(s->fd, &one, sizeof(one)) == -1 && errno == EINTR);
+}
+
+static void signal_notify(struct cx_chan_signal *s) {
+  // Pairs with the add in signal_wait, either side sees the other
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&s->waiters, __ATOMIC_RELAXED)) { signal_write(s); }
+}
+
+static void signal_wait(struct cx_chan_signal *s,
+			bool (*ready)(struct cx_chan *),
+			struct cx_chan *c) {
+  __atomic_add_fetch(&s->waiters, 1, __ATOMIC_SEQ_CST);
+  
+  if (!ready(c)) {
+    struct pollfd pfd = {.fd = s->fd, .events = POLLIN};
+    poll(&pfd, 1, -1);
+  }
+  
+  __atomic_sub_fetch(&s->waiters, 1, __ATOMIC_SEQ_CST);
+}
+
+static void signal_reset(struct cx_chan_signal *s,
+			 bool (*ready)(struct cx_chan *),
+			 struct cx_chan *c) {
+  uint64_t v;
+  while (read(s->fd, &v, sizeof(v)) == -1 && errno == EINTR);
+
+  // Notifications racing with the read are put back
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (ready(c)) { signal_write(s); }
+}
+
+struct cx_chan *cx_chan_new(enum cx_chan_kind kind, size_t capac) {
+  struct cx_chan *c = NULL;
+  size_t n = 2;
+  while (n < capac) { n <<= 1; }
+  
+  if (posix_memalign((void **)&c, CX_CHAN_LINE, sizeof(struct cx_chan))) {
+    return NULL;
+  }
+  
+  c->kind = kind;
+  c->mask = n-1;
+  c->slots = malloc(sizeof(struct cx_chan_slot) * n);
+  for (size_t i = 0; i < n; i++) { c->slots[i].seq = i; }
+  signal_init(&c->ready);
+  signal_init(&c->space);
+  c->closed = false;
+  c->nrefs = 1;
+  c->head = c->tail = 0;
+  return c;
+}
+
+struct cx_chan *cx_chan_ref(struct cx_chan *c) {
+  __atomic_add_fetch(&c->nrefs, 1, __ATOMIC_RELAXED);
+  return c;
+}
+
+void cx_chan_deref(struct cx_chan *c) {
+  cx_test(__atomic_load_n(&c->nrefs, __ATOMIC_RELAXED));
+  if (__atomic_sub_fetch(&c->nrefs, 1, __ATOMIC_ACQ_REL)) { return; }
+  struct cx_msg m;
+  while (cx_chan_try_pop(c, &m)) { cx_msg_deinit(&m); }
+  free(c->slots);
+  close(c->ready.fd);
+  close(c->space.fd);
+  free(c);
+}
+
+static bool spsc_push(struct cx_chan *c, struct cx_msg *m) {
+  size_t t = __atomic_load_n(&c->tail, __ATOMIC_RELAXED);
+  if (t - __atomic_load_n(&c->head, __ATOMIC_ACQUIRE) > c->mask) { return false; }
+  c->slots[t & c->mask].msg = *m;
+  __atomic_store_n(&c->tail, t+1, __ATOMIC_RELEASE);
+  return true;
+}
+
+static bool spsc_pop(struct cx_chan *c, struct cx_msg *out) {
+  size_t h = __atomic_load_n(&c->head, __ATOMIC_RELAXED);
+  if (__atomic_load_n(&c->tail, __ATOMIC_ACQUIRE) == h) { return false; }
+  *out = c->slots[h & c->mask].msg;
+  __atomic_store_n(&c->head, h+1, __ATOMIC_RELEASE);
+  return true;
+}
+
+static bool mpmc_push(struct cx_chan *c, struct cx_msg *m) {
+  size_t pos = __atomic_load_n(&c->tail, __ATOMIC_RELAXED);
+  struct cx_chan_slot *s = NULL;
+  
+  while (true) {
+    s = c->slots + (pos & c->mask);
+    ptrdiff_t d = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE) - pos;
+
+    if (!d) {
+      if (__atomic_compare_exchange_n(&c->tail, &pos, pos+1,
+				      true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+	break;
+      }
+    } else if (d < 0) {
+      return false;
+    } else {
+      pos = __atomic_load_n(&c->tail, __ATOMIC_RELAXED);
+    }
+  }
+
+  s->msg = *m;
+  __atomic_store_n(&s->seq, pos+1, __ATOMIC_RELEASE);
+  return true;
+}
+
+static bool mpmc_pop(struct cx_chan *c, struct cx_msg *out) {
+  size_t pos = __atomic_load_n(&c->head, __ATOMIC_RELAXED);
+  struct cx_chan_slot *s = NULL;
+  
+  while (true) {
+    s = c->slots + (pos & c->mask);
+    ptrdiff_t d = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE) - (pos+1);
+
+    if (!d) {
+      if (__atomic_compare_exchange_n(&c->head, &pos, pos+1,
+				      true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+	break;
+      }
+    } else if (d < 0) {
+      return false;
+    } else {
+      pos = __atomic_load_n(&c->head, __ATOMIC_RELAXED);
+    }
+  }
+
+  *out = s->msg;
+  __atomic_store_n(&s->seq, pos+c->mask+1, __ATOMIC_RELEASE);
+  return true;
+}
+
+static bool ring_push(struct cx_chan *c, struct cx_msg *m) {
+  return (c->kind == CX_CHAN_SPSC) ? spsc_push(c, m) : mpmc_push(c, m);
+}
+
+static bool ring_pop(struct cx_chan *c, struct cx_msg *out) {
+  return (c->kind == CX_CHAN_SPSC) ? spsc_pop(c, out) : mpmc_pop(c, out);
+}
+
+static bool is_closed(struct cx_chan *c) {
+  return __atomic_load_n(&c->closed, __ATOMIC_ACQUIRE);
+}
+
+static bool has_space(struct cx_chan *c) {
+  return is_closed(c) ||
+    __atomic_load_n(&c->tail, __ATOMIC_ACQUIRE) -
+    __atomic_load_n(&c->head, __ATOMIC_ACQUIRE) <= c->mask;
+}
+
+static bool has_msgs(struct cx_chan *c) {
+  return is_closed(c) ||
+    __atomic_load_n(&c->tail, __ATOMIC_ACQUIRE) !=
+    __atomic_load_n(&c->head, __ATOMIC_ACQUIRE);
+}
+
+bool cx_chan_push(struct cx_chan *c, struct cx_msg *m) {
+  while (true) {
+    if (is_closed(c)) { return false; }
+    
+    if (ring_push(c, m)) {
+      signal_notify(&c->ready);
+      return true;
+    }
+
+    signal_wait(&c->space, has_space, c);
+    signal_reset(&c->space, has_space, c);
+  }
+}
+
+bool cx_chan_try_pop(struct cx_chan *c, struct cx_msg *out) {
+  if (ring_pop(c, out)) {
+    signal_notify(&c->space);
+    return true;
+  }
+
+  // Watched channels stay readable for as long as there are messages
+  if (__atomic_load_n(&c->ready.waiters, __ATOMIC_RELAXED)) {
+    signal_reset(&c->ready, has_msgs, c);
+  }
+  
+  return false;
+}
+
+bool cx_chan_pop(struct cx_chan *c, struct cx_msg *out) {
+  while (true) {
+    if (cx_chan_try_pop(c, out)) { return true; }
+    
+    if (is_closed(c)) {
+      if (cx_chan_try_pop(c, out)) { return true; }
+      return false;
+    }
+
+    signal_wait(&c->ready, has_msgs, c);
+    signal_reset(&c->ready, has_msgs, c);
+  }
+}
+
+void cx_chan_close(struct cx_chan *c) {
+  __atomic_store_n(&c->closed, true, __ATOMIC_RELEASE);
+  signal_notify(&c->ready);
+  signal_notify(&c->space);
+}
+
+size_t cx_chan_len(struct cx_chan *c) {
+  size_t
+    h = __atomic_load_n(&c->head, __ATOMIC_ACQUIRE),
+    t = __atomic_load_n(&c->tail, __ATOMIC_ACQUIRE);
+
+  return (t > h) ? t-h : 0;
+}
+
+void cx_chan_watch(struct cx_chan *c) {
+  __atomic_add_fetch(&c->ready.waiters, 1, __ATOMIC_SEQ_CST);
+  if (has_msgs(c)) { signal_write(&c->ready); }
+}
+
+void cx_chan_unwatch(struct cx_chan *c) {
+  __atomic_sub_fetch(&c->ready.waiters, 1, __ATOMIC_SEQ_CST);
+}
+
+static void new_imp(struct cx_box *out) {
+  out->as_ptr = cx_chan_new(CX_CHAN_MPMC, CX_CHAN_CAPAC);
+}
+
+static bool equid_imp(struct cx_box *x, struct cx_box *y) {
+  return x->as_ptr == y->as_ptr;
+}
+
+static void copy_imp(struct cx_box *dst, const struct cx_box *src) {
+  dst->as_ptr = cx_chan_ref(src->as_ptr);
+}
+
+static void dump_imp(struct cx_box *v, FILE *out) {
+  struct cx_chan *c = v->as_ptr;
+  fprintf(out, "Chan(%p)r%d", c, __atomic_load_n(&c->nrefs, __ATOMIC_RELAXED));
+}
+
+static void deinit_imp(struct cx_box *v) {
+  cx_chan_deref(v->as_ptr);
+}
+
+struct cx_type *cx_init_chan_type(struct cx_lib *lib) {
+  struct cx *cx = lib->cx;
+  struct cx_type *t = cx_add_type(lib, "Chan", cx->any_type);
+  t->new = new_imp;
+  t->equid = equid_imp;
+  t->copy = copy_imp;
+  t->dump = dump_imp;
+  t->deinit = deinit_imp;
+  return t;
+}
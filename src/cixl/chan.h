@@ -0,0 +1,68 @@
+#ifndef CX_CHAN_H
+#define CX_CHAN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define CX_CHAN_CAPAC 1024
+#define CX_CHAN_LINE 64
+
+struct cx;
+struct cx_box;
+struct cx_lib;
+struct cx_str;
+struct cx_type;
+
+struct cx_msg {
+  struct cx_chan *chan;
+  struct cx_str *str;
+  char *data;
+  size_t len;
+  bool frozen;
+};
+
+bool cx_msg_init(struct cx_msg *m, struct cx *cx, struct cx_box *v);
+bool cx_msg_get(struct cx_msg *m, struct cx *cx, struct cx_box *out);
+void cx_msg_deinit(struct cx_msg *m);
+
+enum cx_chan_kind {CX_CHAN_SPSC, CX_CHAN_MPMC};
+
+struct cx_chan_slot {
+  size_t seq;
+  struct cx_msg msg;
+};
+
+struct cx_chan_signal {
+  int fd;
+  unsigned int waiters;
+};
+
+struct cx_chan {
+  enum cx_chan_kind kind;
+  size_t mask;
+  struct cx_chan_slot *slots;
+  struct cx_chan_signal ready, space;
+  bool closed;
+  unsigned int nrefs;
+  
+  // Producers and consumers keep to their own cache lines
+  size_t tail __attribute__((aligned(CX_CHAN_LINE)));
+  size_t head __attribute__((aligned(CX_CHAN_LINE)));
+};
+
+struct cx_chan *cx_chan_new(enum cx_chan_kind kind, size_t capac);
+struct cx_chan *cx_chan_ref(struct cx_chan *c);
+void cx_chan_deref(struct cx_chan *c);
+
+bool cx_chan_push(struct cx_chan *c, struct cx_msg *m);
+bool cx_chan_pop(struct cx_chan *c, struct cx_msg *out);
+bool cx_chan_try_pop(struct cx_chan *c, struct cx_msg *out);
+void cx_chan_close(struct cx_chan *c);
+size_t cx_chan_len(struct cx_chan *c);
+
+void cx_chan_watch(struct cx_chan *c);
+void cx_chan_unwatch(struct cx_chan *c);
+
+struct cx_type *cx_init_chan_type(struct cx_lib *lib);
+
+#endif
@@ -5,6 +5,7 @@
 #include "cixl/cx.h"
 #include "cixl/emit.h"
 #include "cixl/error.h"
+#include "cixl/pack.h"
 #include "cixl/scope.h"
 
 static bool equid_imp(struct cx_box *x, struct cx_box *y) {
@@ -56,6 +57,20 @@ static bool emit_imp(struct cx_box *v, const char *exp, FILE *out) {
   return true;
 }
 
+static bool pack_imp(struct cx_box *v, struct cx_buf *out) {
+  cx_pack_uint(out, v->as_char);
+  return true;
+}
+
+static bool unpack_imp(struct cx_type *t,
+		       struct cx_unpack *in,
+		       struct cx_box *out) {
+  uint64_t v = 0;
+  if (!cx_unpack_uint(in, &v)) { return false; }
+  cx_box_init(out, t)->as_char = v;
+  return true;
+}
+
 struct cx_type *cx_init_char_type(struct cx_lib *lib) {
   struct cx_type *t = cx_add_type(lib, "Char", lib->cx->cmp_type);
   t->equid = equid_imp;
@@ -65,5 +80,7 @@ struct cx_type *cx_init_char_type(struct cx_lib *lib) {
   t->dump = dump_imp; 
   t->print = print_imp;
   t->emit = emit_imp;
+  t->pack = pack_imp;
+  t->unpack = unpack_imp;
   return t;
 }
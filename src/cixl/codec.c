@@ -0,0 +1,108 @@
+#include <stdint.h>
+
+#include "cixl/codec.h"
+#include "cixl/simd.h"
+
+static const char *base64_chars =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static int8_t hex_table[256], base64_table[256];
+
+__attribute__((constructor))
+static void init_tables() {
+  for (int i = 0; i < 256; i++) { hex_table[i] = base64_table[i] = -1; }
+
+  for (int i = 0; i < 10; i++) { hex_table['0'+i] = i; }
+  
+  for (int i = 0; i < 6; i++) {
+    hex_table['a'+i] = hex_table['A'+i] = 10+i;
+  }
+  
+  for (int i = 0; i < 64; i++) { base64_table[(unsigned char)base64_chars[i]] = i; }
+}
+
+size_t cx_hex_encode(const void *in, size_t len, char *out) {
+  cx_simd_hex_encode(in, len, out);
+  return cx_hex_len(len);
+}
+
+bool cx_hex_decode(const char *in, size_t len, void *out, size_t *out_len) {
+  if (len % 2) { return false; }
+  unsigned char *o = out;
+  
+  for (const unsigned char *i = (const unsigned char *)in;
+       i < (const unsigned char *)in+len;
+       i += 2) {
+    int hi = hex_table[i[0]], lo = hex_table[i[1]];
+    if (hi < 0 || lo < 0) { return false; }
+    *o++ = (hi << 4) | lo;
+  }
+
+  *out_len = o - (unsigned char *)out;
+  return true;
+}
+
+size_t cx_base64_encode(const void *in, size_t len, char *out) {
+  const unsigned char *i = in, *end = i + len/3*3;
+  char *o = out;
+  
+  for (; i < end; i += 3, o += 4) {
+    uint32_t v = (i[0] << 16) | (i[1] << 8) | i[2];
+    o[0] = base64_chars[v >> 18];
+    o[1] = base64_chars[(v >> 12) & 0x3f];
+    o[2] = base64_chars[(v >> 6) & 0x3f];
+    o[3] = base64_chars[v & 0x3f];
+  }
+
+  switch (len % 3) {
+  case 1: {
+    uint32_t v = i[0] << 16;
+    *o++ = base64_chars[v >> 18];
+    *o++ = base64_chars[(v >> 12) & 0x3f];
+    *o++ = '=';
+    *o++ = '=';
+    break;
+  }
+  case 2: {
+    uint32_t v = (i[0] << 16) | (i[1] << 8);
+    *o++ = base64_chars[v >> 18];
+    *o++ = base64_chars[(v >> 12) & 0x3f];
+    *o++ = base64_chars[(v >> 6) & 0x3f];
+    *o++ = '=';
+    break;
+  }
+  }
+
+  return o - out;
+}
+
+bool cx_base64_decode(const char *in, size_t len, void *out, size_t *out_len) {
+  if (len % 4) { return false; }
+  const unsigned char *i = (const unsigned char *)in, *end = i+len;
+  unsigned char *o = out;
+  
+  for (; i < end; i += 4) {
+    int
+      a = base64_table[i[0]],
+      b = base64_table[i[1]],
+      c = base64_table[i[2]],
+      d = base64_table[i[3]];
+
+    if (a < 0 || b < 0) { return false; }
+    
+    if (c < 0 || d < 0) {
+      if (i+4 != end || i[3] != '=' || (c < 0 && i[2] != '=')) { return false; }
+      *o++ = (a << 2) | (b >> 4);
+      if (c >= 0) { *o++ = ((b & 0xf) << 4) | (c >> 2); }
+      break;
+    }
+    
+    uint32_t v = (a << 18) | (b << 12) | (c << 6) | d;
+    *o++ = v >> 16;
+    *o++ = (v >> 8) & 0xff;
+    *o++ = v & 0xff;
+  }
+
+  *out_len = o - (unsigned char *)out;
+  return true;
+}
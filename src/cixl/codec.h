@@ -0,0 +1,19 @@
+#ifndef CX_CODEC_H
+#define CX_CODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define cx_hex_len(n)				\
+  ((n) * 2)					\
+
+#define cx_base64_len(n)			\
+  (((n) + 2) / 3 * 4)				\
+
+size_t cx_hex_encode(const void *in, size_t len, char *out);
+bool cx_hex_decode(const char *in, size_t len, void *out, size_t *out_len);
+
+size_t cx_base64_encode(const void *in, size_t len, char *out);
+bool cx_base64_decode(const char *in, size_t len, void *out, size_t *out_len);
+
+#endif
@@ -0,0 +1,244 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "cixl/call.h"
+#include "cixl/coro.h"
+#include "cixl/cx.h"
+#include "cixl/error.h"
+#include "cixl/poll.h"
+#include "cixl/scope.h"
+
+static __thread struct cx_coro *starting = NULL;
+static __thread void **free_stacks = NULL;
+static __thread size_t nfree = 0, nstacks = 0;
+
+static bool add_slab(struct cx *cx) {
+  // Stacks are carved from slabs to keep the number of mappings down,
+  // only touched pages are backed.
+  size_t page = sysconf(_SC_PAGESIZE), len = page + CX_CORO_SLAB*CX_CORO_STACK;
+  
+  char *slab = mmap(NULL, len,
+		    PROT_READ | PROT_WRITE,
+		    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK,
+		    -1, 0);
+
+  if (slab == MAP_FAILED) {
+    cx_error(cx, cx->row, cx->col, "Failed allocating stack: %d", errno);
+    return false;
+  }
+
+  // Lowest page is left as guard, stacks above it rely on cx_coro_check
+  if (mprotect(slab, page, PROT_NONE) == -1) {
+    cx_error(cx, cx->row, cx->col, "Failed protecting stack: %d", errno);
+    munmap(slab, len);
+    return false;
+  }
+
+  nstacks += CX_CORO_SLAB;
+  free_stacks = realloc(free_stacks, sizeof(void *)*nstacks);
+  
+  for (int i = CX_CORO_SLAB-1; i >= 0; i--) {
+    free_stacks[nfree++] = slab + page + i*CX_CORO_STACK;
+  }
+
+  return true;
+}
+
+static void *get_stack(struct cx *cx) {
+  if (!nfree && !add_slab(cx)) { return NULL; }
+  return free_stacks[--nfree];
+}
+
+static void put_stack(void *stack) {
+  // Pages of stacks beyond the cache are given back to the kernel
+  if (nfree >= CX_CORO_CACHE) { madvise(stack, CX_CORO_STACK, MADV_DONTNEED); }
+  free_stacks[nfree++] = stack;
+}
+
+struct cx_coro *cx_coro_new(struct cx *cx, struct cx_box *action) {
+  void *stack = get_stack(cx);
+  if (!stack) { return NULL; }
+  struct cx_coro *co = malloc(sizeof(struct cx_coro));
+  co->cx = cx;
+  co->stack = stack;
+  cx_copy(&co->action, action);
+  co->started = co->done = co->ok = false;
+
+  cx_vec_init(&co->scopes, sizeof(struct cx_scope *));
+  co->scope = cx_vec_push(&co->scopes);
+  *co->scope = cx_scope_ref(cx_scope_new(cx, cx_scope(cx, 0)));
+  cx_vec_init(&co->calls, sizeof(struct cx_call));
+  cx_vec_init(&co->libs, sizeof(struct cx_lib *));
+  co->lib = cx_vec_push(&co->libs);
+  *co->lib = *cx->lib;
+  co->bin = NULL;
+  co->pc = 0;
+  co->stop_pc = -1;
+
+  co->poll = NULL;
+  co->fd = -1;
+  co->write = false;
+  return co;
+}
+
+void cx_coro_free(struct cx_coro *co) {
+  cx_do_vec(&co->scopes, struct cx_scope *, s) {
+    cx_env_clear(&(*s)->vars);
+    cx_scope_deref(*s);
+  }
+
+  cx_vec_deinit(&co->scopes);
+  cx_do_vec(&co->calls, struct cx_call, c) { cx_call_deinit(c); }
+  cx_vec_deinit(&co->calls);
+  cx_vec_deinit(&co->libs);
+  cx_box_deinit(&co->action);
+  if (co->poll) { cx_poll_deref(co->poll); }
+  put_stack(co->stack);
+  free(co);
+}
+
+#define swap_field(x, y) do {				\
+    typeof(x) _tmp = x;				\
+    x = y;					\
+    y = _tmp;					\
+  } while (0)
+
+static void swap_state(struct cx_coro *co) {
+  struct cx *cx = co->cx;
+  swap_field(cx->scopes, co->scopes);
+  swap_field(cx->scope, co->scope);
+  swap_field(cx->calls, co->calls);
+  swap_field(cx->libs, co->libs);
+  swap_field(cx->lib, co->lib);
+  swap_field(cx->bin, co->bin);
+  swap_field(cx->pc, co->pc);
+  swap_field(cx->stop_pc, co->stop_pc);
+}
+
+static void run() {
+  struct cx_coro *co = starting;
+  struct cx *cx = co->cx;
+  co->ok = cx_call(&co->action, cx_scope(cx, 0));
+  co->done = true;
+}
+
+bool cx_coro_check(struct cx_coro *co) {
+  char *sp = __builtin_frame_address(0);
+  if (sp - (char *)co->stack >= CX_CORO_HEADROOM) { return true; }
+  struct cx *cx = co->cx;
+  cx_error(cx, cx->row, cx->col, "Coroutine stack overflow");
+  return false;
+}
+
+bool cx_coro_resume(struct cx_coro *co) {
+  struct cx *cx = co->cx;
+  int row = cx->row, col = cx->col;
+  
+  if (!co->started) {
+    getcontext(&co->context);
+    co->context.uc_stack.ss_sp = co->stack;
+    co->context.uc_stack.ss_size = CX_CORO_STACK;
+    co->context.uc_link = &co->caller;
+    makecontext(&co->context, run, 0);
+    starting = co;
+    co->started = true;
+  }
+  
+  struct cx_coro *prev = cx->coro;
+  cx->coro = co;
+  swap_state(co);
+  swapcontext(&co->caller, &co->context);
+  swap_state(co);
+  cx->coro = prev;
+  cx->row = row;
+  cx->col = col;
+  return !co->done || co->ok;
+}
+
+void cx_coro_yield(struct cx_coro *co) {
+  swapcontext(&co->context, &co->caller);
+}
+
+static bool resume_fd(void *data) {
+  struct cx_coro *co = data;
+  struct cx_poll *p = co->poll;
+  co->poll = NULL;
+  struct cx_poll_file *pf = cx_poll_get(p, co->fd);
+  
+  if (co->write) {
+    pf->write_fn = NULL;
+    pf->write_data = NULL;
+    cx_poll_no_write(p, co->fd);
+  } else {
+    pf->read_fn = NULL;
+    pf->read_data = NULL;
+    cx_poll_no_read(p, co->fd);
+  }
+
+  cx_poll_deref(p);
+  co->fd = -1;
+  bool ok = cx_coro_resume(co);
+  if (co->done) { cx_coro_free(co); }
+  return ok;
+}
+
+bool cx_coro_await_read(struct cx_coro *co, struct cx_poll *p, int fd) {
+  struct cx *cx = co->cx;
+  struct cx_poll_file *pf = cx_poll_get(p, fd);
+
+  if (pf && (pf->read_fn || pf->read_value.type)) {
+    cx_error(cx, cx->row, cx->col, "Already awaiting fd: %d", fd);
+    return false;
+  }
+  
+  pf = cx_poll_read(p, fd);
+
+  if (!pf) {
+    cx_error(cx, cx->row, cx->col, "Failed polling: %d", errno);
+    return false;
+  }
+
+  pf->read_fn = resume_fd;
+  pf->read_data = co;
+  co->poll = cx_poll_ref(p);
+  co->fd = fd;
+  co->write = false;
+  cx_coro_yield(co);
+  return true;
+}
+
+bool cx_coro_await_write(struct cx_coro *co, struct cx_poll *p, int fd) {
+  struct cx *cx = co->cx;
+  struct cx_poll_file *pf = cx_poll_get(p, fd);
+
+  if (pf && (pf->write_fn || pf->write_value.type)) {
+    cx_error(cx, cx->row, cx->col, "Already awaiting fd: %d", fd);
+    return false;
+  }
+  
+  pf = cx_poll_write(p, fd);
+
+  if (!pf) {
+    cx_error(cx, cx->row, cx->col, "Failed polling: %d", errno);
+    return false;
+  }
+
+  pf->write_fn = resume_fd;
+  pf->write_data = co;
+  co->poll = cx_poll_ref(p);
+  co->fd = fd;
+  co->write = true;
+  cx_coro_yield(co);
+  return true;
+}
+
+bool cx_spawn(struct cx *cx, struct cx_box *action) {
+  struct cx_coro *co = cx_coro_new(cx, action);
+  if (!co) { return false; }
+  bool ok = cx_coro_resume(co);
+  if (co->done) { cx_coro_free(co); }
+  return ok;
+}
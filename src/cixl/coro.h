@@ -0,0 +1,54 @@
+#ifndef CX_CORO_H
+#define CX_CORO_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+#include <ucontext.h>
+
+#include "cixl/box.h"
+#include "cixl/vec.h"
+
+#define CX_CORO_STACK (8*1024*1024)
+#define CX_CORO_HEADROOM (64*1024)
+#define CX_CORO_SLAB 64
+#define CX_CORO_CACHE 64
+
+struct cx;
+struct cx_bin;
+struct cx_lib;
+struct cx_poll;
+struct cx_scope;
+
+struct cx_coro {
+  struct cx *cx;
+  ucontext_t context, caller;
+  void *stack;
+  struct cx_box action;
+  bool started, done, ok;
+
+  // Interpreter state, swapped with cx on resume and yield
+  struct cx_vec scopes, calls, libs;
+  struct cx_scope **scope;
+  struct cx_lib **lib;
+  struct cx_bin *bin;
+  size_t pc;
+  ssize_t stop_pc;
+
+  struct cx_poll *poll;
+  int fd;
+  bool write;
+};
+
+struct cx_coro *cx_coro_new(struct cx *cx, struct cx_box *action);
+void cx_coro_free(struct cx_coro *co);
+
+bool cx_coro_check(struct cx_coro *co);
+bool cx_coro_resume(struct cx_coro *co);
+void cx_coro_yield(struct cx_coro *co);
+
+bool cx_coro_await_read(struct cx_coro *co, struct cx_poll *p, int fd);
+bool cx_coro_await_write(struct cx_coro *co, struct cx_poll *p, int fd);
+
+bool cx_spawn(struct cx *cx, struct cx_box *action);
+
+#endif
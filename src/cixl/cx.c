@@ -24,21 +24,26 @@
 #include "cixl/lib/buf.h"
 #include "cixl/lib/cond.h"
 #include "cixl/lib/const.h"
+#include "cixl/lib/db.h"
 #include "cixl/lib/error.h"
 #include "cixl/lib/func.h"
 #include "cixl/lib/io.h"
 #include "cixl/lib/iter.h"
 #include "cixl/lib/math.h"
 #include "cixl/lib/meta.h"
+#include "cixl/lib/mmap.h"
 #include "cixl/lib/net.h"
+#include "cixl/lib/pack.h"
 #include "cixl/lib/pair.h"
 #include "cixl/lib/poll.h"
 #include "cixl/lib/rec.h"
 #include "cixl/lib/ref.h"
+#include "cixl/lib/ring.h"
 #include "cixl/lib/stack.h"
 #include "cixl/lib/str.h"
 #include "cixl/lib/sym.h"
 #include "cixl/lib/sys.h"
+#include "cixl/lib/task.h"
 #include "cixl/lib/table.h"
 #include "cixl/lib/term.h"
 #include "cixl/lib/time.h"
@@ -73,8 +78,11 @@ cx_lib(cx_init_world, "cx") {
     cx_use(cx, "cx/func") &&
     cx_use(cx, "cx/io") &&
     cx_use(cx, "cx/io/buf") &&
+    cx_use(cx, "cx/io/mmap") &&
+    cx_use(cx, "cx/io/pack") &&
     cx_use(cx, "cx/io/term") &&
     cx_use(cx, "cx/io/poll") &&
+    cx_use(cx, "cx/io/ring") &&
     cx_use(cx, "cx/iter") &&
     cx_use(cx, "cx/math") &&
     cx_use(cx, "cx/meta") &&
@@ -87,6 +95,7 @@ cx_lib(cx_init_world, "cx") {
     cx_use(cx, "cx/sym") &&
     cx_use(cx, "cx/sys") &&
     cx_use(cx, "cx/table") &&
+    cx_use(cx, "cx/task") &&
     cx_use(cx, "cx/time") &&
     cx_use(cx, "cx/type") &&
     cx_use(cx, "cx/var");
@@ -142,19 +151,23 @@ struct cx *cx_init(struct cx *cx) {
 
   cx->any_type =
     cx->bin_type = cx->bool_type = cx->buf_type = 
-    cx->char_type = cx->cmp_type =
+    cx->chan_type = cx->char_type = cx->cmp_type =
+    cx->db_table_type =
     cx->file_type = cx->fimp_type = cx->func_type =
     cx->int_type = cx->iter_type =
     cx->lambda_type = cx->lib_type = 
     cx->nil_type = cx->num_type =
-    cx->meta_type =
+    cx->meta_type = cx->mfile_type =
     cx->opt_type =
     cx->pair_type = cx->poll_type =
-    cx->rat_type = cx->rec_type = cx->ref_type = cx->rfile_type = cx->rwfile_type =
+    cx->rat_type = cx->rec_type = cx->ref_type = cx->rfile_type = cx->ring_type =
+    cx->rwfile_type =
     cx->seq_type = cx->stack_type = cx->str_type = cx->sym_type =
-    cx->table_type = cx->tcp_client_type = cx->tcp_server_type = cx->time_type =
+    cx->table_type = cx->task_type =
+    cx->tcp_client_type = cx->tcp_server_type = cx->time_type =
     cx->wfile_type = NULL;
       
+  cx->coro = NULL;
   cx->scope = NULL;
   cx->root_scope = cx_begin(cx, NULL);
 
@@ -167,22 +180,27 @@ void cx_init_libs(struct cx *cx) {
   cx_init_buf(cx);
   cx_init_cond(cx);
   cx_init_const(cx);
+  cx_init_db(cx);
   cx_init_error(cx);
   cx_init_func(cx);
   cx_init_io(cx);
   cx_init_iter(cx);
   cx_init_math(cx);
   cx_init_meta(cx);
+  cx_init_mmap(cx);
   cx_init_net(cx);
+  cx_init_pack(cx);
   cx_init_pair(cx);
   cx_init_poll(cx);
   cx_init_rec(cx);
   cx_init_ref(cx);
+  cx_init_ring(cx);
   cx_init_stack(cx);
   cx_init_str(cx);
   cx_init_sym(cx);
   cx_init_sys(cx);
   cx_init_table(cx);
+  cx_init_task(cx);
   cx_init_term(cx);
   cx_init_time(cx);
   cx_init_type(cx);
@@ -14,6 +14,7 @@
 
 struct cx_arg;
 struct cx_catch;
+struct cx_coro;
 struct cx_scope;
 struct cx_sym;
 
@@ -40,17 +41,19 @@ struct cx {
 
   struct cx_type *any_type,
     *bin_type, *bool_type, *buf_type,
-    *char_type, *cmp_type,
+    *chan_type, *char_type, *cmp_type,
+    *db_table_type,
     *file_type, *fimp_type, *func_type,
     *int_type, *iter_type,
     *lambda_type, *lib_type,
-    *meta_type,
+    *meta_type, *mfile_type,
     *nil_type, *num_type,
     *opt_type,
     *pair_type, *poll_type,
-    *rat_type, *rec_type, *ref_type, *rfile_type, *rwfile_type,
+    *rat_type, *rec_type, *ref_type, *rfile_type, *ring_type, *rwfile_type,
     *seq_type, *stack_type, *str_type, *sym_type,
-    *table_type, *tcp_client_type, *tcp_server_type, *time_type,
+    *table_type, *task_type,
+    *tcp_client_type, *tcp_server_type, *time_type,
     *wfile_type;
 
   size_t next_sym_tag, next_type_tag;
@@ -62,6 +65,7 @@ struct cx {
   struct cx_scope *root_scope, **scope;
 
   struct cx_vec calls;
+  struct cx_coro *coro;
 
   struct cx_bin *bin;
   size_t pc;
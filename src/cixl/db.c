@@ -0,0 +1,869 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cixl/buf.h"
+#include "cixl/cx.h"
+#include "cixl/db.h"
+#include "cixl/error.h"
+#include "cixl/iter.h"
+#include "cixl/lib.h"
+#include "cixl/mmap.h"
+#include "cixl/pack.h"
+#include "cixl/pair.h"
+#include "cixl/rec.h"
+#include "cixl/stack.h"
+#include "cixl/str.h"
+#include "cixl/table.h"
+
+static char *seg_path(struct cx_db_table *t, uint64_t seg) {
+  return cx_fmt("%s.%" PRIu64 ".log", t->path, seg);
+}
+
+static struct cx_buf *get_buf(struct cx_db_table *t) {
+  return cx_baseof(t->buf.as_file, struct cx_buf, file);
+}
+
+static bool write_buf(struct cx_db_table *t, int fd) {
+  struct cx *cx = t->cx;
+  struct cx_buf *b = get_buf(t);
+
+  while (cx_buf_len(b)) {
+    size_t len = cx_buf_len(b);
+    const char *data = cx_buf_view(b, &len);
+    ssize_t wlen = write(fd, data, len);
+
+    if (wlen == -1) {
+      if (errno == EINTR) { continue; }
+      cx_error(cx, cx->row, cx->col, "Failed writing db: %d", errno);
+      return false;
+    }
+
+    cx_buf_consume(b, wlen);
+  }
+
+  return true;
+}
+
+static bool sync_dir(struct cx_db_table *t) {
+  char *dir = strdup(t->path), *sep = strrchr(dir, '/');
+
+  if (sep) {
+    *(sep == dir ? sep+1 : sep) = 0;
+  } else {
+    strcpy(dir, ".");
+  }
+
+  int fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  free(dir);
+  if (fd == -1) { return false; }
+  bool ok = !fsync(fd);
+  close(fd);
+  return ok;
+}
+
+static enum cx_cmp cmp_field(const struct cx_box *x, const struct cx_box *y) {
+  if (x->type != y->type) {
+    // Mixed types are grouped by type, missing fields go first
+    struct cx *cx = x->type->lib->cx;
+    if (x->type == cx->nil_type) { return CX_CMP_LT; }
+    if (y->type == cx->nil_type) { return CX_CMP_GT; }
+    return cx_cmp_cstr(&x->type->id, &y->type->id);
+  }
+
+  return x->type->cmp ? cx_cmp(x, y) : CX_CMP_EQ;
+}
+
+static enum cx_cmp cmp_fields(const struct cx_box *x,
+			      const struct cx_box *y,
+			      bool prefix) {
+  struct cx_stack *xs = x->as_ptr, *ys = y->as_ptr;
+  size_t n = cx_min(xs->imp.count, ys->imp.count);
+
+  for (size_t i = 0; i < n; i++) {
+    enum cx_cmp res = cmp_field(cx_vec_get(&xs->imp, i), cx_vec_get(&ys->imp, i));
+    if (res != CX_CMP_EQ) { return res; }
+  }
+
+  if (prefix || xs->imp.count == ys->imp.count) { return CX_CMP_EQ; }
+  return (xs->imp.count < ys->imp.count) ? CX_CMP_LT : CX_CMP_GT;
+}
+
+static void index_key(struct cx_db_table *t,
+		      struct cx_db_index *idx,
+		      struct cx_box *key,
+		      struct cx_box *rec,
+		      struct cx_box *out) {
+  struct cx *cx = t->cx;
+  struct cx_stack *s = cx_stack_new(cx);
+
+  cx_do_vec(&idx->fields, struct cx_sym, f) {
+    struct cx_box *v = cx_rec_get(rec->as_ptr, *f);
+
+    if (v) {
+      cx_clone(cx_vec_push(&s->imp), v);
+    } else {
+      cx_box_init(cx_vec_push(&s->imp), cx->nil_type);
+    }
+  }
+
+  // The primary key is appended to keep entries unique
+  cx_copy(cx_vec_push(&s->imp), key);
+  cx_box_init(out, cx->stack_type)->as_ptr = s;
+}
+
+static struct cx_db_index_node *index_node(unsigned int height) {
+  struct cx_db_index_node *n =
+    malloc(sizeof(struct cx_db_index_node) +
+	   height*sizeof(struct cx_db_index_node *));
+
+  n->height = height;
+  for (unsigned int i = 0; i < height; i++) { n->next[i] = NULL; }
+  return n;
+}
+
+static unsigned int index_height(struct cx_db_index *idx) {
+  // xorshift, each level is half as likely as the one below
+  uint64_t x = idx->seed;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  idx->seed = x;
+  return cx_min(__builtin_ctzll(x | (1ULL << 63)) + 1, CX_DB_INDEX_HEIGHT);
+}
+
+static struct cx_db_index_node *index_seek(struct cx_db_index *idx,
+					   struct cx_box *key,
+					   struct cx_db_index_node **prev) {
+  struct cx_db_index_node *n = idx->head;
+
+  for (int i = idx->height-1; i >= 0; i--) {
+    while (n->next[i] && cmp_fields(&n->next[i]->key, key, false) == CX_CMP_LT) {
+      n = n->next[i];
+    }
+
+    if (prev) { prev[i] = n; }
+  }
+
+  return n->next[0];
+}
+
+static void index_put(struct cx_db_table *t,
+		      struct cx_db_index *idx,
+		      struct cx_box *key,
+		      struct cx_box *rec) {
+  struct cx_box k;
+  index_key(t, idx, key, rec, &k);
+  struct cx_db_index_node *prev[CX_DB_INDEX_HEIGHT];
+  struct cx_db_index_node *n = index_seek(idx, &k, prev);
+
+  if (n && cmp_fields(&n->key, &k, false) == CX_CMP_EQ) {
+    cx_box_deinit(&k);
+    return;
+  }
+
+  unsigned int h = index_height(idx);
+
+  for (; idx->height < h; idx->height++) { prev[idx->height] = idx->head; }
+  n = index_node(h);
+  
+  for (unsigned int i = 0; i < h; i++) {
+    n->next[i] = prev[i]->next[i];
+    prev[i]->next[i] = n;
+  }
+
+  n->key = k;
+  cx_copy(&n->rec, rec);
+  cx_table_put(idx->keys, key, &k);
+  idx->version++;
+}
+
+static void index_delete(struct cx_db_table *t,
+			 struct cx_db_index *idx,
+			 struct cx_box *key) {
+  // Entries are found by the index key they were inserted with
+  struct cx_table_entry *ke = cx_table_get(idx->keys, key);
+  if (!ke) { return; }
+  struct cx_db_index_node *prev[CX_DB_INDEX_HEIGHT];
+  struct cx_db_index_node *n = index_seek(idx, &ke->val, prev);
+
+  if (n && cmp_fields(&n->key, &ke->val, false) == CX_CMP_EQ) {
+    for (unsigned int i = 0; i < n->height; i++) { prev[i]->next[i] = n->next[i]; }
+    while (idx->height > 1 && !idx->head->next[idx->height-1]) { idx->height--; }
+    cx_box_deinit(&n->key);
+    cx_box_deinit(&n->rec);
+    free(n);
+    idx->version++;
+  }
+
+  cx_table_delete(idx->keys, key);
+}
+
+static void index_deinit(struct cx_db_index *idx) {
+  struct cx_db_index_node *n = idx->head->next[0];
+  
+  while (n) {
+    struct cx_db_index_node *next = n->next[0];
+    cx_box_deinit(&n->key);
+    cx_box_deinit(&n->rec);
+    free(n);
+    n = next;
+  }
+
+  free(idx->head);
+  cx_table_deref(idx->keys);
+  cx_vec_deinit(&idx->fields);
+}
+
+static void set_rec(struct cx_db_table *t, struct cx_box *key, struct cx_box *rec) {
+  struct cx_table_entry *e = cx_table_get(t->recs, key);
+
+  if (e) {
+    cx_do_vec(&t->indexes, struct cx_db_index, idx) { index_delete(t, idx, key); }
+  }
+
+  cx_table_put(t->recs, key, rec);
+
+  cx_do_vec(&t->indexes, struct cx_db_index, idx) {
+    index_put(t, idx, key, rec);
+  }
+}
+
+static bool delete_rec(struct cx_db_table *t, struct cx_box *key) {
+  struct cx_table_entry *e = cx_table_get(t->recs, key);
+  if (!e) { return false; }
+
+  cx_do_vec(&t->indexes, struct cx_db_index, idx) { index_delete(t, idx, key); }
+  cx_table_delete(t->recs, key);
+  return true;
+}
+
+static bool put_rec(struct cx_db_table *t, struct cx_box *rec) {
+  struct cx *cx = t->cx;
+  
+  if (!cx_is(rec->type, cx->rec_type)) {
+    cx_error(cx, cx->row, cx->col, "Invalid db rec: %s", rec->type->id);
+    return false;
+  }
+  
+  struct cx_box key;
+  cx_db_key(t, rec->as_ptr, &key);
+  set_rec(t, &key, rec);
+  cx_box_deinit(&key);
+  return true;
+}
+
+static bool apply(struct cx_db_table *t, struct cx_box *e) {
+  struct cx *cx = t->cx;
+  struct cx_pair *p = e->as_pair;
+
+  if (e->type != cx->pair_type || p->x.type != cx->int_type) {
+    cx_error(cx, cx->row, cx->col, "Invalid db entry: %s", e->type->id);
+    return false;
+  }
+
+  switch (p->x.as_int) {
+  case CX_DB_UPSERT:
+    return put_rec(t, &p->y);
+  case CX_DB_DELETE:
+    delete_rec(t, &p->y);
+    break;
+  default:
+    cx_error(cx, cx->row, cx->col, "Invalid db op: %" PRId64, p->x.as_int);
+    return false;
+  }
+
+  return true;
+}
+
+static bool replay(struct cx_db_table *t, const char *path) {
+  struct cx *cx = t->cx;
+  struct cx_str *s = cx_mmap(path);
+
+  if (!s) {
+    cx_error(cx, cx->row, cx->col, "Failed opening '%s': %d", path, errno);
+    return false;
+  }
+
+  struct cx_set types;
+  cx_unpack_types_init(&types);
+  struct cx_unpack in;
+  cx_unpack_init(&in, cx, s->data, s->len, &types);
+  const char *start = in.pos;
+  bool ok = true;
+
+  while (in.pos < in.end) {
+    struct cx_box e;
+
+    if (!cx_unpack(&in, &e)) {
+      // Torn writes at the end of a segment are dropped
+      if (in.eof && truncate(path, start-s->data) != -1) { break; }
+      ok = false;
+      break;
+    }
+
+    ok = apply(t, &e);
+    cx_box_deinit(&e);
+    if (!ok) { break; }
+    start = in.pos;
+  }
+
+  t->log_len += start-s->data;
+  cx_set_deinit(&types);
+  cx_str_deref(s);
+  return ok;
+}
+
+static bool load_snapshot(struct cx_db_table *t) {
+  struct cx *cx = t->cx;
+  char *path = cx_fmt("%s.snap", t->path);
+  struct cx_str *s = cx_mmap(path);
+  bool ok = false;
+
+  if (!s) {
+    if (errno == ENOENT) {
+      ok = true;
+    } else {
+      cx_error(cx, cx->row, cx->col, "Failed opening '%s': %d", path, errno);
+    }
+
+    goto exit1;
+  }
+
+  struct cx_set types;
+  cx_unpack_types_init(&types);
+  struct cx_unpack in;
+  cx_unpack_init(&in, cx, s->data, s->len, &types);
+  struct cx_box v;
+
+  if (!cx_unpack(&in, &v)) { goto exit2; }
+
+  if (v.type != cx->int_type) {
+    cx_error(cx, cx->row, cx->col, "Invalid db snapshot: %s", path);
+    cx_box_deinit(&v);
+    goto exit2;
+  }
+
+  t->first_seg = v.as_int;
+
+  while (in.pos < in.end) {
+    if (!cx_unpack(&in, &v)) { goto exit2; }
+    bool put_ok = put_rec(t, &v);
+    cx_box_deinit(&v);
+    if (!put_ok) { goto exit2; }
+  }
+
+  ok = true;
+ exit2:
+  if (!ok && in.eof) {
+    cx_error(cx, cx->row, cx->col, "Truncated db snapshot: %s", path);
+  }
+
+  cx_set_deinit(&types);
+  cx_str_deref(s);
+ exit1:
+  free(path);
+  return ok;
+}
+
+static bool open_log(struct cx_db_table *t, bool trunc) {
+  struct cx *cx = t->cx;
+  char *path = seg_path(t, t->seg);
+
+  t->log_fd = open(path,
+		   O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC | (trunc ? O_TRUNC : 0),
+		   0644);
+
+  struct stat st;
+  
+  if (t->log_fd == -1 || fstat(t->log_fd, &st) == -1) {
+    cx_error(cx, cx->row, cx->col, "Failed opening '%s': %d", path, errno);
+    if (t->log_fd != -1) { close(t->log_fd); }
+    t->log_fd = -1;
+    free(path);
+    return false;
+  }
+
+  // Appends to an existing segment start after what is already there
+  t->log_len = st.st_size;
+  free(path);
+  return true;
+}
+
+static bool load(struct cx_db_table *t) {
+  if (!load_snapshot(t)) { return false; }
+  t->seg = t->first_seg;
+
+  while (true) {
+    char *path = seg_path(t, t->seg);
+    struct stat st;
+
+    if (stat(path, &st) == -1) {
+      free(path);
+      break;
+    }
+
+    bool ok = replay(t, path);
+    free(path);
+    if (!ok) { return false; }
+    t->seg++;
+  }
+
+  // Appends go to the last existing segment
+  if (t->seg > t->first_seg) { t->seg--; }
+  return open_log(t, false);
+}
+
+struct cx_db_table *cx_db_table_new(struct cx *cx,
+				    const char *path,
+				    struct cx_vec *key) {
+  struct cx_db_table *t = malloc(sizeof(struct cx_db_table));
+  t->cx = cx;
+  t->path = strdup(path);
+  cx_vec_init(&t->key, sizeof(struct cx_sym));
+  cx_do_vec(key, struct cx_sym, k) { *(struct cx_sym *)cx_vec_push(&t->key) = *k; }
+  cx_vec_init(&t->changes, sizeof(struct cx_db_change));
+  cx_vec_init(&t->indexes, sizeof(struct cx_db_index));
+  t->recs = cx_table_new(cx);
+  cx_box_init(&t->buf, cx->buf_type)->as_file = &cx_buf_new(cx)->file;
+  t->log_fd = -1;
+  t->first_seg = t->seg = 0;
+  t->log_len = 0;
+  t->compact_len = CX_DB_COMPACT_LEN;
+  t->sync_every = 1;
+  t->unsynced = 0;
+  t->nrefs = 1;
+
+  if (!load(t)) {
+    cx_db_table_deref(t);
+    return NULL;
+  }
+
+  return t;
+}
+
+struct cx_db_table *cx_db_table_ref(struct cx_db_table *t) {
+  t->nrefs++;
+  return t;
+}
+
+static void change_deinit(struct cx_db_change *c) {
+  cx_box_deinit(&c->key);
+  if (c->prev.type) { cx_box_deinit(&c->prev); }
+  if (c->rec.type) { cx_box_deinit(&c->rec); }
+}
+
+static void clear_changes(struct cx_db_table *t) {
+  cx_do_vec(&t->changes, struct cx_db_change, c) { change_deinit(c); }
+  cx_vec_clear(&t->changes);
+}
+
+void cx_db_table_deref(struct cx_db_table *t) {
+  cx_test(t->nrefs);
+  t->nrefs--;
+
+  if (!t->nrefs) {
+    if (t->log_fd != -1) {
+      if (t->unsynced) { fdatasync(t->log_fd); }
+      close(t->log_fd);
+    }
+
+    clear_changes(t);
+    cx_vec_deinit(&t->changes);
+    cx_do_vec(&t->indexes, struct cx_db_index, idx) { index_deinit(idx); }
+    cx_vec_deinit(&t->indexes);
+    cx_vec_deinit(&t->key);
+    cx_table_deref(t->recs);
+    cx_box_deinit(&t->buf);
+    free(t->path);
+    free(t);
+  }
+}
+
+void cx_db_key(struct cx_db_table *t, struct cx_rec *r, struct cx_box *out) {
+  struct cx *cx = t->cx;
+  struct cx_stack *s = cx_stack_new(cx);
+
+  cx_do_vec(&t->key, struct cx_sym, k) {
+    struct cx_box *v = cx_rec_get(r, *k);
+
+    if (v) {
+      cx_clone(cx_vec_push(&s->imp), v);
+    } else {
+      cx_box_init(cx_vec_push(&s->imp), cx->nil_type);
+    }
+  }
+
+  cx_box_init(out, cx->stack_type)->as_ptr = s;
+}
+
+void cx_db_upsert(struct cx_db_table *t, struct cx_box *rec) {
+  struct cx_db_change *c = cx_vec_push(&t->changes);
+  cx_db_key(t, rec->as_ptr, &c->key);
+  struct cx_table_entry *e = cx_table_get(t->recs, &c->key);
+
+  if (e) {
+    cx_copy(&c->prev, &e->val);
+  } else {
+    c->prev.type = NULL;
+  }
+
+  // Stored records are private to the table, which keeps prev intact
+  cx_clone(&c->rec, rec);
+  set_rec(t, &c->key, &c->rec);
+}
+
+bool cx_db_delete(struct cx_db_table *t, struct cx_box *key) {
+  struct cx_table_entry *e = cx_table_get(t->recs, key);
+  if (!e) { return false; }
+  struct cx_db_change *c = cx_vec_push(&t->changes);
+  cx_clone(&c->key, key);
+  cx_copy(&c->prev, &e->val);
+  c->rec.type = NULL;
+  delete_rec(t, &c->key);
+  return true;
+}
+
+struct cx_box *cx_db_find(struct cx_db_table *t, struct cx_box *key) {
+  struct cx_table_entry *e = cx_table_get(t->recs, key);
+  return e ? &e->val : NULL;
+}
+
+struct cx_db_index *cx_db_add_index(struct cx_db_table *t,
+				    struct cx_sym id,
+				    struct cx_vec *fields) {
+  if (cx_db_get_index(t, id)) {
+    struct cx *cx = t->cx;
+    cx_error(cx, cx->row, cx->col, "Duplicate index: %s", id.id);
+    return NULL;
+  }
+
+  struct cx_db_index *idx = cx_vec_push(&t->indexes);
+  idx->id = id;
+  cx_vec_init(&idx->fields, sizeof(struct cx_sym));
+  cx_do_vec(fields, struct cx_sym, f) { *(struct cx_sym *)cx_vec_push(&idx->fields) = *f; }
+  idx->head = index_node(CX_DB_INDEX_HEIGHT);
+  idx->height = 1;
+  idx->seed = 0x9e3779b97f4a7c15ULL;
+  idx->version = 0;
+  idx->keys = cx_table_new(t->cx);
+
+  cx_do_set(&t->recs->entries, struct cx_table_entry, e) {
+    index_put(t, idx, &e->key, &e->val);
+  }
+
+  return idx;
+}
+
+struct cx_db_index *cx_db_get_index(struct cx_db_table *t, struct cx_sym id) {
+  cx_do_vec(&t->indexes, struct cx_db_index, idx) {
+    if (idx->id.tag == id.tag) { return idx; }
+  }
+
+  return NULL;
+}
+
+struct cx_db_scan {
+  struct cx_iter iter;
+  struct cx_db_table *table;
+  size_t index;
+  struct cx_db_index_node *node;
+  uint64_t version;
+  struct cx_box last, max;
+  bool started;
+};
+
+static bool scan_next(struct cx_iter *iter, struct cx_box *out, struct cx_scope *scope) {
+  struct cx_db_scan *it = cx_baseof(iter, struct cx_db_scan, iter);
+  struct cx_db_index *idx = cx_vec_get(&it->table->indexes, it->index);
+
+  if (it->version != idx->version) {
+    // The index changed since the last call, so nodes are found again
+    it->node = index_seek(idx, &it->last, NULL);
+
+    if (it->started &&
+	it->node &&
+	cmp_fields(&it->node->key, &it->last, false) == CX_CMP_EQ) {
+      it->node = it->node->next[0];
+    }
+
+    it->version = idx->version;
+  }
+
+  struct cx_db_index_node *n = it->node;
+
+  if (n && (!it->max.type || cmp_fields(&n->key, &it->max, true) != CX_CMP_GT)) {
+    cx_clone(out, &n->rec);
+    cx_box_deinit(&it->last);
+    cx_copy(&it->last, &n->key);
+    it->node = n->next[0];
+    it->started = true;
+    return true;
+  }
+
+  iter->done = true;
+  return false;
+}
+
+static void *scan_deinit(struct cx_iter *iter) {
+  struct cx_db_scan *it = cx_baseof(iter, struct cx_db_scan, iter);
+  cx_db_table_deref(it->table);
+  cx_box_deinit(&it->last);
+  if (it->max.type) { cx_box_deinit(&it->max); }
+  return it;
+}
+
+static cx_iter_type(scan_iter, {
+    type.next = scan_next;
+    type.deinit = scan_deinit;
+  });
+
+struct cx_iter *cx_db_index_scan(struct cx_db_table *t,
+				 struct cx_db_index *idx,
+				 struct cx_box *min,
+				 struct cx_box *max) {
+  struct cx *cx = t->cx;
+  struct cx_db_scan *it = malloc(sizeof(struct cx_db_scan));
+  cx_iter_init(&it->iter, scan_iter());
+  it->table = cx_db_table_ref(t);
+  it->index = idx - (struct cx_db_index *)t->indexes.items;
+
+  // Bounds are compared on as many fields as they contain
+  it->node = min ? index_seek(idx, min, NULL) : idx->head->next[0];
+  it->version = idx->version;
+  it->started = false;
+
+  if (min) {
+    cx_copy(&it->last, min);
+  } else {
+    cx_box_init(&it->last, cx->stack_type)->as_ptr = cx_stack_new(cx);
+  }
+  
+  if (max) {
+    cx_copy(&it->max, max);
+  } else {
+    it->max.type = NULL;
+  }
+
+  return &it->iter;
+}
+
+static bool pack_change(struct cx_db_table *t, struct cx_db_change *c) {
+  struct cx *cx = t->cx;
+  struct cx_box op, e;
+  cx_box_init(&op, cx->int_type)->as_int = c->rec.type ? CX_DB_UPSERT : CX_DB_DELETE;
+
+  cx_box_init(&e, cx->pair_type)->as_pair =
+    cx_pair_new(cx, &op, c->rec.type ? &c->rec : &c->key);
+
+  bool ok = cx_pack(&e, get_buf(t));
+  cx_box_deinit(&e);
+  return ok;
+}
+
+bool cx_db_commit(struct cx_db_table *t) {
+  if (!t->changes.count) { return true; }
+  struct cx_buf *b = get_buf(t);
+  cx_buf_clear(b);
+
+  cx_do_vec(&t->changes, struct cx_db_change, c) {
+    if (!pack_change(t, c)) { return false; }
+  }
+
+  // All changes go out in one write, sync is batched across commits
+  size_t len = cx_buf_len(b);
+
+  if (!write_buf(t, t->log_fd)) {
+    // Partial writes are cut off, replay would drop everything after them
+    if (ftruncate(t->log_fd, t->log_len) == -1) {
+      struct cx *cx = t->cx;
+      cx_error(cx, cx->row, cx->col, "Failed truncating db: %d", errno);
+    }
+    
+    return false;
+  }
+
+  clear_changes(t);
+  t->log_len += len;
+  t->unsynced++;
+  if (t->sync_every && t->unsynced >= t->sync_every && !cx_db_sync(t)) {
+    return false;
+  }
+
+  return (t->compact_len && t->log_len >= t->compact_len)
+    ? cx_db_compact(t)
+    : true;
+}
+
+void cx_db_rollback(struct cx_db_table *t) {
+  for (size_t i = t->changes.count; i > 0; i--) {
+    struct cx_db_change *c = cx_vec_get(&t->changes, i-1);
+
+    if (c->prev.type) {
+      set_rec(t, &c->key, &c->prev);
+    } else {
+      delete_rec(t, &c->key);
+    }
+  }
+
+  clear_changes(t);
+}
+
+bool cx_db_sync(struct cx_db_table *t) {
+  if (!t->unsynced) { return true; }
+
+  if (fdatasync(t->log_fd) == -1) {
+    struct cx *cx = t->cx;
+    cx_error(cx, cx->row, cx->col, "Failed syncing db: %d", errno);
+    return false;
+  }
+
+  t->unsynced = 0;
+  return true;
+}
+
+static bool write_snapshot(struct cx_db_table *t, uint64_t seg) {
+  struct cx *cx = t->cx;
+  char
+    *path = cx_fmt("%s.snap", t->path),
+    *tmp_path = cx_fmt("%s.snap.tmp", t->path);
+
+  bool ok = false;
+  int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+  if (fd == -1) {
+    cx_error(cx, cx->row, cx->col, "Failed opening '%s': %d", tmp_path, errno);
+    goto exit;
+  }
+
+  struct cx_buf *b = get_buf(t);
+  cx_buf_clear(b);
+  struct cx_box v;
+  cx_box_init(&v, cx->int_type)->as_int = seg;
+  cx_pack(&v, b);
+
+  cx_do_set(&t->recs->entries, struct cx_table_entry, e) {
+    if (!cx_pack(&e->val, b)) { goto exit; }
+    if (cx_buf_len(b) >= CX_DB_FLUSH_LEN && !write_buf(t, fd)) { goto exit; }
+  }
+
+  if (!write_buf(t, fd)) { goto exit; }
+
+  if (fsync(fd) == -1 || rename(tmp_path, path) == -1 || !sync_dir(t)) {
+    cx_error(cx, cx->row, cx->col, "Failed writing snapshot: %d", errno);
+    goto exit;
+  }
+
+  ok = true;
+ exit:
+  if (fd != -1) { close(fd); }
+  if (!ok) { unlink(tmp_path); }
+  free(path);
+  free(tmp_path);
+  return ok;
+}
+
+bool cx_db_compact(struct cx_db_table *t) {
+  if (!cx_db_commit(t)) { return false; }
+  uint64_t seg = t->seg+1;
+
+  // Old segments are only removed once the snapshot covering them is in place
+  if (!write_snapshot(t, seg)) { return false; }
+  close(t->log_fd);
+
+  for (uint64_t i = t->first_seg; i < seg; i++) {
+    char *path = seg_path(t, i);
+    unlink(path);
+    free(path);
+  }
+
+  t->first_seg = t->seg = seg;
+  t->log_len = 0;
+  t->unsynced = 0;
+  return open_log(t, true);
+}
+
+static bool equid_imp(struct cx_box *x, struct cx_box *y) {
+  return x->as_ptr == y->as_ptr;
+}
+
+static bool ok_imp(struct cx_box *v) {
+  struct cx_db_table *t = v->as_ptr;
+  return t->recs->entries.members.count;
+}
+
+static void copy_imp(struct cx_box *dst, const struct cx_box *src) {
+  dst->as_ptr = cx_db_table_ref(src->as_ptr);
+}
+
+struct cx_db_iter {
+  struct cx_iter iter;
+  struct cx_db_table *table;
+  size_t i;
+};
+
+static bool db_iter_next(struct cx_iter *iter,
+			 struct cx_box *out,
+			 struct cx_scope *scope) {
+  struct cx_db_iter *it = cx_baseof(iter, struct cx_db_iter, iter);
+  struct cx_table *recs = it->table->recs;
+
+  if (it->i < recs->entries.members.count) {
+    struct cx *cx = it->table->cx;
+    struct cx_table_entry *e = cx_vec_get(&recs->entries.members, it->i);
+    struct cx_box r;
+    cx_clone(&r, &e->val);
+    cx_box_init(out, cx->pair_type)->as_pair = cx_pair_new(cx, &e->key, &r);
+    cx_box_deinit(&r);
+    it->i++;
+    return true;
+  }
+
+  iter->done = true;
+  return false;
+}
+
+static void *db_iter_deinit(struct cx_iter *iter) {
+  struct cx_db_iter *it = cx_baseof(iter, struct cx_db_iter, iter);
+  cx_db_table_deref(it->table);
+  return it;
+}
+
+static cx_iter_type(db_iter, {
+    type.next = db_iter_next;
+    type.deinit = db_iter_deinit;
+  });
+
+static struct cx_iter *iter_imp(struct cx_box *v) {
+  struct cx_db_iter *it = malloc(sizeof(struct cx_db_iter));
+  cx_iter_init(&it->iter, db_iter());
+  it->table = cx_db_table_ref(v->as_ptr);
+  it->i = 0;
+  return &it->iter;
+}
+
+static void dump_imp(struct cx_box *v, FILE *out) {
+  struct cx_db_table *t = v->as_ptr;
+  fprintf(out, "DBTable(%s)r%d", t->path, t->nrefs);
+}
+
+static void deinit_imp(struct cx_box *v) {
+  cx_db_table_deref(v->as_ptr);
+}
+
+struct cx_type *cx_init_db_table_type(struct cx_lib *lib) {
+  struct cx *cx = lib->cx;
+  struct cx_type *t = cx_add_type(lib, "DBTable", cx->seq_type);
+  t->equid = equid_imp;
+  t->ok = ok_imp;
+  t->copy = copy_imp;
+  t->iter = iter_imp;
+  t->dump = dump_imp;
+  t->deinit = deinit_imp;
+  return t;
+}
@@ -0,0 +1,85 @@
+#ifndef CX_DB_H
+#define CX_DB_H
+
+#include <stdint.h>
+
+#include "cixl/box.h"
+#include "cixl/set.h"
+#include "cixl/vec.h"
+
+#define CX_DB_COMPACT_LEN (64*1024*1024)
+#define CX_DB_FLUSH_LEN (1024*1024)
+#define CX_DB_INDEX_HEIGHT 32
+
+struct cx;
+struct cx_iter;
+struct cx_lib;
+struct cx_rec;
+struct cx_table;
+struct cx_type;
+
+enum cx_db_op {CX_DB_UPSERT = 1, CX_DB_DELETE};
+
+struct cx_db_change {
+  struct cx_box key, prev, rec;
+};
+
+struct cx_db_index_node {
+  struct cx_box key, rec;
+  unsigned int height;
+  struct cx_db_index_node *next[];
+};
+
+struct cx_db_index {
+  struct cx_sym id;
+  struct cx_vec fields;
+  struct cx_db_index_node *head;
+  unsigned int height;
+  uint64_t seed, version;
+  struct cx_table *keys;
+};
+
+struct cx_db_table {
+  struct cx *cx;
+  char *path;
+  struct cx_vec key, changes, indexes;
+  struct cx_table *recs;
+  struct cx_box buf;
+  int log_fd;
+  uint64_t first_seg, seg;
+  size_t log_len, compact_len;
+  unsigned int sync_every, unsynced;
+  unsigned int nrefs;
+};
+
+struct cx_db_table *cx_db_table_new(struct cx *cx,
+				    const char *path,
+				    struct cx_vec *key);
+
+struct cx_db_table *cx_db_table_ref(struct cx_db_table *t);
+void cx_db_table_deref(struct cx_db_table *t);
+
+void cx_db_key(struct cx_db_table *t, struct cx_rec *r, struct cx_box *out);
+void cx_db_upsert(struct cx_db_table *t, struct cx_box *rec);
+bool cx_db_delete(struct cx_db_table *t, struct cx_box *key);
+struct cx_box *cx_db_find(struct cx_db_table *t, struct cx_box *key);
+
+struct cx_db_index *cx_db_add_index(struct cx_db_table *t,
+				    struct cx_sym id,
+				    struct cx_vec *fields);
+
+struct cx_db_index *cx_db_get_index(struct cx_db_table *t, struct cx_sym id);
+
+struct cx_iter *cx_db_index_scan(struct cx_db_table *t,
+				 struct cx_db_index *idx,
+				 struct cx_box *min,
+				 struct cx_box *max);
+
+bool cx_db_commit(struct cx_db_table *t);
+void cx_db_rollback(struct cx_db_table *t);
+bool cx_db_sync(struct cx_db_table *t);
+bool cx_db_compact(struct cx_db_table *t);
+
+struct cx_type *cx_init_db_table_type(struct cx_lib *lib);
+
+#endif
@@ -6,6 +6,7 @@
 #include "cixl/emit.h"
 #include "cixl/error.h"
 #include "cixl/link.h"
+#include "cixl/sched.h"
 #include "cixl/stack.h"
 #include "cixl/str.h"
 
@@ -85,6 +86,42 @@ void cx_push_args(struct cx *cx, int argc, char *argv[]) {
   }
 }
 
+struct emit_task {
+  char **argv;
+  bool (*run)(int, char **);
+  bool failed;
+};
+
+static bool run_emit_task(struct cx_sched_worker *w, size_t i) {
+  struct emit_task *t = w->sched->data;
+
+  // Failing tasks don't stop the rest of the batch
+  if (!t->run(1, t->argv+i)) { __atomic_store_n(&t->failed, true, __ATOMIC_RELAXED); }
+  return true;
+}
+
+bool cx_emit_main(int argc, char *argv[], bool (*run)(int, char **)) {
+  const char *n = getenv("CX_TASKS");
+  // Without arguments there is nothing to split, so it runs as a single task
+  if (!n || argc == 1) { return run(argc-1, argv+1); }
+  int nworkers = strtol(n, NULL, 10);
+
+  if (nworkers < 1 || nworkers > CX_SCHED_MAX) {
+    fprintf(stderr, "Invalid CX_TASKS: %s\n", n);
+    return false;
+  }
+
+  // Each argument is run as a separate task with its own cx
+  struct emit_task t = {.argv = argv+1, .run = run, .failed = false};
+  struct cx_sched s;
+  cx_sched_init(&s, nworkers, &t);
+  s.run = run_emit_task;
+  int res = cx_sched_run(&s, argc-1);
+  cx_sched_deinit(&s);
+  if (res > 0) { fprintf(stderr, "Failed running tasks: %d\n", res); }
+  return !res && !t.failed;
+}
+
 bool cx_emit_file(struct cx *cx, struct cx_bin *bin, FILE *out) {
   bool ok = false;
 
@@ -95,6 +132,7 @@ bool cx_emit_file(struct cx *cx, struct cx_bin *bin, FILE *out) {
 	"#include \"cixl/bin.h\"\n"
 	"#include \"cixl/call.h\"\n"
 	"#include \"cixl/catch.h\"\n"
+	"#include \"cixl/coro.h\"\n"
 	"#include \"cixl/cx.h\"\n"
 	"#include \"cixl/emit.h\"\n"
 	"#include \"cixl/error.h\"\n"
@@ -113,8 +151,7 @@ bool cx_emit_file(struct cx *cx, struct cx_bin *bin, FILE *out) {
   
   if (!cx_emit(bin, out, cx)) { goto exit; }
       
-  fputs("int main(int argc, char *argv[]) {\n"
-	"  srand((ptrdiff_t)argv + clock());\n"
+  fputs("bool run_task(int argc, char *argv[]) {\n"
 	"  struct cx cx;\n"
 	"  cx_init(&cx);\n"
 	"  cx_init_libs(&cx);\n"
@@ -122,18 +159,16 @@ bool cx_emit_file(struct cx *cx, struct cx_bin *bin, FILE *out) {
         "  cx_use(&cx, \"cx/io\", \"include:\");\n"
         "  cx_use(&cx, \"cx/meta\", \"lib:\", \"use:\");\n"
         "  cx_use(&cx, \"cx/sys\", \"#args\");\n"
-        "  cx_push_args(&cx, argc-1, argv+1);\n"
-	"  int result = -1;\n\n"
-	
-	"  if (!eval(&cx)) {\n"
-	"    cx_dump_errors(&cx, stderr);\n"
-	"    goto exit;\n"
-	"  }\n\n"
-	
-	"  result = 0;\n"
-	"exit:\n"
+        "  cx_push_args(&cx, argc, argv);\n"
+	"  bool ok = eval(&cx);\n"
+	"  if (!ok) { cx_dump_errors(&cx, stderr); }\n"
 	"  cx_deinit(&cx);\n"
-	"  return result;\n"
+	"  return ok;\n"
+	"}\n\n"
+	
+	"int main(int argc, char *argv[]) {\n"
+	"  srand((ptrdiff_t)argv + clock());\n"
+	"  return cx_emit_main(argc, argv, run_task) ? 0 : -1;\n"
 	"}",
 	out);
 
@@ -95,7 +95,8 @@ struct cx_error *new_error(struct cx *cx, int row, int col, struct cx_box *v) {
       }
     }
     
-    if (s == cx->root_scope) { break; }
+    // Coroutines bottom out in their own scope rather than the root
+    if (s == cx->root_scope || cx->scopes.count == 1) { break; }
     cx_end(cx);
   }
 
@@ -1,5 +1,8 @@
+#define _GNU_SOURCE
+
 #include <errno.h>
 #include <fcntl.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "cixl/box.h"
@@ -7,8 +10,10 @@
 #include "cixl/error.h"
 #include "cixl/iter.h"
 #include "cixl/op.h"
+#include "cixl/poll.h"
 #include "cixl/scope.h"
 #include "cixl/file.h"
+#include "cixl/wqueue.h"
 
 struct char_iter {
   struct cx_iter iter;
@@ -20,23 +25,28 @@ static bool char_next(struct cx_iter *iter,
 		      struct cx_scope *scope) {
   struct cx *cx = scope->cx;
   struct char_iter *it = cx_baseof(iter, struct char_iter, iter);
-  FILE *fptr = cx_file_ptr(it->in.as_file);
-  int c = fgetc(fptr);
+  struct cx_file *f = it->in.as_file;
+
+  if (f->rpos == f->rlen) {
+    ssize_t len = cx_file_fill(f);
 
-  if (c == EOF) {
-    if (feof(fptr)) {
+    if (!len) {
       iter->done = true;
       return false;
-    } else if (errno == EAGAIN) {
-      cx_box_init(out, cx->nil_type);
-    } else {
+    }
+
+    if (len == -1) {
+      if (errno == EAGAIN) {
+	cx_box_init(out, cx->nil_type);
+	return true;
+      }
+
       cx_error(cx, cx->row, cx->col, "Failed reading char: %d", errno);
       return false;
     }
-  } else {
-    cx_box_init(out, cx->char_type)->as_char = c;
   }
-  
+
+  cx_box_init(out, cx->char_type)->as_char = f->rbuf[f->rpos++];
   return true;
 }
 
@@ -82,6 +92,11 @@ struct cx_file *cx_file_init(struct cx_file *f,
   f->fd = fd;
   f->mode = mode;
   f->_ptr = ptr;
+  f->queue = NULL;
+  f->rbuf = NULL;
+  f->rpos = f->rlen = f->rcapac = 0;
+  f->splice_fds[0] = f->splice_fds[1] = -1;
+  f->splice_len = 0;
   f->nrefs = 1;
   return f;
 }
@@ -96,6 +111,57 @@ FILE *cx_file_ptr(struct cx_file *file) {
   return file->_ptr;
 }
 
+static size_t drain_stdio(struct cx_file *f, char *out, size_t n) {
+  // Reads whatever stdio has buffered, and what the fd has ready, without blocking
+  int flags = fcntl(f->fd, F_GETFL, 0);
+  bool block = flags != -1 && !(flags & O_NONBLOCK);
+  if (block) { fcntl(f->fd, F_SETFL, flags | O_NONBLOCK); }
+  clearerr(f->_ptr);
+  size_t len = fread(out, 1, n, f->_ptr);
+  clearerr(f->_ptr);
+  if (block) { fcntl(f->fd, F_SETFL, flags); }
+  return len;
+}
+
+ssize_t cx_file_fill(struct cx_file *f) {
+  bool first = !f->rbuf;
+  
+  if (f->rpos == f->rlen) {
+    f->rpos = f->rlen = 0;
+  } else if (f->rpos) {
+    memmove(f->rbuf, f->rbuf+f->rpos, f->rlen-f->rpos);
+    f->rlen -= f->rpos;
+    f->rpos = 0;
+  }
+
+  if (f->rlen == f->rcapac) {
+    f->rcapac = f->rcapac ? f->rcapac*2 : CX_FILE_BLOCK;
+    f->rbuf = realloc(f->rbuf, f->rcapac);
+  }
+
+  char *out = f->rbuf+f->rlen;
+  size_t n = f->rcapac-f->rlen;
+  ssize_t len = -1;
+
+  if (f->fd == -1) {
+    FILE *fptr = cx_file_ptr(f);
+    clearerr(fptr);
+    len = fread(out, 1, n, fptr);
+    if (!len && ferror(fptr)) { len = -1; }
+  } else {
+    // Data already buffered by stdio is drained once, before the fd is read
+    len = (first && f->_ptr) ? drain_stdio(f, out, n) : 0;
+    if (!len) { len = read(f->fd, out, n); }
+  }
+
+  if (len > 0) { f->rlen += len; }
+  return len;
+}
+
+void cx_file_drop(struct cx_file *f) {
+  f->rpos = f->rlen = 0;
+}
+
 bool cx_file_unblock(struct cx_file *file) {
   if (fcntl(file->fd, F_SETFL, fcntl(file->fd, F_GETFL, 0) | O_NONBLOCK) == -1) {
     struct cx *cx = file->cx;
@@ -107,6 +173,32 @@ bool cx_file_unblock(struct cx_file *file) {
 }
 
 bool cx_file_close(struct cx_file *file) {
+  if (file->queue) {
+    struct cx_wqueue *q = file->queue;
+    if (q->len && file->fd != -1) { cx_wqueue_flush(q, file->fd); }
+    if (q->poll && file->fd != -1) { cx_poll_delete(q->poll, file->fd); }
+    file->queue = NULL;
+    cx_wqueue_free(q);
+  }
+
+  if (file->splice_fds[0] != -1) {
+    if (file->splice_len && file->fd != -1) {
+      splice(file->splice_fds[0], NULL, file->fd, NULL, file->splice_len,
+	     SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    }
+    
+    close(file->splice_fds[0]);
+    close(file->splice_fds[1]);
+    file->splice_fds[0] = file->splice_fds[1] = -1;
+    file->splice_len = 0;
+  }
+
+  if (file->rbuf) {
+    free(file->rbuf);
+    file->rbuf = NULL;
+    file->rpos = file->rlen = file->rcapac = 0;
+  }
+  
   if (file->_ptr == stdin || file->_ptr == stdout) { return true; }
   
   if (file->_ptr) {
@@ -1,7 +1,11 @@
 #ifndef CX_FILE_H
 #define CX_FILE_H
 
+#include <stdbool.h>
 #include <stdio.h>
+#include <sys/types.h>
+
+#define CX_FILE_BLOCK 65536
 
 #define cx_init_file_type(cx, name, ...)		\
   _cx_init_file_type(cx, name, ##__VA_ARGS__, NULL)	\
@@ -10,12 +14,18 @@ struct cx;
 struct cx_box;
 struct cx_lib;
 struct cx_type;
+struct cx_wqueue;
 
 struct cx_file {
   struct cx *cx;
   int fd;
   const char *mode;
   FILE *_ptr;
+  struct cx_wqueue *queue;
+  char *rbuf;
+  size_t rpos, rlen, rcapac;
+  int splice_fds[2];
+  size_t splice_len;
   unsigned int nrefs;
 };
 
@@ -33,6 +43,8 @@ struct cx_file *cx_file_deinit(struct cx_file *f);
 
 FILE *cx_file_ptr(struct cx_file *file);
 struct cx_iter *cx_file_iter(struct cx_box *v);
+ssize_t cx_file_fill(struct cx_file *file);
+void cx_file_drop(struct cx_file *file);
 bool cx_file_unblock(struct cx_file *file);
 bool cx_file_close(struct cx_file *file);
 
@@ -213,7 +213,7 @@ static bool emit_imp(struct cx_box *v, const char *exp, FILE *out) {
   struct cx_func *func = v->as_ptr;
   
   fprintf(out,
-	  "cx_box_init(%s, cx->func_type)->as_ptr = %s();\n",
+	  "cx_box_init(%s, cx->func_type)->as_ptr = %s(cx);\n",
 	  exp, func->emit_id);
 
   return true;
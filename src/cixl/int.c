@@ -6,6 +6,7 @@
 #include "cixl/emit.h"
 #include "cixl/error.h"
 #include "cixl/iter.h"
+#include "cixl/pack.h"
 #include "cixl/scope.h"
 #include "cixl/str.h"
 #include "cixl/int.h"
@@ -73,6 +74,20 @@ static bool emit_imp(struct cx_box *v, const char *exp, FILE *out) {
   return true;
 }
 
+static bool pack_imp(struct cx_box *v, struct cx_buf *out) {
+  cx_pack_int(out, v->as_int);
+  return true;
+}
+
+static bool unpack_imp(struct cx_type *t,
+		       struct cx_unpack *in,
+		       struct cx_box *out) {
+  int64_t v = 0;
+  if (!cx_unpack_int(in, &v)) { return false; }
+  cx_box_init(out, t)->as_int = v;
+  return true;
+}
+
 struct cx_type *cx_init_int_type(struct cx_lib *lib) {
   struct cx *cx = lib->cx;
   struct cx_type *t = cx_add_type(lib, "Int", cx->num_type, cx->seq_type);
@@ -83,5 +98,7 @@ struct cx_type *cx_init_int_type(struct cx_lib *lib) {
   t->write = dump_imp;
   t->dump = dump_imp;
   t->emit = emit_imp;  
+  t->pack = pack_imp;
+  t->unpack = unpack_imp;
   return t;
 }
@@ -1,16 +1,18 @@
 #ifndef CX_ITER_H
 #define CX_ITER_H
 
+#include <stdbool.h>
+
+#include "cixl/util.h"
+
 #define cx_iter_type(id, ...)			\
   struct cx_iter_type *id() {			\
     static struct cx_iter_type type;		\
-    static bool init = true;			\
 						\
-    if (init) {					\
-      init = false;				\
-      cx_iter_type_init(&type);			\
-      __VA_ARGS__;				\
-    }						\
+    cx_once({					\
+	cx_iter_type_init(&type);		\
+	__VA_ARGS__;				\
+      });					\
 						\
     return &type;				\
   }						\
@@ -24,6 +24,19 @@ static bool is_nil_imp(struct cx_scope *scope) {
   return true;
 }
 
+static bool freeze_imp(struct cx_scope *scope) {
+  struct cx_box *v = cx_test(cx_peek(scope, false));
+  return cx_freeze(v);
+}
+
+static bool is_frozen_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  struct cx_box v = *cx_test(cx_pop(scope, false));
+  cx_box_init(cx_push(scope), cx->bool_type)->as_bool = cx_is_frozen(&v);
+  cx_box_deinit(&v);
+  return true;
+}
+
 cx_lib(cx_init_abc, "cx/abc") { 
   struct cx *cx = lib->cx;
 
@@ -68,6 +81,14 @@ cx_lib(cx_init_abc, "cx/abc") {
   cx_add_cfunc(lib, "is-nil",
 	       cx_args(cx_arg("v", cx->opt_type)), cx_args(),
 	       is_nil_imp);
+
+  cx_add_cfunc(lib, "freeze",
+	       cx_args(cx_arg("v", cx->opt_type)), cx_args(cx_narg(NULL, 0)),
+	       freeze_imp);
+
+  cx_add_cfunc(lib, "is-frozen",
+	       cx_args(cx_arg("v", cx->opt_type)), cx_args(cx_arg(NULL, cx->bool_type)),
+	       is_frozen_imp);
   
   return true;
 }
@@ -6,6 +6,7 @@
 #include "cixl/cx.h"
 #include "cixl/box.h"
 #include "cixl/buf.h"
+#include "cixl/codec.h"
 #include "cixl/error.h"
 #include "cixl/fimp.h"
 #include "cixl/func.h"
@@ -13,7 +14,6 @@
 #include "cixl/iter.h"
 #include "cixl/lib.h"
 #include "cixl/lib/buf.h"
-#include "cixl/mfile.h"
 #include "cixl/scope.h"
 #include "cixl/str.h"
 
@@ -32,13 +32,20 @@ static bool len_imp(struct cx_scope *scope) {
   return true;
 }
 
+static bool compact_imp(struct cx_scope *scope) {
+  struct cx_box in = *cx_test(cx_pop(scope, false));
+  cx_buf_compact(cx_baseof(in.as_file, struct cx_buf, file));
+  cx_box_deinit(&in);
+  return true;
+}
+
 static bool str_imp(struct cx_scope *scope) {
   struct cx *cx = scope->cx;
   struct cx_box in = *cx_test(cx_pop(scope, false));
   struct cx_buf *b = cx_baseof(in.as_file, struct cx_buf, file);
-  fflush(b->file._ptr);
-  cx_box_init(cx_push(scope), cx->str_type)->as_str =
-    cx_str_new(b->data+b->pos, b->len-b->pos);
+  size_t len = cx_buf_len(b);
+  const char *data = cx_buf_view(b, &len);
+  cx_box_init(cx_push(scope), cx->str_type)->as_str = cx_str_new(data, len);
   cx_box_deinit(&in);
   return true;
 }
@@ -53,14 +60,24 @@ static bool read_bytes_imp(struct cx_scope *scope) {
     buf = *cx_test(cx_pop(scope, false));
 
   struct cx_buf *b = cx_baseof(buf.as_file, struct cx_buf, file);
-  size_t offs = ftell(b->file._ptr);
-  fseek(b->file._ptr, nbytes.as_int, SEEK_CUR);
-  fflush(b->file._ptr);
-  int rbytes = read(in.as_file->fd, b->data+offs, nbytes.as_int);
+  struct cx_file *f = in.as_file;
+  char *out = cx_buf_reserve(b, nbytes.as_int);
+
+  // Data already blocked by the reader goes first
+  if (f->rpos < f->rlen) {
+    size_t len = cx_min(f->rlen-f->rpos, (size_t)nbytes.as_int);
+    memcpy(out, f->rbuf+f->rpos, len);
+    f->rpos += len;
+    cx_buf_commit(b, len);
+    cx_box_init(cx_push(scope), cx->int_type)->as_int = len;
+    ok = true;
+    goto exit;
+  }
+  
+  int rbytes = read(f->fd, out, nbytes.as_int);
 
   if (!rbytes || (rbytes == -1 && errno == ECONNREFUSED)) {
     cx_box_init(cx_push(scope), cx->nil_type);
-    fseek(b->file._ptr, offs, SEEK_SET);
     ok = true;
     goto exit;
   }
@@ -72,6 +89,7 @@ static bool read_bytes_imp(struct cx_scope *scope) {
     goto exit;
   }
 
+  cx_buf_commit(b, rbytes);
   cx_box_init(cx_push(scope), cx->int_type)->as_int = rbytes;
   ok = true;
  exit:
@@ -89,15 +107,16 @@ static bool write_bytes_imp(struct cx_scope *scope) {
     buf = *cx_test(cx_pop(scope, false));
 
   struct cx_buf *b = cx_baseof(buf.as_file, struct cx_buf, file);  
-  int wbytes = write(out.as_file->fd, b->data+b->pos, b->len-b->pos);
+  size_t len = cx_buf_len(b);
+  const char *data = cx_buf_view(b, &len);
+  int wbytes = write(out.as_file->fd, data, len);
 
   if (wbytes == -1 && errno != EAGAIN) {
     cx_error(cx, cx->row, cx->col, "Failed writing: %d", errno);
     goto exit;
   }
 
-  b->pos += wbytes;
-  if (b->pos == b->len) { cx_buf_clear(b); }
+  if (wbytes > 0) { cx_buf_consume(b, wbytes); }
   ok = true;
  exit:
   cx_box_deinit(&buf);
@@ -105,6 +124,96 @@ static bool write_bytes_imp(struct cx_scope *scope) {
   return ok;
 }
 
+static size_t in_len(struct cx_box *in) {
+  struct cx *cx = in->type->lib->cx;
+  
+  return (in->type == cx->str_type)
+    ? in->as_str->len
+    : cx_buf_len(cx_baseof(in->as_file, struct cx_buf, file));
+}
+
+static const char *in_data(struct cx_box *in) {
+  struct cx *cx = in->type->lib->cx;
+  if (in->type == cx->str_type) { return in->as_str->data; }
+  struct cx_buf *b = cx_baseof(in->as_file, struct cx_buf, file);
+  size_t len = cx_buf_len(b);
+  return cx_buf_view(b, &len);
+}
+
+static bool hex_encode_imp(struct cx_scope *scope) {
+  struct cx_box
+    in = *cx_test(cx_pop(scope, false)),
+    out = *cx_test(cx_pop(scope, false));
+
+  struct cx_buf *b = cx_baseof(out.as_file, struct cx_buf, file);
+  size_t len = in_len(&in);
+  char *o = cx_buf_reserve(b, cx_hex_len(len));
+  cx_buf_commit(b, cx_hex_encode(in_data(&in), len, o));
+  cx_box_deinit(&in);
+  cx_box_deinit(&out);
+  return true;
+}
+
+static bool hex_decode_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  
+  struct cx_box
+    in = *cx_test(cx_pop(scope, false)),
+    out = *cx_test(cx_pop(scope, false));
+
+  struct cx_buf *b = cx_baseof(out.as_file, struct cx_buf, file);
+  size_t len = in_len(&in), out_len = 0;
+  char *o = cx_buf_reserve(b, len/2);
+  bool ok = cx_hex_decode(in_data(&in), len, o, &out_len);
+
+  if (ok) {
+    cx_buf_commit(b, out_len);
+  } else {
+    cx_error(cx, cx->row, cx->col, "Invalid hex data");
+  }
+  
+  cx_box_deinit(&in);
+  cx_box_deinit(&out);
+  return ok;
+}
+
+static bool base64_encode_imp(struct cx_scope *scope) {
+  struct cx_box
+    in = *cx_test(cx_pop(scope, false)),
+    out = *cx_test(cx_pop(scope, false));
+
+  struct cx_buf *b = cx_baseof(out.as_file, struct cx_buf, file);
+  size_t len = in_len(&in);
+  char *o = cx_buf_reserve(b, cx_base64_len(len));
+  cx_buf_commit(b, cx_base64_encode(in_data(&in), len, o));
+  cx_box_deinit(&in);
+  cx_box_deinit(&out);
+  return true;
+}
+
+static bool base64_decode_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  
+  struct cx_box
+    in = *cx_test(cx_pop(scope, false)),
+    out = *cx_test(cx_pop(scope, false));
+
+  struct cx_buf *b = cx_baseof(out.as_file, struct cx_buf, file);
+  size_t len = in_len(&in), out_len = 0;
+  char *o = cx_buf_reserve(b, len/4*3);
+  bool ok = cx_base64_decode(in_data(&in), len, o, &out_len);
+
+  if (ok) {
+    cx_buf_commit(b, out_len);
+  } else {
+    cx_error(cx, cx->row, cx->col, "Invalid base64 data");
+  }
+  
+  cx_box_deinit(&in);
+  cx_box_deinit(&out);
+  return ok;
+}
+
 cx_lib(cx_init_buf, "cx/io/buf") {    
   struct cx *cx = lib->cx;
     
@@ -123,6 +232,11 @@ cx_lib(cx_init_buf, "cx/io/buf") {
 	       cx_args(),
 	       clear_imp);
 
+  cx_add_cfunc(lib, "compact",
+	       cx_args(cx_arg("b", cx->buf_type)),
+	       cx_args(),
+	       compact_imp);
+
   cx_add_cfunc(lib, "len",
 	       cx_args(cx_arg("b", cx->buf_type)),
 	       cx_args(cx_arg(NULL, cx->int_type)),
@@ -146,5 +260,45 @@ cx_lib(cx_init_buf, "cx/io/buf") {
 	       cx_args(),
 	       write_bytes_imp);
 
+  cx_add_cfunc(lib, "hex-encode",
+	       cx_args(cx_arg("out", cx->buf_type), cx_arg("in", cx->str_type)),
+	       cx_args(),
+	       hex_encode_imp);
+
+  cx_add_cfunc(lib, "hex-encode",
+	       cx_args(cx_arg("out", cx->buf_type), cx_arg("in", cx->buf_type)),
+	       cx_args(),
+	       hex_encode_imp);
+
+  cx_add_cfunc(lib, "hex-decode",
+	       cx_args(cx_arg("out", cx->buf_type), cx_arg("in", cx->str_type)),
+	       cx_args(),
+	       hex_decode_imp);
+
+  cx_add_cfunc(lib, "hex-decode",
+	       cx_args(cx_arg("out", cx->buf_type), cx_arg("in", cx->buf_type)),
+	       cx_args(),
+	       hex_decode_imp);
+
+  cx_add_cfunc(lib, "base64-encode",
+	       cx_args(cx_arg("out", cx->buf_type), cx_arg("in", cx->str_type)),
+	       cx_args(),
+	       base64_encode_imp);
+
+  cx_add_cfunc(lib, "base64-encode",
+	       cx_args(cx_arg("out", cx->buf_type), cx_arg("in", cx->buf_type)),
+	       cx_args(),
+	       base64_encode_imp);
+
+  cx_add_cfunc(lib, "base64-decode",
+	       cx_args(cx_arg("out", cx->buf_type), cx_arg("in", cx->str_type)),
+	       cx_args(),
+	       base64_decode_imp);
+
+  cx_add_cfunc(lib, "base64-decode",
+	       cx_args(cx_arg("out", cx->buf_type), cx_arg("in", cx->buf_type)),
+	       cx_args(),
+	       base64_decode_imp);
+
   return true;
 }
@@ -0,0 +1,354 @@
+#include "cixl/arg.h"
+#include "cixl/cx.h"
+#include "cixl/db.h"
+#include "cixl/error.h"
+#include "cixl/fimp.h"
+#include "cixl/func.h"
+#include "cixl/lib.h"
+#include "cixl/lib/db.h"
+#include "cixl/scope.h"
+#include "cixl/stack.h"
+#include "cixl/str.h"
+#include "cixl/table.h"
+
+static bool get_syms(struct cx *cx, struct cx_box *in, struct cx_vec *out) {
+  struct cx_stack *s = in->as_ptr;
+  
+  cx_do_vec(&s->imp, struct cx_box, v) {
+    if (v->type != cx->sym_type) {
+      cx_error(cx, cx->row, cx->col, "Invalid field: %s", v->type->id);
+      return false;
+    }
+
+    *(struct cx_sym *)cx_vec_push(out) = v->as_sym;
+  }
+
+  return true;
+}
+
+static bool db_table_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  bool ok = false;
+  
+  struct cx_box
+    key = *cx_test(cx_pop(scope, false)),
+    path = *cx_test(cx_pop(scope, false));
+
+  struct cx_vec ids;
+  cx_vec_init(&ids, sizeof(struct cx_sym));
+  if (!get_syms(cx, &key, &ids)) { goto exit; }
+  
+  struct cx_db_table *t = cx_db_table_new(cx, cx_str_cstr(path.as_str), &ids);
+  if (!t) { goto exit; }
+  cx_box_init(cx_push(scope), cx->db_table_type)->as_ptr = t;
+  ok = true;
+ exit:
+  cx_vec_deinit(&ids);
+  cx_box_deinit(&key);
+  cx_box_deinit(&path);
+  return ok;
+}
+
+static bool upsert_imp(struct cx_scope *scope) {
+  struct cx_box
+    r = *cx_test(cx_pop(scope, false)),
+    t = *cx_test(cx_pop(scope, false));
+
+  cx_db_upsert(t.as_ptr, &r);
+  cx_box_deinit(&r);
+  cx_box_deinit(&t);
+  return true;
+}
+
+static bool delete_imp(struct cx_scope *scope) {
+  struct cx_box
+    k = *cx_test(cx_pop(scope, false)),
+    t = *cx_test(cx_pop(scope, false));
+
+  cx_db_delete(t.as_ptr, &k);
+  cx_box_deinit(&k);
+  cx_box_deinit(&t);
+  return true;
+}
+
+static bool find_key_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  
+  struct cx_box
+    k = *cx_test(cx_pop(scope, false)),
+    t = *cx_test(cx_pop(scope, false));
+
+  struct cx_box *r = cx_db_find(t.as_ptr, &k);
+
+  if (r) {
+    cx_clone(cx_push(scope), r);
+  } else {
+    cx_box_init(cx_push(scope), cx->nil_type);
+  }
+  
+  cx_box_deinit(&k);
+  cx_box_deinit(&t);
+  return true;
+}
+
+static bool get_key_imp(struct cx_scope *scope) {
+  struct cx_box
+    r = *cx_test(cx_pop(scope, false)),
+    t = *cx_test(cx_pop(scope, false));
+
+  cx_db_key(t.as_ptr, r.as_ptr, cx_push(scope));
+  cx_box_deinit(&r);
+  cx_box_deinit(&t);
+  return true;
+}
+
+static bool len_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  struct cx_box t = *cx_test(cx_pop(scope, false));
+  struct cx_db_table *dt = t.as_ptr;
+  
+  cx_box_init(cx_push(scope), cx->int_type)->as_int =
+    dt->recs->entries.members.count;
+  
+  cx_box_deinit(&t);
+  return true;
+}
+
+static bool add_index_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  
+  struct cx_box
+    fields = *cx_test(cx_pop(scope, false)),
+    id = *cx_test(cx_pop(scope, false)),
+    t = *cx_test(cx_pop(scope, false));
+
+  struct cx_vec fs;
+  cx_vec_init(&fs, sizeof(struct cx_sym));
+  
+  bool ok =
+    get_syms(cx, &fields, &fs) &&
+    cx_db_add_index(t.as_ptr, id.as_sym, &fs);
+
+  cx_vec_deinit(&fs);
+  cx_box_deinit(&fields);
+  cx_box_deinit(&t);
+  return ok;
+}
+
+static struct cx_db_index *get_index(struct cx *cx,
+				     struct cx_db_table *t,
+				     struct cx_sym id) {
+  struct cx_db_index *idx = cx_db_get_index(t, id);
+
+  if (!idx) {
+    cx_error(cx, cx->row, cx->col, "Unknown index: %s", id.id);
+  }
+
+  return idx;
+}
+
+static bool check_bound(struct cx *cx, struct cx_box *b) {
+  if (b->type != cx->nil_type && b->type != cx->stack_type) {
+    cx_error(cx, cx->row, cx->col, "Invalid index bound: %s", b->type->id);
+    return false;
+  }
+
+  return true;
+}
+
+static bool index_scan_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  
+  struct cx_box
+    max = *cx_test(cx_pop(scope, false)),
+    min = *cx_test(cx_pop(scope, false)),
+    id = *cx_test(cx_pop(scope, false)),
+    t = *cx_test(cx_pop(scope, false));
+
+  bool ok = false;
+  struct cx_db_index *idx = NULL;
+
+  if (!check_bound(cx, &min) || !check_bound(cx, &max)) { goto exit; }
+  idx = get_index(cx, t.as_ptr, id.as_sym);
+  if (!idx) { goto exit; }
+  
+  cx_box_init(cx_push(scope), cx->iter_type)->as_iter =
+    cx_db_index_scan(t.as_ptr,
+		     idx,
+		     (min.type == cx->nil_type) ? NULL : &min,
+		     (max.type == cx->nil_type) ? NULL : &max);
+
+  ok = true;
+ exit:
+  cx_box_deinit(&max);
+  cx_box_deinit(&min);
+  cx_box_deinit(&t);
+  return ok;
+}
+
+static bool index_find_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  
+  struct cx_box
+    v = *cx_test(cx_pop(scope, false)),
+    id = *cx_test(cx_pop(scope, false)),
+    t = *cx_test(cx_pop(scope, false));
+
+  struct cx_db_index *idx = get_index(cx, t.as_ptr, id.as_sym);
+
+  if (idx) {
+    cx_box_init(cx_push(scope), cx->iter_type)->as_iter =
+      cx_db_index_scan(t.as_ptr, idx, &v, &v);
+  }
+  
+  cx_box_deinit(&v);
+  cx_box_deinit(&t);
+  return idx;
+}
+
+static bool commit_imp(struct cx_scope *scope) {
+  struct cx_box t = *cx_test(cx_pop(scope, false));
+  bool ok = cx_db_commit(t.as_ptr);
+  cx_box_deinit(&t);
+  return ok;
+}
+
+static bool rollback_imp(struct cx_scope *scope) {
+  struct cx_box t = *cx_test(cx_pop(scope, false));
+  cx_db_rollback(t.as_ptr);
+  cx_box_deinit(&t);
+  return true;
+}
+
+static bool sync_imp(struct cx_scope *scope) {
+  struct cx_box t = *cx_test(cx_pop(scope, false));
+  bool ok = cx_db_sync(t.as_ptr);
+  cx_box_deinit(&t);
+  return ok;
+}
+
+static bool compact_imp(struct cx_scope *scope) {
+  struct cx_box t = *cx_test(cx_pop(scope, false));
+  bool ok = cx_db_compact(t.as_ptr);
+  cx_box_deinit(&t);
+  return ok;
+}
+
+static bool sync_every_imp(struct cx_scope *scope) {
+  struct cx_box
+    n = *cx_test(cx_pop(scope, false)),
+    t = *cx_test(cx_pop(scope, false));
+
+  struct cx_db_table *dt = t.as_ptr;
+  dt->sync_every = cx_max(n.as_int, 0);
+  cx_box_deinit(&t);
+  return true;
+}
+
+static bool compact_every_imp(struct cx_scope *scope) {
+  struct cx_box
+    n = *cx_test(cx_pop(scope, false)),
+    t = *cx_test(cx_pop(scope, false));
+
+  struct cx_db_table *dt = t.as_ptr;
+  dt->compact_len = cx_max(n.as_int, 0);
+  cx_box_deinit(&t);
+  return true;
+}
+
+cx_lib(cx_init_db, "cx/db") {    
+  struct cx *cx = lib->cx;
+    
+  if (!cx_use(cx, "cx/abc", "Int", "Iter", "Opt", "Seq", "Str", "Sym") ||
+      !cx_use(cx, "cx/io/buf", "Buf") ||
+      !cx_use(cx, "cx/rec", "Rec") ||
+      !cx_use(cx, "cx/stack", "Stack")) {
+    return false;
+  }
+
+  cx->db_table_type = cx_init_db_table_type(lib);
+
+  cx_add_cfunc(lib, "db-table",
+	       cx_args(cx_arg("path", cx->str_type), cx_arg("key", cx->stack_type)),
+	       cx_args(cx_arg(NULL, cx->db_table_type)),
+	       db_table_imp);
+
+  cx_add_cfunc(lib, "upsert",
+	       cx_args(cx_arg("t", cx->db_table_type), cx_arg("r", cx->rec_type)),
+	       cx_args(),
+	       upsert_imp);
+
+  cx_add_cfunc(lib, "delete",
+	       cx_args(cx_arg("t", cx->db_table_type), cx_arg("k", cx->stack_type)),
+	       cx_args(),
+	       delete_imp);
+
+  cx_add_cfunc(lib, "find-key",
+	       cx_args(cx_arg("t", cx->db_table_type), cx_arg("k", cx->stack_type)),
+	       cx_args(cx_arg(NULL, cx->opt_type)),
+	       find_key_imp);
+
+  cx_add_cfunc(lib, "get-rec-key",
+	       cx_args(cx_arg("t", cx->db_table_type), cx_arg("r", cx->rec_type)),
+	       cx_args(cx_arg(NULL, cx->stack_type)),
+	       get_key_imp);
+
+  cx_add_cfunc(lib, "len",
+	       cx_args(cx_arg("t", cx->db_table_type)),
+	       cx_args(cx_arg(NULL, cx->int_type)),
+	       len_imp);
+
+  cx_add_cfunc(lib, "add-index",
+	       cx_args(cx_arg("t", cx->db_table_type),
+		       cx_arg("id", cx->sym_type),
+		       cx_arg("fields", cx->stack_type)),
+	       cx_args(),
+	       add_index_imp);
+
+  cx_add_cfunc(lib, "index-scan",
+	       cx_args(cx_arg("t", cx->db_table_type),
+		       cx_arg("id", cx->sym_type),
+		       cx_arg("min", cx->opt_type),
+		       cx_arg("max", cx->opt_type)),
+	       cx_args(cx_arg(NULL, cx->iter_type)),
+	       index_scan_imp);
+
+  cx_add_cfunc(lib, "index-find",
+	       cx_args(cx_arg("t", cx->db_table_type),
+		       cx_arg("id", cx->sym_type),
+		       cx_arg("v", cx->stack_type)),
+	       cx_args(cx_arg(NULL, cx->iter_type)),
+	       index_find_imp);
+
+  cx_add_cfunc(lib, "commit",
+	       cx_args(cx_arg("t", cx->db_table_type)),
+	       cx_args(),
+	       commit_imp);
+
+  cx_add_cfunc(lib, "rollback",
+	       cx_args(cx_arg("t", cx->db_table_type)),
+	       cx_args(),
+	       rollback_imp);
+
+  cx_add_cfunc(lib, "sync",
+	       cx_args(cx_arg("t", cx->db_table_type)),
+	       cx_args(),
+	       sync_imp);
+
+  cx_add_cfunc(lib, "compact",
+	       cx_args(cx_arg("t", cx->db_table_type)),
+	       cx_args(),
+	       compact_imp);
+
+  cx_add_cfunc(lib, "sync-every",
+	       cx_args(cx_arg("t", cx->db_table_type), cx_arg("n", cx->int_type)),
+	       cx_args(),
+	       sync_every_imp);
+
+  cx_add_cfunc(lib, "compact-every",
+	       cx_args(cx_arg("t", cx->db_table_type), cx_arg("n", cx->int_type)),
+	       cx_args(),
+	       compact_every_imp);
+
+  return true;
+}
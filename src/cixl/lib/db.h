@@ -0,0 +1,9 @@
+#ifndef CX_LIB_DB_H
+#define CX_LIB_DB_H
+
+struct cx;
+struct cx_lib;
+
+struct cx_lib *cx_init_db(struct cx *cx);
+
+#endif
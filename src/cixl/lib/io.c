@@ -1,5 +1,9 @@
+#define _GNU_SOURCE
+
 #include <errno.h>
+#include <fcntl.h>
 #include <string.h>
+#include <sys/sendfile.h>
 #include <termios.h>
 #include <unistd.h>
 
@@ -17,6 +21,7 @@
 #include "cixl/lib/io.h"
 #include "cixl/scope.h"
 #include "cixl/str.h"
+#include "cixl/wqueue.h"
 
 static ssize_t include_eval(struct cx_macro_eval *eval,
 			    struct cx_bin *bin,
@@ -77,8 +82,6 @@ static bool include_parse(struct cx *cx, FILE *in, struct cx_vec *out) {
 struct line_iter {
   struct cx_iter iter;
   struct cx_file *in;
-  char *line;
-  size_t len; 
 };
 
 static bool line_next(struct cx_iter *iter,
@@ -86,29 +89,51 @@ static bool line_next(struct cx_iter *iter,
 		      struct cx_scope *scope) {
   struct cx *cx = scope->cx;
   struct line_iter *it = cx_baseof(iter, struct line_iter, iter);
-  FILE *fptr = cx_file_ptr(it->in);
+  struct cx_file *f = it->in;
+  size_t len = 0;
+  bool eof = false;
+
+  while (true) {
+    const char *start = f->rbuf+f->rpos;
+    const char *eol = memchr(start+len, '\n', f->rlen-f->rpos-len);
     
-  if (!cx_get_line(&it->line, &it->len, cx_file_ptr(it->in))) {
-    if (feof(fptr)) {
-      iter->done = true;
-      return false;
-    } else if (errno == EAGAIN) {
-      cx_box_init(out, cx->nil_type);
-    } else {
+    if (eol) {
+      len = eol-start;
+      break;
+    }
+
+    len = f->rlen-f->rpos;
+    ssize_t rlen = cx_file_fill(f);
+
+    if (!rlen) {
+      eof = true;
+      break;
+    }
+    
+    if (rlen == -1) {
+      if (errno == EAGAIN) {
+	cx_box_init(out, cx->nil_type);
+	return true;
+      }
+      
       cx_error(cx, cx->row, cx->col, "Failed reading line: %d", errno);
       return false;
     }
-  } else {
-    cx_box_init(out, cx->str_type)->as_str = cx_str_new(it->line, strlen(it->line));
+  }
+
+  if (eof && !len) {
+    iter->done = true;
+    return false;
   }
   
+  cx_box_init(out, cx->str_type)->as_str = cx_str_new(f->rbuf+f->rpos, len);
+  f->rpos += eof ? len : len+1;
   return true;
 }
 
 static void *line_deinit(struct cx_iter *iter) {
   struct line_iter *it = cx_baseof(iter, struct line_iter, iter);
   cx_file_deref(it->in);
-  if (it->line) { free(it->line); }
   return it;
 }
 
@@ -121,8 +146,6 @@ static struct cx_iter *line_iter_new(struct cx_file *in) {
   struct line_iter *it = malloc(sizeof(struct line_iter));
   cx_iter_init(&it->iter, line_iter());
   it->in = cx_file_ref(in);
-  it->line = NULL;
-  it->len = 0;
   return &it->iter;
 }
 
@@ -177,6 +200,7 @@ static struct cx_iter *reverse_iter_new(struct cx_file *in) {
   struct reverse_iter *it = malloc(sizeof(struct reverse_iter));
   cx_iter_init(&it->iter, reverse_iter());
   it->in = cx_file_ref(in);
+  cx_file_drop(in);
   FILE *fptr = cx_file_ptr(in);
   fseek(fptr, 0, SEEK_END);
   it->offs = ftell(cx_file_ptr(in));
@@ -252,11 +276,18 @@ static bool print_imp(struct cx_scope *scope) {
   struct cx_box
     v = *cx_test(cx_pop(scope, false)),
     out = *cx_test(cx_pop(scope, false));
+
+  bool ok = true;
+  
+  if (out.as_file->queue) {
+    ok = cx_file_enqueue(out.as_file, &v, true);
+  } else {
+    cx_print(&v, cx_file_ptr(out.as_file));
+  }
   
-  cx_print(&v, cx_file_ptr(out.as_file));
   cx_box_deinit(&v);
   cx_box_deinit(&out);
-  return true;
+  return ok;
 }
 
 static bool load_imp(struct cx_scope *scope) {
@@ -264,7 +295,7 @@ static bool load_imp(struct cx_scope *scope) {
   struct cx_box p = *cx_test(cx_pop(scope, false));
   struct cx_bin *bin = cx_bin_new();
   struct cx_lib *lib = cx_pop_lib(cx);
-  bool ok = cx_load(cx, p.as_str->data, bin) && cx_eval(bin, 0, -1, cx);
+  bool ok = cx_load(cx, cx_str_cstr(p.as_str), bin) && cx_eval(bin, 0, -1, cx);
   cx_push_lib(cx, lib);
   cx_bin_deref(bin);
   cx_box_deinit(&p);
@@ -289,7 +320,7 @@ static bool fopen_imp(struct cx_scope *scope) {
     goto exit;
   }
 
-  FILE *f = fopen(p.as_str->data, m.as_sym.id);
+  FILE *f = fopen(cx_str_cstr(p.as_str), m.as_sym.id);
 
   if (f) {
     cx_box_init(cx_push(scope), ft)->as_file = cx_file_new(cx, fileno(f), NULL, f);
@@ -319,10 +350,15 @@ static bool unblock_imp(struct cx_scope *scope) {
 }
 
 static bool flush_imp(struct cx_scope *scope) {
-  struct cx_box *f = cx_test(cx_pop(scope, false));
+  struct cx_box f = *cx_test(cx_pop(scope, false));
   bool ok = false;
+
+  if (f.as_file->queue) {
+    ok = cx_file_flush(f.as_file);
+    goto exit;
+  }
   
-  if (f->as_file->_ptr && fflush(f->as_file->_ptr)) {
+  if (f.as_file->_ptr && fflush(f.as_file->_ptr)) {
     struct cx *cx = scope->cx;
     cx_error(cx, cx->row, cx->col, "Failed flushing file: %d", errno);
     goto exit;
@@ -330,7 +366,7 @@ static bool flush_imp(struct cx_scope *scope) {
 
   ok = true;
  exit:
-  cx_box_deinit(f);
+  cx_box_deinit(&f);
   return ok;
 }
 
@@ -342,6 +378,8 @@ static bool seek_imp(struct cx_scope *scope) {
     pos = *cx_test(cx_pop(scope, false)),
     f = *cx_test(cx_pop(scope, false));
   
+  cx_file_drop(f.as_file);
+  
   if (fseek(cx_file_ptr(f.as_file), pos.as_int, SEEK_SET) == -1) {
     cx_error(cx, cx->row, cx->col, "Failed seeking: %d", errno);
     goto exit;
@@ -365,6 +403,8 @@ static bool tell_imp(struct cx_scope *scope) {
     goto exit;
   }
 
+  // Blocked data has been read from the file but not consumed
+  pos -= f.as_file->rlen - f.as_file->rpos;
   cx_box_init(cx_push(scope), cx->int_type)->as_int = pos;
   ok = true;
  exit:
@@ -392,21 +432,60 @@ static bool read_imp(struct cx_scope *scope) {
 static bool read_char_imp(struct cx_scope *scope) {
   struct cx *cx = scope->cx;
   struct cx_box f = *cx_test(cx_pop(scope, false));
-  int c = fgetc(cx_file_ptr(f.as_file));
+  struct cx_file *in = f.as_file;
   bool ok = false;
   
-  if (c == EOF) {
-    if (errno == EAGAIN) {
+  if (in->rpos == in->rlen) {
+    ssize_t len = cx_file_fill(in);
+    
+    if (len < 1) {
+      if (len == -1 && errno != EAGAIN) {
+	cx_error(cx, cx->row, cx->col, "Failed reading char: %d", errno);
+      } else {
+	cx_box_init(cx_push(scope), cx->nil_type);
+	ok = true;
+      }
+      
+      goto exit;
+    }
+  }
+      
+  cx_box_init(cx_push(scope), cx->char_type)->as_char = in->rbuf[in->rpos++];
+  ok = true;
+ exit:
+  cx_box_deinit(&f);
+  return ok;
+}
+
+static bool read_block_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  bool ok = false;
+  
+  struct cx_box
+    n = *cx_test(cx_pop(scope, false)),
+    f = *cx_test(cx_pop(scope, false));
+
+  struct cx_file *in = f.as_file;
+  
+  if (in->rpos == in->rlen) {
+    ssize_t len = cx_file_fill(in);
+
+    if (!len) {
       cx_box_init(cx_push(scope), cx->nil_type);
       ok = true;
-    } else {
-      cx_error(cx, cx->row, cx->col, "Failed reading char: %d", errno);
+      goto exit;
     }
     
-    goto exit;
+    if (len == -1 && errno != EAGAIN) {
+      cx_error(cx, cx->row, cx->col, "Failed reading: %d", errno);
+      goto exit;
+    }
   }
-      
-  cx_box_init(cx_push(scope), cx->char_type)->as_char = c;
+
+  size_t len = cx_min(in->rlen-in->rpos, (size_t)cx_max(n.as_int, 0));
+  cx_box_init(cx_push(scope), cx->str_type)->as_str =
+    cx_str_new(in->rbuf+in->rpos, len);
+  in->rpos += len;
   ok = true;
  exit:
   cx_box_deinit(&f);
@@ -418,8 +497,10 @@ static bool write_imp(struct cx_scope *scope) {
     v = *cx_test(cx_pop(scope, false)),
     out = *cx_test(cx_pop(scope, false));
 
-  FILE *f = cx_file_ptr(out.as_file);
-  bool ok = cx_write(&v, f);
+  bool ok = out.as_file->queue
+    ? cx_file_enqueue(out.as_file, &v, false)
+    : cx_write(&v, cx_file_ptr(out.as_file));
+  
   cx_box_deinit(&v);
   cx_box_deinit(&out);
   return ok;
@@ -441,6 +522,182 @@ static bool reverse_imp(struct cx_scope *scope) {
   return true;
 }
 
+static bool queue_writes_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  
+  struct cx_box
+    a = *cx_test(cx_pop(scope, false)),
+    high = *cx_test(cx_pop(scope, false)),
+    f = *cx_test(cx_pop(scope, false));
+
+  bool ok = cx_file_queue(f.as_file,
+			  high.as_int,
+			  (a.type == cx->nil_type) ? NULL : &a);
+  
+  cx_box_deinit(&a);
+  cx_box_deinit(&f);
+  return ok;
+}
+
+static bool queued_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  struct cx_box f = *cx_test(cx_pop(scope, false));
+  struct cx_wqueue *q = f.as_file->queue;
+  cx_box_init(cx_push(scope), cx->int_type)->as_int = q ? q->len : 0;
+  cx_box_deinit(&f);
+  return true;
+}
+
+static bool sync_file(struct cx *cx, struct cx_file *f) {
+  // Buffered data has to go out, or be given back, before the fd is used
+  if (f->queue && f->queue->len && !cx_file_flush(f)) { return false; }
+
+  if (f->_ptr && fflush(f->_ptr)) {
+    cx_error(cx, cx->row, cx->col, "Failed flushing file: %d", errno);
+    return false;
+  }
+
+  return true;
+}
+
+static ssize_t send_buffered(struct cx_file *in, struct cx_file *out, int64_t n) {
+  // Data already pulled in by the block reader goes out before the fd is used
+  size_t len = cx_min((size_t)n, in->rlen-in->rpos);
+  ssize_t wlen = write(out->fd, in->rbuf+in->rpos, len);
+  if (wlen == -1 && errno == EAGAIN) { wlen = 0; }
+  if (wlen > 0) { in->rpos += wlen; }
+  return wlen;
+}
+
+static bool send_file_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  bool ok = false;
+  
+  struct cx_box
+    n = *cx_test(cx_pop(scope, false)),
+    in = *cx_test(cx_pop(scope, false)),
+    out = *cx_test(cx_pop(scope, false));
+
+  if (!sync_file(cx, out.as_file) || !sync_file(cx, in.as_file)) { goto exit; }
+
+  if (out.as_file->queue && out.as_file->queue->len) {
+    cx_box_init(cx_push(scope), cx->int_type)->as_int = 0;
+    ok = true;
+    goto exit;
+  }
+
+  struct cx_file *inf = in.as_file;
+  
+  ssize_t len = (inf->rpos < inf->rlen)
+    ? send_buffered(inf, out.as_file, n.as_int)
+    : sendfile(out.as_file->fd, inf->fd, NULL, n.as_int);
+
+  if (!len) {
+    cx_box_init(cx_push(scope), cx->nil_type);
+    ok = true;
+    goto exit;
+  }
+  
+  if (len == -1 && errno == EAGAIN) { len = 0; }
+
+  if (len == -1) {
+    cx_error(cx, cx->row, cx->col, "Failed sending file: %d", errno);
+    goto exit;
+  }
+
+  cx_box_init(cx_push(scope), cx->int_type)->as_int = len;
+  ok = true;
+ exit:
+  cx_box_deinit(&in);
+  cx_box_deinit(&out);
+  return ok;
+}
+
+static bool splice_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  bool ok = false;
+  
+  struct cx_box
+    n = *cx_test(cx_pop(scope, false)),
+    in = *cx_test(cx_pop(scope, false)),
+    out = *cx_test(cx_pop(scope, false));
+
+  struct cx_file *of = out.as_file;
+  if (!sync_file(cx, of) || !sync_file(cx, in.as_file)) { goto exit; }
+
+  if (of->queue && of->queue->len) {
+    cx_box_init(cx_push(scope), cx->int_type)->as_int = 0;
+    ok = true;
+    goto exit;
+  }
+  
+  if (of->splice_fds[0] == -1 &&
+      pipe2(of->splice_fds, O_NONBLOCK | O_CLOEXEC) == -1) {
+    cx_error(cx, cx->row, cx->col, "Failed creating pipe: %d", errno);
+    goto exit;
+  }
+
+  struct cx_file *inf = in.as_file;
+
+  // Bytes left in the pipe by previous calls go out before reading more,
+  // and so does data already pulled in by the block reader
+  if (!of->splice_len && inf->rpos < inf->rlen) {
+    ssize_t len = send_buffered(inf, of, n.as_int);
+
+    if (len == -1) {
+      cx_error(cx, cx->row, cx->col, "Failed splicing: %d", errno);
+      goto exit;
+    }
+    
+    cx_box_init(cx_push(scope), cx->int_type)->as_int = len;
+    ok = true;
+    goto exit;
+  }
+  
+  if (!of->splice_len) {
+    ssize_t len = splice(inf->fd, NULL, of->splice_fds[1], NULL, n.as_int,
+			 SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    
+    if (!len) {
+      cx_box_init(cx_push(scope), cx->nil_type);
+      ok = true;
+      goto exit;
+    }
+    
+    if (len == -1 && errno == EAGAIN) { len = 0; }
+    
+    if (len == -1) {
+      cx_error(cx, cx->row, cx->col, "Failed splicing: %d", errno);
+      goto exit;
+    }
+
+    of->splice_len = len;
+  }
+
+  ssize_t wlen = 0;
+  
+  if (of->splice_len) {
+    wlen = splice(of->splice_fds[0], NULL, of->fd, NULL, of->splice_len,
+		  SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    
+    if (wlen == -1 && errno == EAGAIN) { wlen = 0; }
+
+    if (wlen == -1) {
+      cx_error(cx, cx->row, cx->col, "Failed splicing: %d", errno);
+      goto exit;
+    }
+
+    of->splice_len -= wlen;
+  }
+  
+  cx_box_init(cx_push(scope), cx->int_type)->as_int = wlen;
+  ok = true;
+ exit:
+  cx_box_deinit(&in);
+  cx_box_deinit(&out);
+  return ok;
+}
+
 cx_lib(cx_init_io, "cx/io") {    
   struct cx *cx = lib->cx;
     
@@ -511,11 +768,42 @@ cx_lib(cx_init_io, "cx/io") {
 	       cx_args(cx_arg(NULL, cx->char_type)),
 	       read_char_imp);
 
+  cx_add_cfunc(lib, "read-block",
+	       cx_args(cx_arg("f", cx->rfile_type), cx_arg("n", cx->int_type)),
+	       cx_args(cx_arg(NULL, cx->opt_type)),
+	       read_block_imp);
+
   cx_add_cfunc(lib, "write",
 	       cx_args(cx_arg("f", cx->wfile_type), cx_arg("v", cx->opt_type)),
 	       cx_args(),
 	       write_imp);
 
+  cx_add_cfunc(lib, "queue-writes",
+	       cx_args(cx_arg("f", cx->wfile_type),
+		       cx_arg("high", cx->int_type),
+		       cx_arg("a", cx->opt_type)),
+	       cx_args(),
+	       queue_writes_imp);
+
+  cx_add_cfunc(lib, "queued",
+	       cx_args(cx_arg("f", cx->wfile_type)),
+	       cx_args(cx_arg(NULL, cx->int_type)),
+	       queued_imp);
+
+  cx_add_cfunc(lib, "send-file",
+	       cx_args(cx_arg("out", cx->wfile_type),
+		       cx_arg("in", cx->rfile_type),
+		       cx_arg("n", cx->int_type)),
+	       cx_args(cx_arg(NULL, cx->opt_type)),
+	       send_file_imp);
+
+  cx_add_cfunc(lib, "splice",
+	       cx_args(cx_arg("out", cx->wfile_type),
+		       cx_arg("in", cx->rfile_type),
+		       cx_arg("n", cx->int_type)),
+	       cx_args(cx_arg(NULL, cx->opt_type)),
+	       splice_imp);
+
   cx_add_cfunc(lib, "lines",
 	       cx_args(cx_arg("f", cx->rfile_type)),
 	       cx_args(cx_arg(NULL, cx->iter_type)),
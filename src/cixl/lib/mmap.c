@@ -0,0 +1,73 @@
+#include <errno.h>
+
+#include "cixl/arg.h"
+#include "cixl/cx.h"
+#include "cixl/error.h"
+#include "cixl/fimp.h"
+#include "cixl/func.h"
+#include "cixl/lib.h"
+#include "cixl/lib/mmap.h"
+#include "cixl/mmap.h"
+#include "cixl/scope.h"
+#include "cixl/str.h"
+
+static bool mmap_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  struct cx_box p = *cx_test(cx_pop(scope, false));
+  struct cx_str *s = cx_mmap(cx_str_cstr(p.as_str));
+
+  if (s) {
+    cx_box_init(cx_push(scope), cx->mfile_type)->as_str = s;
+  } else {
+    cx_error(cx, cx->row, cx->col, "Failed mapping file: %d", errno);
+  }
+  
+  cx_box_deinit(&p);
+  return s;
+}
+
+static bool len_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  struct cx_box f = *cx_test(cx_pop(scope, false));
+  cx_box_init(cx_push(scope), cx->int_type)->as_int = f.as_str->len;
+  cx_box_deinit(&f);
+  return true;
+}
+
+static bool str_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  struct cx_box f = *cx_test(cx_pop(scope, false));
+  
+  cx_box_init(cx_push(scope), cx->str_type)->as_str =
+    cx_str_slice(f.as_str, 0, f.as_str->len);
+  
+  cx_box_deinit(&f);
+  return true;
+}
+
+cx_lib(cx_init_mmap, "cx/io/mmap") {    
+  struct cx *cx = lib->cx;
+    
+  if (!cx_use(cx, "cx/abc", "Int", "Seq", "Str")) {
+    return false;
+  }
+
+  cx->mfile_type = cx_init_mfile_type(lib);
+  
+  cx_add_cfunc(lib, "mmap",
+	       cx_args(cx_arg("p", cx->str_type)),
+	       cx_args(cx_arg(NULL, cx->mfile_type)),
+	       mmap_imp);
+
+  cx_add_cfunc(lib, "len",
+	       cx_args(cx_arg("f", cx->mfile_type)),
+	       cx_args(cx_arg(NULL, cx->int_type)),
+	       len_imp);
+
+  cx_add_cfunc(lib, "str",
+	       cx_args(cx_arg("f", cx->mfile_type)),
+	       cx_args(cx_arg(NULL, cx->str_type)),
+	       str_imp);
+
+  return true;
+}
@@ -0,0 +1,9 @@
+#ifndef CX_LIB_MMAP_H
+#define CX_LIB_MMAP_H
+
+struct cx;
+struct cx_lib;
+
+struct cx_lib *cx_init_mmap(struct cx *cx);
+
+#endif
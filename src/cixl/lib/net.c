@@ -1,7 +1,11 @@
+#define _GNU_SOURCE
+
 #include <arpa/inet.h>
 #include <errno.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <poll.h>
+#include <string.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <unistd.h>
@@ -12,18 +16,54 @@
 #include "cixl/file.h"
 #include "cixl/lib.h"
 #include "cixl/lib/net.h"
+#include "cixl/pair.h"
 #include "cixl/scope.h"
+#include "cixl/stack.h"
 #include "cixl/str.h"
 
-static bool listen_imp(struct cx_scope *scope) {
-  struct cx *cx = scope->cx;
+static bool set_opt(struct cx *cx, int fd, struct cx_box *opt) {
+  struct cx_box *id = opt, *v = NULL;
+
+  if (opt->type == cx->pair_type) {
+    id = &opt->as_pair->x;
+    v = &opt->as_pair->y;
+  }
+
+  if (id->type != cx->sym_type || (v && v->type != cx->int_type)) {
+    cx_error(cx, cx->row, cx->col, "Invalid socket option");
+    return false;
+  }
+
+  int level = IPPROTO_TCP, name = -1, val = v ? v->as_int : 1;
+  const char *sid = id->as_sym.id;
   
-  struct cx_box
-    backlog = *cx_test(cx_pop(scope, false)),
-    port = *cx_test(cx_pop(scope, false)),
-    host = *cx_test(cx_pop(scope, false));
+  if (strcmp(sid, "reuse-port") == 0) {
+    level = SOL_SOCKET;
+    name = SO_REUSEPORT;
+  } else if (strcmp(sid, "no-delay") == 0) {
+    name = TCP_NODELAY;
+  } else if (strcmp(sid, "defer-accept") == 0) {
+    name = TCP_DEFER_ACCEPT;
+  } else {
+    cx_error(cx, cx->row, cx->col, "Unknown socket option: %s", sid);
+    return false;
+  }
 
-  int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  if (setsockopt(fd, level, name, &val, sizeof(int)) == -1) {
+    cx_error(cx, cx->row, cx->col, "Failed setting %s: %d", sid, errno);
+    return false;
+  }
+
+  return true;
+}
+
+static bool listen_socket(struct cx_scope *scope,
+			  struct cx_box *host,
+			  struct cx_box *port,
+			  struct cx_box *backlog,
+			  struct cx_stack *opts) {
+  struct cx *cx = scope->cx;
+  int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
   bool ok = false;
   
   if (fd == -1) {
@@ -35,20 +75,26 @@ static bool listen_imp(struct cx_scope *scope) {
     cx_error(cx, cx->row, cx->col, "Failed enabling socket reuse: %d", errno);
     goto exit;
   }
+
+  if (opts) {
+    cx_do_vec(&opts->imp, struct cx_box, o) {
+      if (!set_opt(cx, fd, o)) { goto exit; }
+    }
+  }
   
   struct sockaddr_in addr = {0};
   addr.sin_family = AF_INET;
-  addr.sin_port = htons(port.as_int);
-  addr.sin_addr.s_addr = (host.type == cx->nil_type)
+  addr.sin_port = htons(port->as_int);
+  addr.sin_addr.s_addr = (host->type == cx->nil_type)
     ? INADDR_ANY
-    : inet_addr(host.as_str->data);
+    : inet_addr(cx_str_cstr(host->as_str));
   
   if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
     cx_error(cx, cx->row, cx->col, "Failed binding socket: %d", errno);
     goto exit;
   }
 
-  if (listen(fd, backlog.as_int) == -1) {
+  if (listen(fd, backlog->as_int) == -1) {
     cx_error(cx, cx->row, cx->col, "Failed listening on socket: %d", errno);
     goto exit;
   }
@@ -57,31 +103,81 @@ static bool listen_imp(struct cx_scope *scope) {
   cx_box_init(cx_push(scope), scope->cx->tcp_server_type)->as_file = f;
   ok = true;
  exit:
-  if (!ok) { close(fd); }
+  if (!ok && fd != -1) { close(fd); }
+  return ok;
+}
+
+static bool listen_imp(struct cx_scope *scope) {
+  struct cx_box
+    backlog = *cx_test(cx_pop(scope, false)),
+    port = *cx_test(cx_pop(scope, false)),
+    host = *cx_test(cx_pop(scope, false));
+
+  bool ok = listen_socket(scope, &host, &port, &backlog, NULL);
+  cx_box_deinit(&host);
+  return ok;
+}
+
+static bool listen_with_imp(struct cx_scope *scope) {
+  struct cx_box
+    opts = *cx_test(cx_pop(scope, false)),
+    backlog = *cx_test(cx_pop(scope, false)),
+    port = *cx_test(cx_pop(scope, false)),
+    host = *cx_test(cx_pop(scope, false));
+
+  bool ok = listen_socket(scope, &host, &port, &backlog, opts.as_ptr);
+  cx_box_deinit(&opts);
   cx_box_deinit(&host);
   return ok;
 }
 
+static int accept_fd(struct cx_file *server) {
+  for (;;) {
+    int fd = accept4(server->fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd != -1 || (errno != EINTR && errno != ECONNABORTED)) { return fd; }
+  }
+}
+
 static bool accept_imp(struct cx_scope *scope) {
   struct cx *cx = scope->cx;
   struct cx_box server = *cx_test(cx_pop(scope, false));
-  int fd = accept(server.as_file->fd, NULL, NULL);
-  bool ok = false;
+  int fd = accept_fd(server.as_file);
   
   if (fd == -1) {
     cx_box_init(cx_push(scope), cx->nil_type);
   } else {
-    struct cx_file *f = cx_file_new(cx, fd, "r+", NULL);
-    if (!cx_file_unblock(f)) { goto exit; }
-    cx_box_init(cx_push(scope), cx->tcp_client_type)->as_file = f;
+    cx_box_init(cx_push(scope), cx->tcp_client_type)->as_file =
+      cx_file_new(cx, fd, "r+", NULL);
   }
 
-  ok = true;
- exit:
   cx_box_deinit(&server);
-  return ok;
+  return true;
 }
 
+static bool accept_all_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  struct cx_box server = *cx_test(cx_pop(scope, false));
+  struct cx_stack *out = cx_stack_new(cx);
+  bool ok = true;
+  int fd = -1;
+  
+  while ((fd = accept_fd(server.as_file)) != -1) {
+    cx_box_init(cx_vec_push(&out->imp), cx->tcp_client_type)->as_file =
+      cx_file_new(cx, fd, "r+", NULL);
+  }
+
+  // Errors after the first accepted client are picked up by the next call
+  if (errno != EAGAIN && errno != EWOULDBLOCK && !out->imp.count) {
+    cx_error(cx, cx->row, cx->col, "Failed accepting: %d", errno);
+    cx_stack_deref(out);
+    ok = false;
+  } else {
+    cx_box_init(cx_push(scope), cx->stack_type)->as_ptr = out;
+  }
+  
+  cx_box_deinit(&server);
+  return ok;
+}
 
 static bool connect_imp(struct cx_scope *scope) {
   struct cx *cx = scope->cx;
@@ -101,7 +197,7 @@ static bool connect_imp(struct cx_scope *scope) {
   struct sockaddr_in addr = {0};
   addr.sin_family = AF_INET;
   addr.sin_port = htons(port.as_int);
-  addr.sin_addr.s_addr = inet_addr(host.as_str->data);
+  addr.sin_addr.s_addr = inet_addr(cx_str_cstr(host.as_str));
 
   if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == -1 &&
       errno != EINPROGRESS) {
@@ -121,7 +217,7 @@ static bool connect_imp(struct cx_scope *scope) {
 cx_lib(cx_init_net, "cx/net") { 
   struct cx *cx = lib->cx;
 
-  if (!cx_use(cx, "cx/abc", "Int", "Opt", "Str") ||
+  if (!cx_use(cx, "cx/abc", "Int", "Opt", "Stack", "Str") ||
       !cx_use(cx, "cx/io", "RFile", "RWFile")) {
     return false;
   }
@@ -136,11 +232,24 @@ cx_lib(cx_init_net, "cx/net") {
 	       cx_args(cx_arg(NULL, cx->tcp_server_type)),
 	       listen_imp);
 
+  cx_add_cfunc(lib, "listen-with",
+	       cx_args(cx_arg("host", cx->opt_type),
+		       cx_arg("port", cx->int_type),
+		       cx_arg("backlog", cx->int_type),
+		       cx_arg("opts", cx->stack_type)),
+	       cx_args(cx_arg(NULL, cx->tcp_server_type)),
+	       listen_with_imp);
+
   cx_add_cfunc(lib, "accept",
 	       cx_args(cx_arg("server", cx->tcp_server_type)),
 	       cx_args(cx_arg(NULL, cx->opt_type)),
 	       accept_imp);
 
+  cx_add_cfunc(lib, "accept-all",
+	       cx_args(cx_arg("server", cx->tcp_server_type)),
+	       cx_args(cx_arg(NULL, cx->stack_type)),
+	       accept_all_imp);
+
   cx_add_cfunc(lib, "connect",
 	       cx_args(cx_arg("host", cx->str_type), cx_arg("port", cx->int_type)),
 	       cx_args(cx_arg(NULL, cx->opt_type)),
@@ -0,0 +1,156 @@
+#include <errno.h>
+
+#include "cixl/arg.h"
+#include "cixl/buf.h"
+#include "cixl/cx.h"
+#include "cixl/error.h"
+#include "cixl/file.h"
+#include "cixl/fimp.h"
+#include "cixl/func.h"
+#include "cixl/iter.h"
+#include "cixl/lib.h"
+#include "cixl/lib/pack.h"
+#include "cixl/pack.h"
+#include "cixl/scope.h"
+
+struct unpack_iter {
+  struct cx_iter iter;
+  struct cx_box in;
+  struct cx_set types;
+};
+
+static bool unpack_next(struct cx_iter *iter,
+			struct cx_box *out,
+			struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  struct unpack_iter *it = cx_baseof(iter, struct unpack_iter, iter);
+  struct cx_file *f = it->in.as_file;
+
+  while (true) {
+    struct cx_unpack in;
+    cx_unpack_init(&in, cx, f->rbuf+f->rpos, f->rlen-f->rpos, &it->types);
+
+    if (cx_unpack(&in, out)) {
+      f->rpos = in.pos-f->rbuf;
+      return true;
+    }
+
+    if (!in.eof) { return false; }
+    
+    // Values spanning blocks are decoded again once the rest is read
+    ssize_t len = cx_file_fill(f);
+
+    if (!len) {
+      iter->done = true;
+      if (f->rpos == f->rlen) { return false; }
+      cx_error(cx, cx->row, cx->col, "Truncated pack");
+      return false;
+    }
+
+    if (len == -1) {
+      if (errno == EAGAIN) {
+	cx_box_init(out, cx->nil_type);
+	return true;
+      }
+
+      cx_error(cx, cx->row, cx->col, "Failed reading: %d", errno);
+      return false;
+    }
+  }
+}
+
+static void *unpack_deinit(struct cx_iter *iter) {
+  struct unpack_iter *it = cx_baseof(iter, struct unpack_iter, iter);
+  cx_box_deinit(&it->in);
+  cx_set_deinit(&it->types);
+  return it;
+}
+
+static cx_iter_type(unpack_iter, {
+    type.next = unpack_next;
+    type.deinit = unpack_deinit;
+  });
+
+static struct cx_iter *unpack_iter_new(struct cx_box *in) {
+  struct unpack_iter *it = malloc(sizeof(struct unpack_iter));
+  cx_iter_init(&it->iter, unpack_iter());
+  cx_copy(&it->in, in);
+  cx_unpack_types_init(&it->types);
+  return &it->iter;
+}
+
+static bool pack_imp(struct cx_scope *scope) {
+  struct cx_box
+    v = *cx_test(cx_pop(scope, false)),
+    out = *cx_test(cx_pop(scope, false));
+
+  bool ok = cx_pack(&v, cx_baseof(out.as_file, struct cx_buf, file));
+  cx_box_deinit(&v);
+  cx_box_deinit(&out);
+  return ok;
+}
+
+static bool unpack_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  struct cx_box in = *cx_test(cx_pop(scope, false));
+  struct cx_buf *b = cx_baseof(in.as_file, struct cx_buf, file);
+  size_t len = cx_buf_len(b);
+  const char *data = cx_buf_view(b, &len);
+  struct cx_set types;
+  cx_unpack_types_init(&types);
+  struct cx_unpack u;
+  cx_unpack_init(&u, cx, data, len, &types);
+  struct cx_box v;
+  bool ok = true;
+  
+  if (cx_unpack(&u, &v)) {
+    *cx_push(scope) = v;
+    cx_buf_consume(b, u.pos-data);
+  } else {
+    // Incomplete values are left in the buffer
+    if (u.eof) {
+      cx_box_init(cx_push(scope), cx->nil_type);
+    } else {
+      ok = false;
+    }
+  }
+
+  cx_set_deinit(&types);
+  cx_box_deinit(&in);
+  return ok;
+}
+
+static bool unpacker_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  struct cx_box in = *cx_test(cx_pop(scope, false));
+  cx_box_init(cx_push(scope), cx->iter_type)->as_iter = unpack_iter_new(&in);
+  cx_box_deinit(&in);
+  return true;
+}
+
+cx_lib(cx_init_pack, "cx/io/pack") {    
+  struct cx *cx = lib->cx;
+    
+  if (!cx_use(cx, "cx/abc", "Iter", "Opt") ||
+      !cx_use(cx, "cx/io", "RFile") ||
+      !cx_use(cx, "cx/io/buf", "Buf")) {
+    return false;
+  }
+
+  cx_add_cfunc(lib, "pack",
+	       cx_args(cx_arg("out", cx->buf_type), cx_arg("v", cx->opt_type)),
+	       cx_args(),
+	       pack_imp);
+
+  cx_add_cfunc(lib, "unpack",
+	       cx_args(cx_arg("in", cx->buf_type)),
+	       cx_args(cx_arg(NULL, cx->opt_type)),
+	       unpack_imp);
+
+  cx_add_cfunc(lib, "unpacker",
+	       cx_args(cx_arg("in", cx->rfile_type)),
+	       cx_args(cx_arg(NULL, cx->iter_type)),
+	       unpacker_imp);
+
+  return true;
+}
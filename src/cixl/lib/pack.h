@@ -0,0 +1,9 @@
+#ifndef CX_LIB_PACK_H
+#define CX_LIB_PACK_H
+
+struct cx;
+struct cx_lib;
+
+struct cx_lib *cx_init_pack(struct cx *cx);
+
+#endif
@@ -52,6 +52,12 @@ static bool y_imp(struct cx_scope *scope) {
 
 static bool rezip_imp(struct cx_scope *scope) {
   struct cx_box p = *cx_test(cx_pop(scope, false));
+
+  if (!cx_check_mut(&p)) {
+    cx_box_deinit(&p);
+    return false;
+  }
+  
   struct cx_box tmp = p.as_pair->x;
   p.as_pair->x = p.as_pair->y;
   p.as_pair->y = tmp;
@@ -1,8 +1,10 @@
 #include <errno.h>
+#include <inttypes.h>
 #include <string.h>
 #include <unistd.h>
 
 #include "cixl/arg.h"
+#include "cixl/coro.h"
 #include "cixl/cx.h"
 #include "cixl/error.h"
 #include "cixl/fimp.h"
@@ -13,20 +15,28 @@
 #include "cixl/poll.h"
 #include "cixl/scope.h"
 #include "cixl/str.h"
+#include "cixl/wqueue.h"
 
 static bool on_read_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  
   struct cx_box
     a = *cx_test(cx_pop(scope, false)),
     f = *cx_test(cx_pop(scope, false)),
     p = *cx_test(cx_pop(scope, false));
   
   struct cx_poll_file *pf = cx_poll_read(p.as_poll, f.as_file->fd);
-  cx_copy(&pf->read_value, &a);
+  
+  if (pf) {
+    cx_copy(&pf->read_value, &a);
+  } else {
+    cx_error(cx, cx->row, cx->col, "Failed polling: %d", errno);
+  }
 
   cx_box_deinit(&a);
   cx_box_deinit(&f);
   cx_box_deinit(&p);
-  return true;
+  return pf;
 }
 
 static bool no_read_imp(struct cx_scope *scope) {
@@ -41,19 +51,64 @@ static bool no_read_imp(struct cx_scope *scope) {
   return ok;
 }
 
+static bool spawn_imp(struct cx_scope *scope) {
+  struct cx_box a = *cx_test(cx_pop(scope, false));
+  bool ok = cx_spawn(scope->cx, &a);
+  cx_box_deinit(&a);
+  return ok;
+}
+
+static bool await_imp(struct cx_scope *scope, bool write) {
+  struct cx *cx = scope->cx;
+  
+  struct cx_box
+    f = *cx_test(cx_pop(scope, false)),
+    p = *cx_test(cx_pop(scope, false));
+
+  bool ok = false;
+  
+  if (!cx->coro) {
+    cx_error(cx, cx->row, cx->col, "Await outside of coroutine");
+    goto exit;
+  }
+
+  ok = write
+    ? cx_coro_await_write(cx->coro, p.as_poll, f.as_file->fd)
+    : cx_coro_await_read(cx->coro, p.as_poll, f.as_file->fd);
+ exit:
+  cx_box_deinit(&f);
+  cx_box_deinit(&p);
+  return ok;
+}
+
+static bool await_read_imp(struct cx_scope *scope) {
+  return await_imp(scope, false);
+}
+
+static bool await_write_imp(struct cx_scope *scope) {
+  return await_imp(scope, true);
+}
+
 static bool on_write_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  
   struct cx_box
     a = *cx_test(cx_pop(scope, false)),
     f = *cx_test(cx_pop(scope, false)),
     p = *cx_test(cx_pop(scope, false));
   
   struct cx_poll_file *pf = cx_poll_write(p.as_poll, f.as_file->fd);
-  cx_copy(&pf->write_value, &a);
+  
+  if (pf) {
+    cx_copy(&pf->write_value, &a);
+  } else {
+    cx_error(cx, cx->row, cx->col, "Failed polling: %d", errno);
+  }
 
   cx_box_deinit(&a);
   cx_box_deinit(&f);
   cx_box_deinit(&p);
-  return true;
+  return pf;
 }
 
 static bool no_write_imp(struct cx_scope *scope) {
@@ -68,6 +123,41 @@ static bool no_write_imp(struct cx_scope *scope) {
   return ok;
 }
 
+static bool edge_trigger_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  struct cx_box p = *cx_test(cx_pop(scope, false));
+  bool ok = cx_poll_edge(p.as_poll);
+  if (!ok) { cx_error(cx, cx->row, cx->col, "Failed polling: %d", errno); }
+  cx_box_deinit(&p);
+  return ok;
+}
+
+static bool auto_flush_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+
+  struct cx_box
+    f = *cx_test(cx_pop(scope, false)),
+    p = *cx_test(cx_pop(scope, false));
+
+  bool ok = false;
+  
+  if (!f.as_file->queue) {
+    cx_error(cx, cx->row, cx->col, "File is not queued");
+    goto exit;
+  }
+
+  if (!cx_file_poll(f.as_file, p.as_poll)) {
+    cx_error(cx, cx->row, cx->col, "Failed polling: %d", errno);
+    goto exit;
+  }
+
+  ok = true;
+ exit:
+  cx_box_deinit(&f);
+  cx_box_deinit(&p);
+  return ok;
+}
+
 static bool delete_imp(struct cx_scope *scope) {
   struct cx *cx = scope->cx;
 
@@ -82,6 +172,59 @@ static bool delete_imp(struct cx_scope *scope) {
   return ok;
 }
 
+static bool on_timeout_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  
+  struct cx_box
+    a = *cx_test(cx_pop(scope, false)),
+    ms = *cx_test(cx_pop(scope, false)),
+    p = *cx_test(cx_pop(scope, false));
+
+  cx_box_init(cx_push(scope), cx->int_type)->as_int =
+    cx_poll_timeout(p.as_poll, ms.as_int, 0, &a);
+
+  cx_box_deinit(&a);
+  cx_box_deinit(&p);
+  return true;
+}
+
+static bool on_interval_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  
+  struct cx_box
+    a = *cx_test(cx_pop(scope, false)),
+    ms = *cx_test(cx_pop(scope, false)),
+    p = *cx_test(cx_pop(scope, false));
+
+  if (ms.as_int < 1) {
+    cx_error(cx, cx->row, cx->col, "Invalid interval: %" PRId64, ms.as_int);
+    cx_box_deinit(&a);
+    cx_box_deinit(&p);
+    return false;
+  }
+  
+  cx_box_init(cx_push(scope), cx->int_type)->as_int =
+    cx_poll_timeout(p.as_poll, ms.as_int, ms.as_int, &a);
+
+  cx_box_deinit(&a);
+  cx_box_deinit(&p);
+  return true;
+}
+
+static bool cancel_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  
+  struct cx_box
+    id = *cx_test(cx_pop(scope, false)),
+    p = *cx_test(cx_pop(scope, false));
+
+  cx_box_init(cx_push(scope), cx->bool_type)->as_bool =
+    cx_poll_cancel(p.as_poll, id.as_int);
+
+  cx_box_deinit(&p);
+  return true;
+}
+
 static bool wait_imp(struct cx_scope *scope) {
   struct cx *cx = scope->cx;
 
@@ -107,7 +250,7 @@ static bool wait_imp(struct cx_scope *scope) {
 static bool len_imp(struct cx_scope *scope) {
   struct cx *cx = scope->cx;
   struct cx_box p = *cx_test(cx_pop(scope, false));
-  cx_box_init(cx_push(scope), cx->int_type)->as_int = p.as_poll->files.members.count;
+  cx_box_init(cx_push(scope), cx->int_type)->as_int = p.as_poll->nfiles;
   cx_box_deinit(&p);
   return true;
 }
@@ -115,7 +258,7 @@ static bool len_imp(struct cx_scope *scope) {
 cx_lib(cx_init_poll, "cx/io/poll") {    
   struct cx *cx = lib->cx;
     
-  if (!cx_use(cx, "cx/abc", "A", "Int", "Opt") ||
+  if (!cx_use(cx, "cx/abc", "A", "Bool", "Int", "Opt") ||
       !cx_use(cx, "cx/io", "File", "RFile") ||
       !cx_use(cx, "cx/type", "new")) {
     return false;
@@ -123,6 +266,11 @@ cx_lib(cx_init_poll, "cx/io/poll") {
 
   cx->poll_type = cx_init_poll_type(lib);
   
+  cx_add_cfunc(lib, "edge-trigger",
+	       cx_args(cx_arg("p", cx->poll_type)),
+	       cx_args(),
+	       edge_trigger_imp);
+
   cx_add_cfunc(lib, "on-read",
 	       cx_args(cx_arg("p", cx->poll_type),
 		       cx_arg("f", cx->rfile_type),
@@ -135,6 +283,21 @@ cx_lib(cx_init_poll, "cx/io/poll") {
 	       cx_args(),
 	       no_read_imp);
 
+  cx_add_cfunc(lib, "spawn",
+	       cx_args(cx_arg("a", cx->any_type)),
+	       cx_args(),
+	       spawn_imp);
+
+  cx_add_cfunc(lib, "await-read",
+	       cx_args(cx_arg("p", cx->poll_type), cx_arg("f", cx->rfile_type)),
+	       cx_args(),
+	       await_read_imp);
+
+  cx_add_cfunc(lib, "await-write",
+	       cx_args(cx_arg("p", cx->poll_type), cx_arg("f", cx->wfile_type)),
+	       cx_args(),
+	       await_write_imp);
+
   cx_add_cfunc(lib, "on-write",
 	       cx_args(cx_arg("p", cx->poll_type),
 		       cx_arg("f", cx->wfile_type),
@@ -147,11 +310,35 @@ cx_lib(cx_init_poll, "cx/io/poll") {
 	       cx_args(),
 	       no_write_imp);
 
+  cx_add_cfunc(lib, "auto-flush",
+	       cx_args(cx_arg("p", cx->poll_type), cx_arg("f", cx->wfile_type)),
+	       cx_args(),
+	       auto_flush_imp);
+
   cx_add_cfunc(lib, "delete",
 	       cx_args(cx_arg("p", cx->poll_type), cx_arg("f", cx->file_type)),
 	       cx_args(),
 	       delete_imp);
 
+  cx_add_cfunc(lib, "on-timeout",
+	       cx_args(cx_arg("p", cx->poll_type),
+		       cx_arg("ms", cx->int_type),
+		       cx_arg("a", cx->any_type)),
+	       cx_args(cx_arg(NULL, cx->int_type)),
+	       on_timeout_imp);
+
+  cx_add_cfunc(lib, "on-interval",
+	       cx_args(cx_arg("p", cx->poll_type),
+		       cx_arg("ms", cx->int_type),
+		       cx_arg("a", cx->any_type)),
+	       cx_args(cx_arg(NULL, cx->int_type)),
+	       on_interval_imp);
+
+  cx_add_cfunc(lib, "cancel",
+	       cx_args(cx_arg("p", cx->poll_type), cx_arg("id", cx->int_type)),
+	       cx_args(cx_arg(NULL, cx->bool_type)),
+	       cancel_imp);
+
   cx_add_cfunc(lib, "wait",
 	       cx_args(cx_arg("p", cx->poll_type), cx_arg("ms", cx->opt_type)),
 	       cx_args(cx_arg(NULL, cx->int_type)),
@@ -0,0 +1,224 @@
+#include <errno.h>
+#include <inttypes.h>
+
+#include "cixl/arg.h"
+#include "cixl/cx.h"
+#include "cixl/error.h"
+#include "cixl/fimp.h"
+#include "cixl/func.h"
+#include "cixl/lib.h"
+#include "cixl/lib/ring.h"
+#include "cixl/ring.h"
+#include "cixl/scope.h"
+
+static bool push_op(struct cx_scope *scope,
+		    enum cx_ring_op_type type,
+		    struct cx_box *r,
+		    struct cx_box *f,
+		    struct cx_box *b,
+		    size_t len,
+		    struct cx_box *a) {
+  struct cx *cx = scope->cx;
+  struct cx_ring_op *op = cx_ring_push(r->as_ring, type, f, b, len);
+  
+  if (op) {
+    cx_copy(&op->act, a);
+  } else {
+    cx_error(cx, cx->row, cx->col, "Failed queueing ring op: %d", errno);
+  }
+
+  return op;
+}
+
+static bool accept_imp(struct cx_scope *scope) {
+  struct cx_box
+    a = *cx_test(cx_pop(scope, false)),
+    s = *cx_test(cx_pop(scope, false)),
+    r = *cx_test(cx_pop(scope, false));
+
+  bool ok = push_op(scope, CX_RING_ACCEPT, &r, &s, NULL, 0, &a);
+  cx_box_deinit(&a);
+  cx_box_deinit(&s);
+  cx_box_deinit(&r);
+  return ok;
+}
+
+static bool read_op(struct cx_scope *scope, enum cx_ring_op_type type) {
+  struct cx_box
+    a = *cx_test(cx_pop(scope, false)),
+    n = *cx_test(cx_pop(scope, false)),
+    b = *cx_test(cx_pop(scope, false)),
+    f = *cx_test(cx_pop(scope, false)),
+    r = *cx_test(cx_pop(scope, false));
+
+  struct cx *cx = scope->cx;
+  bool ok = false;
+
+  if (n.as_int < 0) {
+    cx_error(cx, cx->row, cx->col, "Invalid read length: %" PRId64, n.as_int);
+  } else {
+    ok = push_op(scope, type, &r, &f, &b, n.as_int, &a);
+  }
+  
+  cx_box_deinit(&a);
+  cx_box_deinit(&b);
+  cx_box_deinit(&f);
+  cx_box_deinit(&r);
+  return ok;
+}
+
+static bool recv_imp(struct cx_scope *scope) {
+  return read_op(scope, CX_RING_RECV);
+}
+
+static bool read_imp(struct cx_scope *scope) {
+  return read_op(scope, CX_RING_READ);
+}
+
+static bool write_op(struct cx_scope *scope, enum cx_ring_op_type type) {
+  struct cx_box
+    a = *cx_test(cx_pop(scope, false)),
+    b = *cx_test(cx_pop(scope, false)),
+    f = *cx_test(cx_pop(scope, false)),
+    r = *cx_test(cx_pop(scope, false));
+
+  bool ok = push_op(scope, type, &r, &f, &b, 0, &a);
+  cx_box_deinit(&a);
+  cx_box_deinit(&b);
+  cx_box_deinit(&f);
+  cx_box_deinit(&r);
+  return ok;
+}
+
+static bool send_imp(struct cx_scope *scope) {
+  return write_op(scope, CX_RING_SEND);
+}
+
+static bool write_imp(struct cx_scope *scope) {
+  return write_op(scope, CX_RING_WRITE);
+}
+
+static bool submit_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  struct cx_box r = *cx_test(cx_pop(scope, false));
+  bool ok = cx_ring_submit(r.as_ring);
+  if (!ok) { cx_error(cx, cx->row, cx->col, "Failed submitting: %d", errno); }
+  cx_box_deinit(&r);
+  return ok;
+}
+
+static bool wait_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+
+  struct cx_box
+    ms = *cx_test(cx_pop(scope, false)),
+    r = *cx_test(cx_pop(scope, false));
+
+  if (ms.type == cx->nil_type) { ms.as_int = -1; }
+  int n = cx_ring_wait(r.as_ring, ms.as_int, scope);
+  cx_box_deinit(&r);
+
+  if (n == -1) {
+    if (!cx->errors.count) {
+      cx_error(cx, cx->row, cx->col, "Failed waiting: %d", errno);
+    }
+    
+    return false;
+  }
+
+  cx_box_init(cx_push(scope), cx->int_type)->as_int = n;
+  return true;
+}
+
+static bool len_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  struct cx_box r = *cx_test(cx_pop(scope, false));
+  cx_box_init(cx_push(scope), cx->int_type)->as_int = r.as_ring->nops;
+  cx_box_deinit(&r);
+  return true;
+}
+
+static bool is_async_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  struct cx_box r = *cx_test(cx_pop(scope, false));
+  cx_box_init(cx_push(scope), cx->bool_type)->as_bool = r.as_ring->fd != -1;
+  cx_box_deinit(&r);
+  return true;
+}
+
+cx_lib(cx_init_ring, "cx/io/ring") {    
+  struct cx *cx = lib->cx;
+    
+  if (!cx_use(cx, "cx/abc", "A", "Bool", "Int", "Opt") ||
+      !cx_use(cx, "cx/io", "RFile", "WFile") ||
+      !cx_use(cx, "cx/io/buf", "Buf") ||
+      !cx_use(cx, "cx/net", "TCPServer", "TCPClient") ||
+      !cx_use(cx, "cx/type", "new")) {
+    return false;
+  }
+
+  cx->ring_type = cx_init_ring_type(lib);
+  
+  cx_add_cfunc(lib, "async-accept",
+	       cx_args(cx_arg("r", cx->ring_type),
+		       cx_arg("s", cx->tcp_server_type),
+		       cx_arg("a", cx->any_type)),
+	       cx_args(),
+	       accept_imp);
+
+  cx_add_cfunc(lib, "async-recv",
+	       cx_args(cx_arg("r", cx->ring_type),
+		       cx_arg("f", cx->tcp_client_type),
+		       cx_arg("b", cx->buf_type),
+		       cx_arg("n", cx->int_type),
+		       cx_arg("a", cx->any_type)),
+	       cx_args(),
+	       recv_imp);
+
+  cx_add_cfunc(lib, "async-send",
+	       cx_args(cx_arg("r", cx->ring_type),
+		       cx_arg("f", cx->tcp_client_type),
+		       cx_arg("b", cx->buf_type),
+		       cx_arg("a", cx->any_type)),
+	       cx_args(),
+	       send_imp);
+
+  cx_add_cfunc(lib, "async-read",
+	       cx_args(cx_arg("r", cx->ring_type),
+		       cx_arg("f", cx->rfile_type),
+		       cx_arg("b", cx->buf_type),
+		       cx_arg("n", cx->int_type),
+		       cx_arg("a", cx->any_type)),
+	       cx_args(),
+	       read_imp);
+
+  cx_add_cfunc(lib, "async-write",
+	       cx_args(cx_arg("r", cx->ring_type),
+		       cx_arg("f", cx->wfile_type),
+		       cx_arg("b", cx->buf_type),
+		       cx_arg("a", cx->any_type)),
+	       cx_args(),
+	       write_imp);
+
+  cx_add_cfunc(lib, "submit",
+	       cx_args(cx_arg("r", cx->ring_type)),
+	       cx_args(),
+	       submit_imp);
+
+  cx_add_cfunc(lib, "wait",
+	       cx_args(cx_arg("r", cx->ring_type), cx_arg("ms", cx->opt_type)),
+	       cx_args(cx_arg(NULL, cx->int_type)),
+	       wait_imp);
+
+  cx_add_cfunc(lib, "len",
+	       cx_args(cx_arg("r", cx->ring_type)),
+	       cx_args(cx_arg(NULL, cx->int_type)),
+	       len_imp);
+
+  cx_add_cfunc(lib, "is-async",
+	       cx_args(cx_arg("r", cx->ring_type)),
+	       cx_args(cx_arg(NULL, cx->bool_type)),
+	       is_async_imp);
+
+  return true;
+}
@@ -0,0 +1,9 @@
+#ifndef CX_LIB_RING_H
+#define CX_LIB_RING_H
+
+struct cx;
+struct cx_lib;
+
+struct cx_lib *cx_init_ring(struct cx *cx);
+
+#endif
@@ -25,6 +25,12 @@ static bool push_imp(struct cx_scope *scope) {
   struct cx_box
     val = *cx_test(cx_pop(scope, false)),
     vec = *cx_test(cx_pop(scope, false));
+
+  if (!cx_check_mut(&vec)) {
+    cx_box_deinit(&val);
+    cx_box_deinit(&vec);
+    return false;
+  }
   
   struct cx_stack *v = vec.as_ptr;
   *(struct cx_box *)cx_vec_push(&v->imp) = val;
@@ -42,6 +48,11 @@ static bool put_imp(struct cx_scope *scope) {
   struct cx *cx = scope->cx;
   bool ok = false;
   
+  if (!cx_check_mut(&sv)) {
+    cx_box_deinit(&val);
+    goto exit;
+  }
+
   if (i.as_int < 0 || i.as_int >= s->imp.count) {
     cx_error(cx, cx->row, cx->col, "Index out of bounds: %" PRId64, i.as_int);
     cx_box_deinit(&val);
@@ -61,6 +72,11 @@ static bool pop_imp(struct cx_scope *scope) {
   struct cx_box vec = *cx_test(cx_pop(scope, false));
   struct cx_stack *v = vec.as_ptr;
 
+  if (!cx_check_mut(&vec)) {
+    cx_box_deinit(&vec);
+    return false;
+  }
+
   if (v->imp.count) {
     *cx_push(scope) = *(struct cx_box *)cx_vec_pop(&v->imp);
   } else {
@@ -150,6 +166,12 @@ static bool splat_imp(struct cx_scope *scope) {
 static bool clear_imp(struct cx_scope *scope) {
   struct cx_box vec = *cx_test(cx_pop(scope, false));
   struct cx_stack *v = vec.as_ptr;
+
+  if (!cx_check_mut(&vec)) {
+    cx_box_deinit(&vec);
+    return false;
+  }
+  
   cx_vec_clear(&v->imp);
   cx_box_deinit(&vec);
   return true;
@@ -165,6 +187,12 @@ static bool sort_imp(struct cx_scope *scope) {
   struct cx_stack *v = vec.as_ptr;
   struct cx_sym lt = cx_sym(cx, "<"), gt = cx_sym(cx, ">");
   bool ok = false;
+
+  if (!cx_check_mut(&vec)) {
+    cx_box_deinit(&cmp);
+    cx_box_deinit(&vec);
+    return false;
+  }
   
   int do_cmp(const void *x, const void *y) {
     const struct cx_box *xv = x, *yv = y;
@@ -224,8 +252,9 @@ static bool fill_imp(struct cx_scope *scope) {
     in = *cx_test(cx_pop(scope, false));
     
   struct cx_stack *s = in.as_ptr;
-  cx_vec_grow(&s->imp, s->imp.count+n.as_int);
   bool ok = false;
+  if (!cx_check_mut(&in)) { goto exit; }
+  cx_vec_grow(&s->imp, s->imp.count+n.as_int);
   
   for (int64_t i=0; i<n.as_int; i++) {
     if (!cx_call(&act, scope)) { goto exit; }
@@ -251,6 +280,7 @@ static bool move_imp(struct cx_scope *scope) {
   struct cx_stack *s = in.as_ptr;
   struct cx *cx = scope->cx;
   bool ok = false;
+  if (!cx_check_mut(&in)) { goto exit; }
 
   if (start.as_int+delta.as_int < 0 || start.as_int+len.as_int > s->imp.count) {
     cx_error(cx, cx->row, cx->col, "Move out of bounds");
@@ -1,4 +1,5 @@
 #include <ctype.h>
+#include <errno.h>
 #include <inttypes.h>
 #include <string.h>
 
@@ -7,6 +8,7 @@
 #include "cixl/char.h"
 #include "cixl/cx.h"
 #include "cixl/error.h"
+#include "cixl/file.h"
 #include "cixl/fimp.h"
 #include "cixl/func.h"
 #include "cixl/iter.h"
@@ -14,6 +16,7 @@
 #include "cixl/lib/str.h"
 #include "cixl/mfile.h"
 #include "cixl/scope.h"
+#include "cixl/simd.h"
 #include "cixl/str.h"
 
 typedef bool (*cx_split_t)(unsigned char c);
@@ -21,13 +24,220 @@ typedef bool (*cx_split_t)(unsigned char c);
 struct cx_split_iter {
   struct cx_iter iter;
   struct cx_iter *in;
+  struct cx_str *str;
+  struct cx_box file;
+  size_t pos;
   cx_split_t split_fn;
   struct cx_box split;
   struct cx_mfile out;
 };
 
+static bool split_char(struct cx_split_iter *it,
+		       unsigned char c,
+		       bool *out,
+		       struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  
+  if (it->split_fn) {
+    *out = it->split_fn(c);
+  } else if (it->split.type == cx->char_type) {
+    *out = c == it->split.as_char;
+  } else {
+    cx_box_init(cx_push(scope), cx->char_type)->as_char = c;
+    if (!cx_call(&it->split, scope)) { return false; }
+    struct cx_box *res = cx_pop(scope, true);
+	
+    if (!res) {
+      cx_error(cx, cx->row, cx->col, "Missing split result");
+      return false;
+    }
+	
+    *out = res->as_bool;
+  }
+
+  return true;
+}
+
+bool split_lines(unsigned char c) { return c == '\r' || c == '\n'; }
+
+bool split_words(unsigned char c) {
+  return !isalpha(c);
+}
+
+static bool split_scan(struct cx_split_iter *it,
+		       const char *s,
+		       size_t len,
+		       bool sep,
+		       size_t *out,
+		       struct cx *cx) {
+  if (it->split_fn == split_lines) {
+    *out = cx_simd_find_eol(s, len, sep);
+  } else if (it->split_fn == split_words) {
+    *out = cx_simd_find_alpha(s, len, !sep);
+  } else if (!it->split_fn && it->split.type == cx->char_type) {
+    *out = cx_simd_find_char(s, len, it->split.as_char, sep);
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+static bool split_sep_next(struct cx_split_iter *it,
+			   struct cx_box *out,
+			   struct cx_scope *scope) {
+  struct cx_str *s = it->str, *sep = it->split.as_str;
+  
+  while (it->pos < s->len) {
+    size_t
+      start = it->pos,
+      n = sep->len
+      ? cx_simd_find_str(s->data+start, s->len-start, sep->data, sep->len)
+      : s->len-start;
+
+    it->pos = (start+n < s->len) ? start+n+sep->len : s->len;
+    
+    if (n) {
+      cx_box_init(out, scope->cx->str_type)->as_str = cx_str_slice(s, start, n);
+      return true;
+    }
+  }
+
+  it->iter.done = true;
+  return false;
+}
+
+static bool split_str_next(struct cx_split_iter *it,
+			   struct cx_box *out,
+			   struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  struct cx_str *s = it->str;
+  size_t n = 0;
+
+  if (!it->split_fn && it->split.type == cx->str_type) {
+    return split_sep_next(it, out, scope);
+  }
+  
+  if (split_scan(it, s->data+it->pos, s->len-it->pos, false, &n, cx)) {
+    it->pos += n;
+
+    if (it->pos == s->len) {
+      it->iter.done = true;
+      return false;
+    }
+
+    size_t start = it->pos;
+    split_scan(it, s->data+start, s->len-start, true, &n, cx);
+    it->pos += n;
+    cx_box_init(out, cx->str_type)->as_str = cx_str_slice(s, start, n);
+    return true;
+  }
+  
+  size_t start = it->pos;
+  
+  while (it->pos < s->len) {
+    bool split = false;
+    if (!split_char(it, s->data[it->pos], &split, scope)) { return false; }
+    it->pos++;
+    
+    if (split) {
+      if (it->pos-1 > start) {
+	cx_box_init(out, cx->str_type)->as_str =
+	  cx_str_slice(s, start, it->pos-1-start);
+	
+	return true;
+      }
+
+      start = it->pos;
+    }
+  }
+
+  it->iter.done = true;
+  if (it->pos == start) { return false; }
+  cx_box_init(out, cx->str_type)->as_str = cx_str_slice(s, start, it->pos-start);
+  return true;
+}
+
+static bool split_block(struct cx_split_iter *it,
+			const char *s,
+			size_t len,
+			bool sep,
+			size_t *out,
+			struct cx_scope *scope) {
+  if (split_scan(it, s, len, sep, out, scope->cx)) { return true; }
+
+  for (*out = 0; *out < len; (*out)++) {
+    bool split = false;
+    if (!split_char(it, s[*out], &split, scope)) { return false; }
+    if (split == sep) { break; }
+  }
+
+  return true;
+}
+
+static bool split_fill(struct cx_split_iter *it,
+		       bool *eof,
+		       struct cx_scope *scope) {
+  ssize_t len = cx_file_fill(it->file.as_file);
+
+  if (len == -1) {
+    struct cx *cx = scope->cx;
+    cx_error(cx, cx->row, cx->col, "Failed reading: %d", errno);
+    return false;
+  }
+
+  *eof = !len;
+  return true;
+}
+
+static bool split_file_next(struct cx_split_iter *it,
+			    struct cx_box *out,
+			    struct cx_scope *scope) {
+  struct cx_file *f = it->file.as_file;
+  size_t n = 0, len = 0;
+  bool eof = false;
+
+  // Separators are consumed as they're scanned, tokens once complete
+  while (true) {
+    if (f->rpos == f->rlen) {
+      if (!split_fill(it, &eof, scope)) { return false; }
+
+      if (eof) {
+	it->iter.done = true;
+	return false;
+      }
+    }
+
+    if (!split_block(it, f->rbuf+f->rpos, f->rlen-f->rpos, false, &n, scope)) {
+      return false;
+    }
+
+    f->rpos += n;
+    if (f->rpos < f->rlen) { break; }
+  }
+
+  while (true) {
+    const char *start = f->rbuf+f->rpos+len;
+    if (!split_block(it, start, f->rlen-f->rpos-len, true, &n, scope)) {
+      return false;
+    }
+    
+    len += n;
+    if (f->rpos+len < f->rlen) { break; }
+    if (!split_fill(it, &eof, scope)) { return false; }
+    if (eof) { break; }
+  }
+
+  cx_box_init(out, scope->cx->str_type)->as_str = cx_str_new(f->rbuf+f->rpos, len);
+  f->rpos += len;
+  return true;
+}
+
 bool split_next(struct cx_iter *iter, struct cx_box *out, struct cx_scope *scope) {
   struct cx_split_iter *it = cx_baseof(iter, struct cx_split_iter, iter);
+  if (it->str) { return split_str_next(it, out, scope); }
+  if (it->file.type) { return split_file_next(it, out, scope); }
+  
   struct cx *cx = scope->cx;
   struct cx_box c;
   bool ok = false;
@@ -46,25 +256,7 @@ bool split_next(struct cx_iter *iter, struct cx_box *out, struct cx_scope *scope
     }
 
     bool split = false;
-    
-    if (it->split_fn) {
-      split = it->split_fn(c.as_char);
-    } else {
-      if (it->split.type == cx->char_type) {
-	split = c.as_char == it->split.as_char;
-      } else {
-	*cx_push(scope) = c;
-	if (!cx_call(&it->split, scope)) { goto exit; }
-	struct cx_box *res = cx_pop(scope, true);
-	
-	if (!res) {
-	  cx_error(cx, cx->row, cx->col, "Missing split result");
-	  goto exit;
-	}
-	
-	split = res->as_bool;
-      }
-    } 
+    if (!split_char(it, c.as_char, &split, scope)) { goto exit; }
     
     if (split) {
       fflush(it->out.stream);
@@ -85,8 +277,15 @@ bool split_next(struct cx_iter *iter, struct cx_box *out, struct cx_scope *scope
 
 void *split_deinit(struct cx_iter *iter) {
   struct cx_split_iter *it = cx_baseof(iter, struct cx_split_iter, iter);
-  cx_iter_deref(it->in);
 
+  if (it->str) {
+    cx_str_deref(it->str);
+  } else if (it->file.type) {
+    cx_box_deinit(&it->file);
+  } else {
+    cx_iter_deref(it->in);
+  }
+  
   if (it->out.stream) {
     cx_mfile_close(&it->out);
     free(it->out.data);
@@ -101,12 +300,33 @@ cx_iter_type(split_iter, {
     type.deinit = split_deinit;
   });
 
-struct cx_split_iter *cx_split_iter_new(struct cx_iter *in) {
+struct cx_split_iter *cx_split_iter_new(struct cx_box *in) {
   struct cx_split_iter *it = malloc(sizeof(struct cx_split_iter));
   cx_iter_init(&it->iter, split_iter());
-  it->in = in;
-  cx_mfile_open(&it->out);
   it->split_fn = NULL;
+  it->pos = 0;
+  
+  struct cx *cx = in->type->lib->cx;
+
+  // Mapped files are split into slices of the mapping
+  if (in->type == cx->str_type || in->type == cx->mfile_type) {
+    it->in = NULL;
+    it->str = cx_str_ref(in->as_str);
+    it->file.type = NULL;
+    it->out.stream = NULL;
+  } else if (cx_is(in->type, cx->rfile_type)) {
+    // Readable files are split straight from the block reader
+    it->in = NULL;
+    it->str = NULL;
+    cx_copy(&it->file, in);
+    it->out.stream = NULL;
+  } else {
+    it->in = cx_iter(in);
+    it->str = NULL;
+    it->file.type = NULL;
+    cx_mfile_open(&it->out);
+  }
+  
   return it;
 }
 
@@ -207,24 +427,18 @@ static struct cx_iter *hex_decoder_new(struct cx_iter *in) {
   return &it->iter;
 }
 
-bool split_lines(unsigned char c) { return c == '\r' || c == '\n'; }
-
 static bool lines_imp(struct cx_scope *scope) {
   struct cx_box in = *cx_test(cx_pop(scope, false));
-  struct cx_split_iter *it = cx_split_iter_new(cx_iter(&in));
+  struct cx_split_iter *it = cx_split_iter_new(&in);
   it->split_fn = split_lines;
   cx_box_init(cx_push(scope), scope->cx->iter_type)->as_iter = &it->iter;
   cx_box_deinit(&in);
   return true;
 }
 
-bool split_words(unsigned char c) {
-  return !isalpha(c);
-}
-
 static bool words_imp(struct cx_scope *scope) {
   struct cx_box in = *cx_test(cx_pop(scope, false));
-  struct cx_split_iter *it = cx_split_iter_new(cx_iter(&in));
+  struct cx_split_iter *it = cx_split_iter_new(&in);
   it->split_fn = split_words;
   cx_box_init(cx_push(scope), scope->cx->iter_type)->as_iter = &it->iter;
   cx_box_deinit(&in);
@@ -232,16 +446,47 @@ static bool words_imp(struct cx_scope *scope) {
 }
 
 static bool split_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  
   struct cx_box
     s = *cx_test(cx_pop(scope, false)),
     in = *cx_test(cx_pop(scope, false));
-  struct cx_split_iter *it = cx_split_iter_new(cx_iter(&in));
+
+  if (s.type == cx->str_type && in.type != cx->str_type) {
+    cx_error(cx, cx->row, cx->col, "Str separator requires Str input");
+    cx_box_deinit(&s);
+    cx_box_deinit(&in);
+    return false;
+  }
+  
+  struct cx_split_iter *it = cx_split_iter_new(&in);
   it->split = s;
   cx_box_init(cx_push(scope), scope->cx->iter_type)->as_iter = &it->iter;
   cx_box_deinit(&in);
   return true;
 }
 
+static bool find_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  
+  struct cx_box
+    x = *cx_test(cx_pop(scope, false)),
+    s = *cx_test(cx_pop(scope, false));
+
+  struct cx_str *ss = s.as_str, *xs = x.as_str;
+  size_t i = cx_simd_find_str(ss->data, ss->len, xs->data, xs->len);
+  
+  if (xs->len && i == ss->len) {
+    cx_box_init(cx_push(scope), cx->nil_type);
+  } else {
+    cx_box_init(cx_push(scope), cx->int_type)->as_int = i;
+  }
+
+  cx_box_deinit(&x);
+  cx_box_deinit(&s);
+  return true;
+}
+
 static bool is_graph_imp(struct cx_scope *scope) {
   struct cx_box *v = cx_test(cx_peek(scope, false));
   bool ig = isgraph(v->as_char);
@@ -321,11 +566,17 @@ static bool pop_imp(struct cx_scope *scope) {
   struct cx *cx = scope->cx;
   struct cx_box in = *cx_test(cx_pop(scope, false));
   struct cx_str *s = in.as_str;
+
+  if (!cx_check_mut(&in)) {
+    cx_box_deinit(&in);
+    return false;
+  }
   
   if (s->len) {
-    cx_box_init(cx_push(scope), cx->char_type)->as_char = s->data[s->len-1];
+    char *d = cx_str_mut(s);
+    cx_box_init(cx_push(scope), cx->char_type)->as_char = d[s->len-1];
     s->len--;
-    s->data[s->len] = 0;
+    d[s->len] = 0;
   } else {
     cx_box_init(cx_push(scope), cx->nil_type);
   }
@@ -354,10 +605,10 @@ static bool seq_imp(struct cx_scope *scope) {
   }
 
   cx_mfile_close(&out);
-  cx_box_init(cx_push(scope), cx->str_type)->as_str = cx_str_new(out.data, out.size);
+  cx_box_init(cx_push(scope), cx->str_type)->as_str = cx_str_take(out.data, out.size);
   ok = true;
  exit:
-  free(out.data);
+  if (!ok) { free(out.data); }
   cx_box_deinit(&in);
   cx_iter_deref(it);
   return ok;
@@ -367,7 +618,7 @@ static bool str_int_imp(struct cx_scope *scope) {
   struct cx *cx = scope->cx;
   struct cx_box v = *cx_test(cx_pop(scope, false));
   struct cx_str *s = v.as_str;
-  int64_t iv = strtoimax(s->data, NULL, 10);
+  int64_t iv = strtoimax(cx_str_cstr(s), NULL, 10);
   
   if (!iv && s->data[0] != '0') {
     cx_box_init(cx_push(scope), cx->nil_type);
@@ -385,8 +636,8 @@ static bool str_sub_imp(struct cx_scope *scope) {
     y = *cx_test(cx_pop(scope, false));
   
   cx_box_init(cx_push(scope),
-	      scope->cx->int_type)->as_int = cx_str_dist(x.as_str->data,
-							 y.as_str->data);
+	      scope->cx->int_type)->as_int = cx_str_dist(cx_str_cstr(x.as_str),
+							 cx_str_cstr(y.as_str));
   
   cx_box_deinit(&x);
   cx_box_deinit(&y);
@@ -396,7 +647,14 @@ static bool str_sub_imp(struct cx_scope *scope) {
 static bool str_upper_imp(struct cx_scope *scope) {
   struct cx_box v = *cx_test(cx_pop(scope, false));
   struct cx_str *s = v.as_str;
-  for (char *c = s->data; c < s->data+s->len; c++) { *c = toupper(*c); }
+
+  if (!cx_check_mut(&v)) {
+    cx_box_deinit(&v);
+    return false;
+  }
+
+  char *d = cx_str_mut(s);
+  cx_simd_upper(d, s->len);
   cx_box_deinit(&v);
   return true;
 }
@@ -404,18 +662,63 @@ static bool str_upper_imp(struct cx_scope *scope) {
 static bool str_lower_imp(struct cx_scope *scope) {
   struct cx_box v = *cx_test(cx_pop(scope, false));
   struct cx_str *s = v.as_str;
-  for (char *c = s->data; c < s->data+s->len; c++) { *c = tolower(*c); }
+
+  if (!cx_check_mut(&v)) {
+    cx_box_deinit(&v);
+    return false;
+  }
+
+  char *d = cx_str_mut(s);
+  cx_simd_lower(d, s->len);
   cx_box_deinit(&v);
   return true;
 }
 
 static bool str_reverse_imp(struct cx_scope *scope) {
   struct cx_box s = *cx_test(cx_pop(scope, false));
-  cx_reverse(s.as_str->data, s.as_str->len);
+
+  if (!cx_check_mut(&s)) {
+    cx_box_deinit(&s);
+    return false;
+  }
+
+  cx_reverse(cx_str_mut(s.as_str), s.as_str->len);
   cx_box_deinit(&s);
   return true;
 }
 
+struct join_out {
+  char *data;
+  size_t len, capac;
+};
+
+static void join_push(struct join_out *out, const char *in, size_t len) {
+  if (out->len+len+1 > out->capac) {
+    out->capac = cx_max(out->capac*2, out->len+len+1);
+    out->data = realloc(out->data, out->capac);
+  }
+
+  memcpy(out->data+out->len, in, len);
+  out->len += len;
+}
+
+static void join_print(struct join_out *out,
+		       struct cx_box *v,
+		       struct cx_mfile *tmp,
+		       struct cx *cx) {
+  if (v->type == cx->str_type) {
+    join_push(out, v->as_str->data, v->as_str->len);
+  } else if (v->type == cx->char_type) {
+    join_push(out, (char *)&v->as_char, 1);
+  } else {
+    if (!tmp->stream) { cx_mfile_open(tmp); }
+    cx_print(v, tmp->stream);
+    fflush(tmp->stream);
+    join_push(out, tmp->data, tmp->size);
+    fseek(tmp->stream, 0, SEEK_SET);
+  }
+}
+
 static bool join_imp(struct cx_scope *scope) {
   struct cx *cx = scope->cx;
   
@@ -424,22 +727,30 @@ static bool join_imp(struct cx_scope *scope) {
     in = *cx_test(cx_pop(scope, false));
 
   struct cx_iter *it = cx_iter(&in);
-  struct cx_mfile out;
-  cx_mfile_open(&out);
+  struct join_out out = {NULL, 0, 0}, sep_out = {NULL, 0, 0};
+  struct cx_mfile tmp = {NULL, 0, NULL};
+  if (sep.type != cx->nil_type) { join_print(&sep_out, &sep, &tmp, cx); }
   struct cx_box v;
   bool print_sep = false;
   
   while (cx_iter_next(it, &v, scope)) {
-    if (print_sep) { cx_print(&sep, out.stream); }
-    cx_print(&v, out.stream);
+    if (print_sep) { join_push(&out, sep_out.data, sep_out.len); }
+    join_print(&out, &v, &tmp, cx);
     cx_box_deinit(&v);
     print_sep = sep.type != cx->nil_type;
   }
 
   cx_iter_deref(it);
-  cx_mfile_close(&out);
-  cx_box_init(cx_push(scope), cx->str_type)->as_str = cx_str_new(out.data, out.size);
-  free(out.data);
+
+  if (tmp.stream) {
+    cx_mfile_close(&tmp);
+    free(tmp.data);
+  }
+
+  join_push(&out, "", 0);
+  out.data[out.len] = 0;
+  cx_box_init(cx_push(scope), cx->str_type)->as_str = cx_str_take(out.data, out.len);
+  if (sep_out.data) { free(sep_out.data); }
   cx_box_deinit(&sep);
   cx_box_deinit(&in);
   return true;
@@ -484,6 +795,11 @@ cx_lib(cx_init_str, "cx/str") {
 	       cx_args(cx_arg(NULL, cx->iter_type)),
 	       split_imp);
 
+  cx_add_cfunc(lib, "find",
+	       cx_args(cx_arg("s", cx->str_type), cx_arg("x", cx->str_type)),
+	       cx_args(cx_arg(NULL, cx->opt_type)),
+	       find_imp);
+
   cx_add_cfunc(lib, "is-graph",
 	       cx_args(cx_arg("c", cx->char_type)),
 	       cx_args(cx_arg(NULL, cx->bool_type)),
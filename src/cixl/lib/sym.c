@@ -14,7 +14,7 @@
 static bool sym_imp(struct cx_scope *scope) {
   struct cx_box s = *cx_test(cx_pop(scope, false));
   cx_box_init(cx_push(scope),
-	      scope->cx->sym_type)->as_sym = cx_sym(scope->cx, s.as_str->data);
+	      scope->cx->sym_type)->as_sym = cx_sym(scope->cx, cx_str_cstr(s.as_str));
   cx_box_deinit(&s);
   return true;
 }
@@ -1,6 +1,13 @@
 #include <dlfcn.h>
 #include <errno.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "cixl/arg.h"
 #include "cixl/cx.h"
@@ -111,11 +118,164 @@ static bool home_dir_imp(struct cx_scope *scope) {
 
 static bool make_dir_imp(struct cx_scope *scope) {
   struct cx_box p = *cx_test(cx_pop(scope, false));
-  bool ok = cx_make_dir(p.as_str->data);
+  bool ok = cx_make_dir(cx_str_cstr(p.as_str));
   cx_box_deinit(&p);
   return ok;
 }
 
+struct prefork_worker {
+  pid_t pid;
+  time_t started, restart;
+  int backoff;
+};
+
+static pid_t spawn(struct prefork_worker *w, sigset_t *mask) {
+  pid_t pid = fork();
+  if (!pid) { sigprocmask(SIG_SETMASK, mask, NULL); }
+  w->pid = pid;
+  w->started = time(NULL);
+  w->restart = 0;
+  return pid;
+}
+
+static bool prefork_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  struct cx_box n = *cx_test(cx_pop(scope, false));
+
+  if (n.as_int < 1 || n.as_int > CX_PREFORK_MAX) {
+    cx_error(cx, cx->row, cx->col, "Invalid number of workers: %" PRId64, n.as_int);
+    return false;
+  }
+
+  // Signals are only received through sigwaitinfo while supervising
+  sigset_t sigs, prev;
+  sigemptyset(&sigs);
+  sigaddset(&sigs, SIGCHLD);
+  sigaddset(&sigs, SIGHUP);
+  sigaddset(&sigs, SIGINT);
+  sigaddset(&sigs, SIGTERM);
+  sigprocmask(SIG_BLOCK, &sigs, &prev);
+  fflush(NULL);
+  
+  struct prefork_worker *ws = calloc(n.as_int, sizeof(struct prefork_worker));
+  int64_t nworkers = 0, id = 0;
+  bool ok = true, stopping = false;
+  
+  for (; nworkers < n.as_int; nworkers++) {
+    pid_t pid = spawn(ws+nworkers, &prev);
+
+    if (pid == -1) {
+      cx_error(cx, cx->row, cx->col, "Failed forking worker: %d", errno);
+      ok = false;
+      stopping = true;
+      for (int64_t i = 0; i < nworkers; i++) { kill(ws[i].pid, SIGTERM); }
+      break;
+    }
+
+    if (!pid) {
+      id = nworkers+1;
+      goto exit;
+    }
+  }
+
+  // Workers waiting to be restarted are counted as alive
+  for (int64_t nalive = nworkers; nalive;) {
+    time_t now = time(NULL), next = 0;
+    
+    for (int64_t i = 0; i < nworkers; i++) {
+      struct prefork_worker *w = ws+i;
+      if (w->pid != -1 || !w->restart) { continue; }
+
+      if (stopping) {
+	w->restart = 0;
+	nalive--;
+	continue;
+      }
+      
+      if (w->restart > now) {
+	if (!next || w->restart < next) { next = w->restart; }
+	continue;
+      }
+
+      pid_t pid = spawn(w, &prev);
+      
+      if (!pid) {
+	id = i+1;
+	goto exit;
+      }
+
+      if (pid == -1) {
+	w->restart = now+1;
+	if (!next || w->restart < next) { next = w->restart; }
+      }
+    }
+
+    if (!nalive) { break; }
+    siginfo_t si;
+    struct timespec timeout = {.tv_sec = next-now, .tv_nsec = 0};
+    
+    if ((next
+	 ? sigtimedwait(&sigs, &si, &timeout)
+	 : sigwaitinfo(&sigs, &si)) == -1) {
+      if (errno == EINTR || errno == EAGAIN) { continue; }
+      cx_error(cx, cx->row, cx->col, "Failed waiting for signal: %d", errno);
+      ok = false;
+      break;
+    }
+
+    if (si.si_signo != SIGCHLD) {
+      if (si.si_signo != SIGHUP) { stopping = true; }
+      
+      for (int64_t i = 0; i < nworkers; i++) {
+	if (ws[i].pid != -1) { kill(ws[i].pid, si.si_signo); }
+      }
+
+      continue;
+    }
+
+    int status;
+    pid_t pid;
+    
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+      int64_t i = 0;
+      while (i < nworkers && ws[i].pid != pid) { i++; }
+      if (i == nworkers) { continue; }
+      struct prefork_worker *w = ws+i;
+      w->pid = -1;
+      
+      if (stopping || (WIFEXITED(status) && !WEXITSTATUS(status))) {
+	nalive--;
+	continue;
+      }
+
+      // Workers that keep crashing on startup are restarted with
+      // exponential backoff, without holding up the others
+      now = time(NULL);
+      
+      if (now - w->started < 1) {
+	w->backoff = w->backoff
+	  ? cx_min(w->backoff*2, CX_PREFORK_BACKOFF_MAX)
+	  : 1;
+      } else {
+	w->backoff = 0;
+      }
+      
+      w->restart = now+w->backoff;
+    }
+  }
+  
+ exit:
+  free(ws);
+  sigprocmask(SIG_SETMASK, &prev, NULL);
+  if (ok) { cx_box_init(cx_push(scope), cx->int_type)->as_int = id; }
+  return ok;
+}
+
+static bool exit_imp(struct cx_scope *scope) {
+  struct cx_box code = *cx_test(cx_pop(scope, false));
+  exit(code.as_int);
+}
+
 cx_lib(cx_init_sys, "cx/sys") {
   struct cx *cx = lib->cx;
     
@@ -140,5 +300,15 @@ cx_lib(cx_init_sys, "cx/sys") {
 	       cx_args(),
 	       make_dir_imp);
 
+  cx_add_cfunc(lib, "prefork",
+	       cx_args(cx_arg("n", cx->int_type)),
+	       cx_args(cx_arg(NULL, cx->int_type)),
+	       prefork_imp);
+
+  cx_add_cfunc(lib, "exit",
+	       cx_args(cx_arg("code", cx->int_type)),
+	       cx_args(),
+	       exit_imp);
+
   return true;
 }
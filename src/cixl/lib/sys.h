@@ -1,6 +1,9 @@
 #ifndef CX_LIB_SYS_H
 #define CX_LIB_SYS_H
 
+#define CX_PREFORK_MAX 1024
+#define CX_PREFORK_BACKOFF_MAX 32
+
 struct cx;
 struct cx_lib;
 
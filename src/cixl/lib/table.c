@@ -61,6 +61,7 @@ static bool put_imp(struct cx_scope *scope) {
     tbl = *cx_test(cx_pop(scope, false));
 
   bool ok = false;
+  if (!cx_check_mut(&tbl)) { goto exit; }
   if (scope->safe && !check_key_type(tbl.as_table, key.type)) { goto exit; }
   cx_table_put(tbl.as_table, &key, &val);
   ok = true;
@@ -79,6 +80,7 @@ static bool put_else_imp(struct cx_scope *scope) {
     tbl = *cx_test(cx_pop(scope, false));
 
   bool ok = false;
+  if (!cx_check_mut(&tbl)) { goto exit; }
   if (scope->safe && !check_key_type(tbl.as_table, key.type)) { goto exit; }
   
   struct cx_table_entry *e = cx_table_get(tbl.as_table, &key);
@@ -103,6 +105,7 @@ static bool delete_imp(struct cx_scope *scope) {
     tbl = *cx_test(cx_pop(scope, false));
 
   bool ok = false;
+  if (!cx_check_mut(&tbl)) { goto exit; }
   if (!check_key_type(tbl.as_table, key.type)) { goto exit; }
   cx_table_delete(tbl.as_table, &key);
   ok = true;
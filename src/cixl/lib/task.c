@@ -0,0 +1,367 @@
+#include <errno.h>
+#include <inttypes.h>
+
+#include "cixl/arg.h"
+#include "cixl/chan.h"
+#include "cixl/cx.h"
+#include "cixl/error.h"
+#include "cixl/fimp.h"
+#include "cixl/func.h"
+#include "cixl/lib.h"
+#include "cixl/iter.h"
+#include "cixl/lib/task.h"
+#include "cixl/pool.h"
+#include "cixl/poll.h"
+#include "cixl/scope.h"
+#include "cixl/stack.h"
+#include "cixl/str.h"
+#include "cixl/task.h"
+
+static bool task_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  
+  struct cx_box
+    args = *cx_test(cx_pop(scope, false)),
+    code = *cx_test(cx_pop(scope, false));
+
+  struct cx_task *t = cx_task_new(cx, cx_str_cstr(code.as_str));
+  struct cx_stack *s = args.as_ptr;
+  bool ok = true;
+  
+  cx_do_vec(&s->imp, struct cx_box, v) {
+    if (!cx_msg_init(cx_vec_push(&t->args), cx, v)) {
+      t->args.count--;
+      ok = false;
+      break;
+    }
+  }
+
+  ok = ok && cx_task_start(t);
+  
+  if (ok) {
+    cx_box_init(cx_push(scope), cx->task_type)->as_ptr = t;
+  } else {
+    cx_task_deref(t);
+  }
+
+  cx_box_deinit(&args);
+  cx_box_deinit(&code);
+  return ok;
+}
+
+static bool join_imp(struct cx_scope *scope) {
+  struct cx_box t = *cx_test(cx_pop(scope, false));
+  bool ok = cx_task_join(t.as_ptr, scope);
+  cx_box_deinit(&t);
+  return ok;
+}
+
+static bool run_pool(struct cx_scope *scope, bool map) {
+  struct cx *cx = scope->cx;
+  
+  struct cx_box
+    n = *cx_test(cx_pop(scope, false)),
+    env = *cx_test(cx_pop(scope, false)),
+    code = *cx_test(cx_pop(scope, false)),
+    in = *cx_test(cx_pop(scope, false));
+
+  bool ok = false;
+  struct cx_pool p;
+  cx_pool_init(&p, cx, cx_str_cstr(code.as_str), n.as_int);
+
+  if (n.as_int < 1 || n.as_int > CX_SCHED_MAX) {
+    cx_error(cx, cx->row, cx->col, "Invalid number of workers: %" PRId64,
+	     n.as_int);
+    goto exit;
+  }
+  
+  struct cx_stack *es = env.as_ptr;
+  
+  cx_do_vec(&es->imp, struct cx_box, v) {
+    if (!cx_msg_init(cx_vec_push(&p.env), cx, v)) {
+      p.env.count--;
+      goto exit;
+    }
+  }
+
+  struct cx_iter *it = cx_iter(&in);
+  struct cx_box v;
+  
+  while (cx_iter_next(it, &v, scope)) {
+    bool vok = cx_msg_init(cx_vec_push(&p.items), cx, &v);
+    cx_box_deinit(&v);
+    
+    if (!vok) {
+      p.items.count--;
+      cx_iter_deref(it);
+      goto exit;
+    }
+  }
+
+  cx_iter_deref(it);
+  if (!cx_pool_run(&p, map)) { goto exit; }
+  
+  if (map) {
+    struct cx_stack *out = cx_stack_new(cx);
+    cx_box_init(cx_push(scope), cx->stack_type)->as_ptr = out;
+    
+    cx_do_vec(&p.results, struct cx_msg, m) {
+      if (!cx_msg_get(m, cx, cx_vec_push(&out->imp))) {
+	out->imp.count--;
+	goto exit;
+      }
+    }
+  }
+
+  ok = true;
+ exit:
+  cx_pool_deinit(&p);
+  cx_box_deinit(&in);
+  cx_box_deinit(&code);
+  cx_box_deinit(&env);
+  return ok;
+}
+
+static bool pmap_imp(struct cx_scope *scope) {
+  return run_pool(scope, true);
+}
+
+static bool pfor_imp(struct cx_scope *scope) {
+  return run_pool(scope, false);
+}
+
+static bool push_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  
+  struct cx_box
+    v = *cx_test(cx_pop(scope, false)),
+    c = *cx_test(cx_pop(scope, false));
+
+  struct cx_msg m;
+  bool ok = cx_msg_init(&m, cx, &v);
+
+  if (ok && !cx_chan_push(c.as_ptr, &m)) {
+    cx_msg_deinit(&m);
+    cx_error(cx, cx->row, cx->col, "Chan is closed");
+    ok = false;
+  }
+  
+  cx_box_deinit(&v);
+  cx_box_deinit(&c);
+  return ok;
+}
+
+static bool pop_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  struct cx_box c = *cx_test(cx_pop(scope, false));
+  struct cx_msg m;
+  bool ok = true;
+  
+  if (cx_chan_pop(c.as_ptr, &m)) {
+    struct cx_box *out = cx_push(scope);
+
+    if (!cx_msg_get(&m, cx, out)) {
+      cx_pop(scope, false);
+      ok = false;
+    }
+
+    cx_msg_deinit(&m);
+  } else {
+    cx_box_init(cx_push(scope), cx->nil_type);
+  }
+
+  cx_box_deinit(&c);
+  return ok;
+}
+
+static bool try_pop_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  struct cx_box c = *cx_test(cx_pop(scope, false));
+  struct cx_msg m;
+  bool ok = true;
+  
+  if (cx_chan_try_pop(c.as_ptr, &m)) {
+    struct cx_box *out = cx_push(scope);
+
+    if (!cx_msg_get(&m, cx, out)) {
+      cx_pop(scope, false);
+      ok = false;
+    }
+
+    cx_msg_deinit(&m);
+  } else {
+    cx_box_init(cx_push(scope), cx->nil_type);
+  }
+
+  cx_box_deinit(&c);
+  return ok;
+}
+
+static bool new_chan(struct cx_scope *scope, enum cx_chan_kind kind) {
+  struct cx *cx = scope->cx;
+  struct cx_box n = *cx_test(cx_pop(scope, false));
+
+  if (n.as_int < 1) {
+    cx_error(cx, cx->row, cx->col, "Invalid chan capacity: %" PRId64, n.as_int);
+    return false;
+  }
+
+  struct cx_chan *c = cx_chan_new(kind, n.as_int);
+
+  if (!c) {
+    cx_error(cx, cx->row, cx->col, "Failed allocating chan: %d", errno);
+    return false;
+  }
+  
+  cx_box_init(cx_push(scope), cx->chan_type)->as_ptr = c;
+  return true;
+}
+
+static bool spsc_chan_imp(struct cx_scope *scope) {
+  return new_chan(scope, CX_CHAN_SPSC);
+}
+
+static bool mpmc_chan_imp(struct cx_scope *scope) {
+  return new_chan(scope, CX_CHAN_MPMC);
+}
+
+static bool close_imp(struct cx_scope *scope) {
+  struct cx_box c = *cx_test(cx_pop(scope, false));
+  cx_chan_close(c.as_ptr);
+  cx_box_deinit(&c);
+  return true;
+}
+
+static bool len_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  struct cx_box c = *cx_test(cx_pop(scope, false));
+  cx_box_init(cx_push(scope), cx->int_type)->as_int = cx_chan_len(c.as_ptr);
+  cx_box_deinit(&c);
+  return true;
+}
+
+static bool on_read_imp(struct cx_scope *scope) {
+  struct cx *cx = scope->cx;
+  
+  struct cx_box
+    a = *cx_test(cx_pop(scope, false)),
+    c = *cx_test(cx_pop(scope, false)),
+    p = *cx_test(cx_pop(scope, false));
+
+  struct cx_chan *ch = c.as_ptr;
+  struct cx_poll_file *pf = cx_poll_read(p.as_poll, ch->ready.fd);
+  
+  if (pf) {
+    cx_copy(&pf->read_value, &a);
+    cx_chan_watch(ch);
+  } else {
+    cx_error(cx, cx->row, cx->col, "Failed polling: %d", errno);
+  }
+
+  cx_box_deinit(&a);
+  cx_box_deinit(&c);
+  cx_box_deinit(&p);
+  return pf;
+}
+
+static bool no_read_imp(struct cx_scope *scope) {
+  struct cx_box
+    c = *cx_test(cx_pop(scope, false)),
+    p = *cx_test(cx_pop(scope, false));
+
+  struct cx_chan *ch = c.as_ptr;
+  bool ok = cx_poll_no_read(p.as_poll, ch->ready.fd);
+  if (ok) { cx_chan_unwatch(ch); }
+  
+  cx_box_deinit(&c);
+  cx_box_deinit(&p);
+  return ok;
+}
+
+cx_lib(cx_init_task, "cx/task") {    
+  struct cx *cx = lib->cx;
+    
+  if (!cx_use(cx, "cx/abc", "Int", "Opt", "Seq", "Stack", "Str") ||
+      !cx_use(cx, "cx/io/buf", "Buf") ||
+      !cx_use(cx, "cx/io/poll", "Poll")) {
+    return false;
+  }
+
+  cx->chan_type = cx_init_chan_type(lib);
+  cx->task_type = cx_init_task_type(lib);
+
+  cx_add_cfunc(lib, "task",
+	       cx_args(cx_arg("code", cx->str_type), cx_arg("args", cx->stack_type)),
+	       cx_args(cx_arg(NULL, cx->task_type)),
+	       task_imp);
+
+  cx_add_cfunc(lib, "join-task",
+	       cx_args(cx_arg("t", cx->task_type)),
+	       cx_args(cx_arg(NULL, cx->stack_type)),
+	       join_imp);
+
+  cx_add_cfunc(lib, "pmap",
+	       cx_args(cx_arg("in", cx->seq_type),
+		       cx_arg("code", cx->str_type),
+		       cx_arg("env", cx->stack_type),
+		       cx_arg("n", cx->int_type)),
+	       cx_args(cx_arg(NULL, cx->stack_type)),
+	       pmap_imp);
+
+  cx_add_cfunc(lib, "pfor",
+	       cx_args(cx_arg("in", cx->seq_type),
+		       cx_arg("code", cx->str_type),
+		       cx_arg("env", cx->stack_type),
+		       cx_arg("n", cx->int_type)),
+	       cx_args(),
+	       pfor_imp);
+
+  cx_add_cfunc(lib, "push",
+	       cx_args(cx_arg("c", cx->chan_type), cx_arg("v", cx->opt_type)),
+	       cx_args(),
+	       push_imp);
+
+  cx_add_cfunc(lib, "pop",
+	       cx_args(cx_arg("c", cx->chan_type)),
+	       cx_args(cx_arg(NULL, cx->opt_type)),
+	       pop_imp);
+
+  cx_add_cfunc(lib, "try-pop",
+	       cx_args(cx_arg("c", cx->chan_type)),
+	       cx_args(cx_arg(NULL, cx->opt_type)),
+	       try_pop_imp);
+
+  cx_add_cfunc(lib, "spsc-chan",
+	       cx_args(cx_arg("n", cx->int_type)),
+	       cx_args(cx_arg(NULL, cx->chan_type)),
+	       spsc_chan_imp);
+
+  cx_add_cfunc(lib, "mpmc-chan",
+	       cx_args(cx_arg("n", cx->int_type)),
+	       cx_args(cx_arg(NULL, cx->chan_type)),
+	       mpmc_chan_imp);
+
+  cx_add_cfunc(lib, "close",
+	       cx_args(cx_arg("c", cx->chan_type)),
+	       cx_args(),
+	       close_imp);
+
+  cx_add_cfunc(lib, "len",
+	       cx_args(cx_arg("c", cx->chan_type)),
+	       cx_args(cx_arg(NULL, cx->int_type)),
+	       len_imp);
+
+  cx_add_cfunc(lib, "on-read",
+	       cx_args(cx_arg("p", cx->poll_type),
+		       cx_arg("c", cx->chan_type),
+		       cx_arg("a", cx->any_type)),
+	       cx_args(),
+	       on_read_imp);
+
+  cx_add_cfunc(lib, "no-read",
+	       cx_args(cx_arg("p", cx->poll_type), cx_arg("c", cx->chan_type)),
+	       cx_args(),
+	       no_read_imp);
+
+  return true;
+}
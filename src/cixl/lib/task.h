@@ -0,0 +1,9 @@
+#ifndef CX_LIB_TASK_H
+#define CX_LIB_TASK_H
+
+struct cx;
+struct cx_lib;
+
+struct cx_lib *cx_init_task(struct cx *cx);
+
+#endif
@@ -14,7 +14,7 @@
 
 static bool ask_imp(struct cx_scope *scope) {
   struct cx_box p = *cx_test(cx_pop(scope, false));
-  fputs(p.as_str->data, stdout);
+  fputs(cx_str_cstr(p.as_str), stdout);
   cx_box_deinit(&p);
   char *line = NULL;
   size_t len = 0;
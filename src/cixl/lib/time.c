@@ -379,7 +379,7 @@ static bool fmt_imp(struct cx_scope *scope) {
     f = *cx_test(cx_pop(scope, false)),
     t = *cx_test(cx_pop(scope, false));
 
-  char *s = cx_time_fmt(&t.as_time, f.as_str->data);
+  char *s = cx_time_fmt(&t.as_time, cx_str_cstr(f.as_str));
   cx_box_init(cx_push(scope), cx->str_type)->as_str = cx_str_new(s, strlen(s));
   free(s);
   
@@ -0,0 +1,95 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cixl/box.h"
+#include "cixl/cx.h"
+#include "cixl/iter.h"
+#include "cixl/lib.h"
+#include "cixl/mmap.h"
+#include "cixl/str.h"
+#include "cixl/type.h"
+
+static size_t map_len(size_t len) {
+  size_t ps = sysconf(_SC_PAGESIZE);
+  return (len + ps-1) / ps * ps + ps;
+}
+
+static void release(struct cx_str *s) {
+  munmap(s->data, map_len(s->len));
+}
+
+struct cx_str *cx_mmap(const char *path) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd == -1) { return NULL; }
+  struct cx_str *s = NULL;
+  struct stat st;
+  if (fstat(fd, &st) == -1) { goto exit; }
+
+  if (!st.st_size) {
+    s = cx_str_new(NULL, 0);
+    goto exit;
+  }
+
+  // The trailing anonymous page keeps the mapping zero terminated
+  size_t len = map_len(st.st_size);
+  char *p = mmap(NULL, len, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED) { goto exit; }
+
+  if (mmap(p, st.st_size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) ==
+      MAP_FAILED) {
+    munmap(p, len);
+    goto exit;
+  }
+
+  madvise(p, st.st_size, MADV_SEQUENTIAL);
+  s = cx_str_extern(p, st.st_size, release);
+ exit:
+  close(fd);
+  return s;
+}
+
+static bool equid_imp(struct cx_box *x, struct cx_box *y) {
+  return x->as_str == y->as_str;
+}
+
+static bool ok_imp(struct cx_box *v) {
+  return v->as_str->len;
+}
+
+static void copy_imp(struct cx_box *dst, const struct cx_box *src) {
+  dst->as_str = cx_str_ref(src->as_str);
+}
+
+static struct cx_iter *iter_imp(struct cx_box *v) {
+  struct cx *cx = v->type->lib->cx;
+  struct cx_box s = {.type = cx->str_type, .as_str = v->as_str};
+  return cx->str_type->iter(&s);
+}
+
+static void dump_imp(struct cx_box *v, FILE *out) {
+  struct cx_str *s = v->as_str;
+  fprintf(out, "MFile(%p:%zd)r%d", s->data, s->len, s->nrefs);
+}
+
+static void print_imp(struct cx_box *v, FILE *out) {
+  fwrite(v->as_str->data, 1, v->as_str->len, out);
+}
+
+static void deinit_imp(struct cx_box *v) {
+  cx_str_deref(v->as_str);
+}
+
+struct cx_type *cx_init_mfile_type(struct cx_lib *lib) {
+  struct cx *cx = lib->cx;
+  struct cx_type *t = cx_add_type(lib, "MFile", cx->seq_type);
+  t->equid = equid_imp;
+  t->ok = ok_imp;
+  t->copy = copy_imp;
+  t->iter = iter_imp;
+  t->dump = dump_imp;
+  t->print = print_imp;
+  t->deinit = deinit_imp;
+  return t;
+}
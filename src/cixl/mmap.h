@@ -0,0 +1,11 @@
+#ifndef CX_MMAP_H
+#define CX_MMAP_H
+
+struct cx_lib;
+struct cx_str;
+struct cx_type;
+
+struct cx_str *cx_mmap(const char *path);
+struct cx_type *cx_init_mfile_type(struct cx_lib *lib);
+
+#endif
@@ -2,6 +2,7 @@
 #include "cixl/box.h"
 #include "cixl/error.h"
 #include "cixl/nil.h"
+#include "cixl/pack.h"
 #include "cixl/scope.h"
 
 static bool equid_imp(struct cx_box *x, struct cx_box *y) {
@@ -21,6 +22,17 @@ static bool emit_imp(struct cx_box *v, const char *exp, FILE *out) {
   return true;
 }
 
+static bool pack_imp(struct cx_box *v, struct cx_buf *out) {
+  return true;
+}
+
+static bool unpack_imp(struct cx_type *t,
+		       struct cx_unpack *in,
+		       struct cx_box *out) {
+  cx_box_init(out, t);
+  return true;
+}
+
 struct cx_type *cx_init_nil_type(struct cx_lib *lib) {
   struct cx *cx = lib->cx;
   struct cx_type *t = cx_add_type(lib, "Nil", cx->opt_type);
@@ -29,5 +41,7 @@ struct cx_type *cx_init_nil_type(struct cx_lib *lib) {
   t->write = dump_imp;
   t->dump = dump_imp;
   t->emit = emit_imp;
+  t->pack = pack_imp;
+  t->unpack = unpack_imp;
   return t;
 }
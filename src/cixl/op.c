@@ -22,6 +22,7 @@ static bool emit(struct cx_op *op, struct cx_bin *bin, FILE *out, struct cx *cx)
 
 struct cx_op_type *cx_op_type_init(struct cx_op_type *type, const char *id) {
   type->id = id;
+  type->emit_pos = type->emit_check = true;
   type->init = NULL;
   type->deinit = NULL;
   type->eval = NULL;
@@ -69,8 +70,8 @@ static bool begin_emit(struct cx_op *op,
     struct cx_fimp *imp = op->as_begin.fimp;
 
     fprintf(out,
-	    "%s()->scope;\n"
-	    "cx_push_lib(cx, %s());\n",
+	    "%s(cx)->scope;\n"
+	    "cx_push_lib(cx, %s(cx));\n",
 	    imp->emit_id, imp->lib->emit_id);
   }
 
@@ -97,6 +98,7 @@ static void begin_emit_fimps(struct cx_op *op, struct cx_set *out, struct cx *cx
 }
 
 cx_op_type(CX_OBEGIN, {
+    type.emit_pos = type.emit_check = false;
     type.eval = begin_eval;
     type.emit = begin_emit;
     type.emit_funcs = begin_emit_funcs;
@@ -121,7 +123,7 @@ static bool catch_emit(struct cx_op *op,
 			struct cx *cx) {
   fprintf(out,
 	  "cx_catch_init(cx_vec_push(&cx_scope(cx, 0)->catches),\n"
-	  "              %s(), cx->bin, %zd, %zd, %zd, cx->stop_pc);\n",
+	  "              %s(cx), cx->bin, %zd, %zd, %zd, cx->stop_pc);\n",
 	  op->as_catch.type->emit_id, op->tok_idx, op->pc+1, op->as_catch.nops);
 
   fprintf(out, "goto op%zd;\n", op->pc+op->as_catch.nops+1);
@@ -134,6 +136,12 @@ static void catch_emit_labels(struct cx_op *op, struct cx_set *out, struct cx *c
     *ok = cx_set_insert(out, &pc);
   
   if (ok) { *ok = pc; }
+
+  // Nil catches stop before their last op
+  pc = op->pc+op->as_catch.nops;
+  ok = cx_set_insert(out, &pc);
+  if (ok) { *ok = pc; }
+
   pc = op->pc+op->as_catch.nops+1;  
   ok = cx_set_insert(out, &pc);
   if (ok) { *ok = pc; }
@@ -148,6 +156,7 @@ static void catch_emit_types(struct cx_op *op, struct cx_set *out, struct cx *cx
 }
 
 cx_op_type(CX_OCATCH, {
+    type.emit_pos = type.emit_check = false;
     type.eval = catch_eval;
     type.emit = catch_emit;
     type.emit_labels = catch_emit_labels;
@@ -226,13 +235,10 @@ static bool fimp_emit(struct cx_op *op,
 
 static void fimp_emit_labels(struct cx_op *op, struct cx_set *out, struct cx *cx) {
   size_t
-    pc = op->as_fimp.imp->start_pc,
+    pc = op->pc+op->as_fimp.imp->nops+1,
     *ok = cx_set_insert(out, &pc);
   
   if (ok) { *ok = pc; }
-  pc = op->pc+op->as_fimp.imp->nops+1;
-  ok = cx_set_insert(out, &pc);
-  if (ok) { *ok = pc; }
 }
 
 static void fimp_emit_init(struct cx_op *op,
@@ -243,8 +249,8 @@ static void fimp_emit_init(struct cx_op *op,
   struct cx_sym imp_var = cx_gsym(cx, "imp");
   
   fprintf(out,
-	  "cx_push_lib(cx, %s());\n"
-	  "struct cx_fimp *%s = %s();\n"
+	  "cx_push_lib(cx, %s(cx));\n"
+	  "struct cx_fimp *%s = %s(cx);\n"
 	  "cx_pop_lib(cx);\n"
 	  "%s->bin = cx_bin_ref(cx->bin);\n"
 	  "%s->start_pc = %zd;\n"
@@ -273,6 +279,7 @@ static void fimp_emit_fimps(struct cx_op *op, struct cx_set *out, struct cx *cx)
 }
 
 cx_op_type(CX_OFIMP, {
+    type.emit_pos = type.emit_check = false;
     type.eval = fimp_eval;
     type.emit = fimp_emit;
     type.emit_init = fimp_emit_init;
@@ -292,7 +299,7 @@ static bool funcdef_emit(struct cx_op *op,
 			 FILE *out,
 			 struct cx *cx) {
   fprintf(out,
-	  "struct cx_fimp *i = %s();\n"
+	  "struct cx_fimp *i = %s(cx);\n"
 	  "if (!i->scope) { i->scope = cx_scope_ref(cx_scope(cx, 0)); }\n",
 	  op->as_funcdef.imp->emit_id);
   
@@ -362,6 +369,7 @@ static void funcdef_emit_syms(struct cx_op *op, struct cx_set *out, struct cx *c
 }
 
 cx_op_type(CX_OFUNCDEF, {
+    type.emit_pos = type.emit_check = false;
     type.eval = funcdef_eval;
     type.emit = funcdef_emit;
     type.emit_init = funcdef_emit_init;
@@ -401,12 +409,12 @@ static bool funcall_emit(struct cx_op *op,
   struct cx_fimp *imp = op->as_funcall.imp;
 
   fputs("struct cx_scope *s = cx_scope(cx, 0);\n", out);
-  fprintf(out, "struct cx_func *func = %s();\n", func->emit_id);
+  fprintf(out, "struct cx_func *func = %s(cx);\n", func->emit_id);
   fputs("struct cx_fimp *imp = ", out);
   
   if (imp) {
     fprintf(out,
-	    "%s();\n\n"
+	    "%s(cx);\n\n"
 	    "if (s->safe && !cx_fimp_match(imp, s)) { imp = NULL; }\n\n",
 	    imp->emit_id);
   } else {
@@ -419,13 +427,16 @@ static bool funcall_emit(struct cx_op *op,
 	"}\n\n",
 	out);
 
-  if (imp) {
+  // Fimps inlined in the same bin are emitted as functions and called directly
+  if (imp && !imp->ptr && imp->bin == bin) {
     fprintf(out,
 	    "if (!imp->ptr && imp->bin == cx->bin) {\n"
-	    "  cx_call_init(cx_vec_push(&cx->calls), cx->row, cx->col, imp, %zd);\n"
-	    "  goto op%zd;\n"
+	    "  if (cx->coro && !cx_coro_check(cx->coro)) { goto exit; }\n"
+	    "  cx_call_init(cx_vec_push(&cx->calls), cx->row, cx->col, imp, -1);\n"
+	    "  cx->pc = %zd;\n"
+	    "  if (!unit%zd(cx, -1)) { goto exit; }\n"
 	    "} else ",
-	    op->pc+1, imp->start_pc);
+	    imp->start_pc, imp->start_pc);
   }
   
   fputs("if (!cx_fimp_call(imp, s)) { goto exit; }\n",
@@ -434,14 +445,6 @@ static bool funcall_emit(struct cx_op *op,
   return true;
 }
 
-static void funcall_emit_labels(struct cx_op *op, struct cx_set *out, struct cx *cx) {
-  size_t
-    pc = op->pc+1,
-    *ok = cx_set_insert(out, &pc);
-  
-  if (ok) { *ok = pc; }
-}
-
 static void funcall_emit_funcs(struct cx_op *op, struct cx_set *out, struct cx *cx) {
   struct cx_func
     *func = op->as_funcall.func,
@@ -462,7 +465,6 @@ static void funcall_emit_fimps(struct cx_op *op, struct cx_set *out, struct cx *
 cx_op_type(CX_OFUNCALL, {
     type.eval = funcall_eval;
     type.emit = funcall_emit;
-    type.emit_labels = funcall_emit_labels;
     type.emit_funcs = funcall_emit_funcs;
     type.emit_fimps = funcall_emit_fimps;
   });
@@ -497,6 +499,7 @@ static void getconst_emit_syms(struct cx_op *op, struct cx_set *out, struct cx *
 }
 
 cx_op_type(CX_OGETCONST, {
+    type.emit_check = false;
     type.eval = getconst_eval;
     type.emit = getconst_emit;
     type.emit_syms = getconst_emit_syms;
@@ -535,6 +538,7 @@ static void getvar_emit_syms(struct cx_op *op, struct cx_set *out, struct cx *cx
 }
 
 cx_op_type(CX_OGETVAR, {
+    type.emit_check = false;
     type.eval = getvar_eval;
     type.emit = getvar_emit;
     type.emit_syms = getvar_emit_syms;
@@ -562,6 +566,7 @@ static void jump_emit_labels(struct cx_op *op, struct cx_set *out, struct cx *cx
 }
 
 cx_op_type(CX_OJUMP, {
+    type.emit_pos = type.emit_check = false;
     type.eval = jump_eval;
     type.emit = jump_emit;
     type.emit_labels = jump_emit_labels;
@@ -592,16 +597,14 @@ static bool lambda_emit(struct cx_op *op,
 
 static void lambda_emit_labels(struct cx_op *op, struct cx_set *out, struct cx *cx) {
   size_t
-    pc = op->as_lambda.start_op,
+    pc = op->pc+op->as_lambda.nops+1,
     *ok = cx_set_insert(out, &pc);
   
   if (ok) { *ok = pc; }
-  pc = op->pc+op->as_lambda.nops+1;
-  ok = cx_set_insert(out, &pc);
-  if (ok) { *ok = pc; }  
 }
 
 cx_op_type(CX_OLAMBDA, {
+    type.emit_pos = type.emit_check = false;
     type.eval = lambda_eval;
     type.emit = lambda_emit;
     type.emit_labels = lambda_emit_labels;
@@ -653,6 +656,7 @@ static void libdef_emit_labels(struct cx_op *op, struct cx_set *out, struct cx *
 }
 
 cx_op_type(CX_OLIBDEF, {
+    type.emit_pos = type.emit_check = false;
     type.eval = libdef_eval;
     type.emit = libdef_emit;
     type.emit_init = libdef_emit_init;
@@ -700,6 +704,7 @@ static void poplib_emit_init(struct cx_op *op,
 }
 
 cx_op_type(CX_OPOPLIB, {
+    type.emit_pos = type.emit_check = false;
     type.eval = poplib_eval;
     type.emit = poplib_emit;
     type.emit_init = poplib_emit_init;
@@ -761,6 +766,7 @@ static void push_emit_types(struct cx_op *op, struct cx_set *out, struct cx *cx)
 }
 
 cx_op_type(CX_OPUSH, {
+    type.emit_pos = type.emit_check = false;
     type.deinit = push_deinit;
     type.eval = push_eval;
     type.emit = push_emit;
@@ -780,7 +786,7 @@ static bool pushlib_emit(struct cx_op *op,
 			 FILE *out,
 			 struct cx *cx) {
   fprintf(out,
-	  "cx_push_lib(cx, %s());\n",
+	  "cx_push_lib(cx, %s(cx));\n",
 	  op->as_pushlib.lib->emit_id);
 
   return true;
@@ -791,7 +797,7 @@ static void pushlib_emit_init(struct cx_op *op,
 			      FILE *out,
 			      struct cx *cx) {
   fprintf(out,
-	  "cx_push_lib(cx, %s());\n",
+	  "cx_push_lib(cx, %s(cx));\n",
 	  op->as_pushlib.lib->emit_id);
 }
 
@@ -806,6 +812,7 @@ static void pushlib_emit_libs(struct cx_op *op,
 }
 
 cx_op_type(CX_OPUSHLIB, {
+    type.emit_pos = type.emit_check = false;
     type.eval = pushlib_eval;
     type.emit = pushlib_emit;
     type.emit_init = pushlib_emit_init;
@@ -1006,7 +1013,7 @@ static bool putvar_emit(struct cx_op *op,
 
   if (op->as_putvar.type) {
     fprintf(out,
-	    "if (!cx_is(src->type, %s())) {\n"
+	    "if (!cx_is(src->type, %s(cx))) {\n"
 	    "  cx_error(cx, cx->row, cx->col,\n"
 	    "           \"Expected type %s, actual: %%s\",\n"
 	    "           src->type->id);\n\n"
@@ -1151,7 +1158,7 @@ static bool return_emit(struct cx_op *op,
 	out);
 
   fprintf(out,
-	  "  if (s->safe && !cx_fimp_match(%s(), s)) {\n"
+	  "  if (s->safe && !cx_fimp_match(%s(cx), s)) {\n"
 	  "    cx_error(cx, cx->row, cx->col, \"Recall not applicable\");\n"
 	  "    goto exit;\n"
 	  "  }\n\n"
@@ -1202,7 +1209,7 @@ static bool return_emit(struct cx_op *op,
 
       switch (r->arg_type) {
       case CX_ARG:
-	fprintf(out, "     struct cx_type *t = %s();\n", r->type->emit_id);
+	fprintf(out, "     struct cx_type *t = %s(cx);\n", r->type->emit_id);
 	break;
       case CX_NARG: {
 	struct cx_arg *a = cx_vec_get(&imp->args, r->narg);
@@ -1241,15 +1248,7 @@ static bool return_emit(struct cx_op *op,
 	  "  cx_vec_clear(&s->stack);\n"
 	  "  cx_end(cx);\n"
 	  "  cx_pop_lib(cx);\n"
-	  "  struct cx_call *call = cx_vec_pop(&cx->calls);\n\n"
-	  
-	  "  if (call->return_pc > -1) {\n"
-	  "    cx->pc = call->return_pc;\n"
-	  "    cx_call_deinit(call);\n"
-	  "    goto *op_labels[cx->pc];\n"
-	  "  }\n\n"
-
-	  "  cx_call_deinit(call);\n"
+	  "  cx_call_deinit(cx_vec_pop(&cx->calls));\n"
 	  "}\n");
   
   return true;  
@@ -1315,6 +1314,7 @@ static bool stash_emit(struct cx_op *op,
 }
 
 cx_op_type(CX_OSTASH, {
+    type.emit_pos = type.emit_check = false;
     type.eval = stash_eval;
     type.emit = stash_emit;
   });
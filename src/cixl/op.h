@@ -4,17 +4,16 @@
 #include <stdbool.h>
 
 #include "cixl/box.h"
+#include "cixl/util.h"
 
 #define cx_op_type(id, ...)			\
   struct cx_op_type *id() {			\
     static struct cx_op_type type;		\
-    static bool init = true;			\
 						\
-    if (init) {					\
-      init = false;				\
-      cx_op_type_init(&type, #id);		\
-      __VA_ARGS__;				\
-    }						\
+    cx_once({					\
+	cx_op_type_init(&type, #id);		\
+	__VA_ARGS__;				\
+      });					\
 						\
     return &type;				\
   }						\
@@ -27,6 +26,10 @@ struct cx_tok;
   
 struct cx_op_type {
   const char *id;
+
+  // Emitted ops store their position unless they can't raise errors,
+  // and check for errors after unless they always fail when they do.
+  bool emit_pos, emit_check;
   
   void (*init)(struct cx_op *, struct cx_tok *);
   void (*deinit)(struct cx_op *);
@@ -0,0 +1,257 @@
+#include <inttypes.h>
+#include <string.h>
+
+#include "cixl/box.h"
+#include "cixl/buf.h"
+#include "cixl/cx.h"
+#include "cixl/error.h"
+#include "cixl/lib.h"
+#include "cixl/pack.h"
+#include "cixl/type.h"
+
+void cx_pack_uint(struct cx_buf *out, uint64_t v) {
+  unsigned char *p = (unsigned char *)cx_buf_reserve(out, 10), *start = p;
+
+  while (v >= 0x80) {
+    *p++ = (v & 0x7f) | 0x80;
+    v >>= 7;
+  }
+
+  *p++ = v;
+  cx_buf_commit(out, p-start);
+}
+
+void cx_pack_int(struct cx_buf *out, int64_t v) {
+  // Zigzag keeps small negative numbers short
+  cx_pack_uint(out, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+void cx_pack_bytes(struct cx_buf *out, const char *data, size_t len) {
+  cx_pack_uint(out, len);
+  cx_buf_write(out, data, len);
+}
+
+static struct cx_type **core_types(struct cx *cx, struct cx_type **out) {
+  // Core types are packed as codes, indexes are part of the format
+  out[0] = NULL;
+  out[1] = cx->nil_type;
+  out[2] = cx->bool_type;
+  out[3] = cx->char_type;
+  out[4] = cx->int_type;
+  out[5] = cx->str_type;
+  out[6] = cx->sym_type;
+  out[7] = cx->rat_type;
+  out[8] = cx->time_type;
+  out[9] = cx->pair_type;
+  out[10] = cx->stack_type;
+  out[11] = cx->table_type;
+  return out;
+}
+
+bool cx_pack_id(struct cx *cx, const char *id, struct cx_buf *out) {
+  size_t len = strlen(id);
+
+  // Ids are capped to keep unpacking on the stack
+  if (len > CX_PACK_MAX_ID) {
+    cx_error(cx, cx->row, cx->col, "Id too long to pack: %s", id);
+    return false;
+  }
+
+  cx_pack_bytes(out, id, len);
+  return true;
+}
+
+bool cx_pack_box(struct cx_box *v, struct cx_buf *out) {
+  struct cx_type *t = v->type;
+  struct cx *cx = t->lib->cx;
+
+  if (!t->pack) {
+    cx_error(cx, cx->row, cx->col, "Pack not implemented for type: %s", t->id);
+    return false;
+  }
+
+  struct cx_type *ts[CX_PACK_CORE_TYPES];
+  core_types(cx, ts);
+  uint64_t code = 0;
+  
+  for (uint64_t i = 1; i < CX_PACK_CORE_TYPES; i++) {
+    if (ts[i] == t) {
+      code = i;
+      break;
+    }
+  }
+
+  cx_pack_uint(out, code);
+  if (!code && !cx_pack_id(cx, t->id, out)) { return false; }
+  return t->pack(v, out);
+}
+
+bool cx_pack(struct cx_box *v, struct cx_buf *out) {
+  size_t len = cx_buf_len(out);
+  *cx_buf_reserve(out, 1) = CX_PACK_VERSION;
+  cx_buf_commit(out, 1);
+  if (cx_pack_box(v, out)) { return true; }
+  out->wpos = out->rpos+len;
+  return false;
+}
+
+static const void *get_type_id(const void *value) {
+  struct cx_type *const *t = value;
+  return &(*t)->id;
+}
+
+struct cx_set *cx_unpack_types_init(struct cx_set *types) {
+  cx_set_init(types, sizeof(struct cx_type *), cx_cmp_cstr);
+  types->key = get_type_id;
+  return types;
+}
+
+struct cx_unpack *cx_unpack_init(struct cx_unpack *in,
+				 struct cx *cx,
+				 const char *data,
+				 size_t len,
+				 struct cx_set *types) {
+  in->cx = cx;
+  in->pos = data;
+  in->end = data+len;
+  in->types = types;
+  in->depth = 0;
+  in->eof = false;
+  return in;
+}
+
+bool cx_unpack_uint(struct cx_unpack *in, uint64_t *out) {
+  *out = 0;
+
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (in->pos == in->end) {
+      in->eof = true;
+      return false;
+    }
+
+    unsigned char b = *in->pos++;
+    *out |= (uint64_t)(b & 0x7f) << shift;
+    if (!(b & 0x80)) { return true; }
+  }
+
+  struct cx *cx = in->cx;
+  cx_error(cx, cx->row, cx->col, "Invalid packed int");
+  return false;
+}
+
+bool cx_unpack_int(struct cx_unpack *in, int64_t *out) {
+  uint64_t v = 0;
+  if (!cx_unpack_uint(in, &v)) { return false; }
+  *out = (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+  return true;
+}
+
+const char *cx_unpack_bytes(struct cx_unpack *in, size_t *len) {
+  uint64_t n = 0;
+  if (!cx_unpack_uint(in, &n)) { return NULL; }
+
+  if (n > in->end-in->pos) {
+    in->eof = true;
+    return NULL;
+  }
+
+  const char *data = in->pos;
+  in->pos += n;
+  *len = n;
+  return data;
+}
+
+bool cx_unpack_id(struct cx_unpack *in, char *out) {
+  size_t len = 0;
+  const char *data = cx_unpack_bytes(in, &len);
+  if (!data) { return false; }
+
+  if (len > CX_PACK_MAX_ID) {
+    struct cx *cx = in->cx;
+    cx_error(cx, cx->row, cx->col, "Invalid packed id");
+    return false;
+  }
+
+  memcpy(out, data, len);
+  out[len] = 0;
+  return true;
+}
+
+static struct cx_type *find_type(struct cx_unpack *in, const char *id) {
+  struct cx *cx = in->cx;
+  struct cx_type **found = cx_set_get(in->types, &id);
+  if (found) { return *found; }
+  struct cx_type *t = cx_get_type(cx, id, true);
+
+  if (!t) {
+    // Packed types don't have to be visible from the current lib
+    cx_do_vec(&cx->types, struct cx_type *, tp) {
+      if (strcmp((*tp)->id, id) == 0) {
+	t = *tp;
+	break;
+      }
+    }
+  }
+
+  if (!t) {
+    cx_error(cx, cx->row, cx->col, "Unknown packed type: %s", id);
+    return NULL;
+  }
+  
+  if (!t->unpack) {
+    cx_error(cx, cx->row, cx->col, "Unpack not implemented for type: %s", id);
+    return NULL;
+  }
+
+  *(struct cx_type **)cx_test(cx_set_insert(in->types, &id)) = t;
+  return t;
+}
+
+bool cx_unpack_box(struct cx_unpack *in, struct cx_box *out) {
+  struct cx *cx = in->cx;
+  uint64_t code = 0;
+  if (!cx_unpack_uint(in, &code)) { return false; }
+  struct cx_type *t = NULL;
+  
+  if (code) {
+    if (code >= CX_PACK_CORE_TYPES) {
+      cx_error(cx, cx->row, cx->col, "Invalid packed type: %" PRIu64, code);
+      return false;
+    }
+
+    struct cx_type *ts[CX_PACK_CORE_TYPES];
+    t = core_types(cx, ts)[code];
+  } else {
+    char id[CX_PACK_MAX_ID+1];
+    if (!cx_unpack_id(in, id)) { return false; }
+    t = find_type(in, id);
+    if (!t) { return false; }
+  }
+
+  // Nesting is limited to keep malicious input from exhausting the stack
+  if (in->depth == CX_PACK_MAX_DEPTH) {
+    cx_error(cx, cx->row, cx->col, "Invalid pack");
+    return false;
+  }
+
+  in->depth++;
+  bool ok = t->unpack(t, in, out);
+  in->depth--;
+  return ok;
+}
+
+bool cx_unpack(struct cx_unpack *in, struct cx_box *out) {
+  if (in->pos == in->end) {
+    in->eof = true;
+    return false;
+  }
+
+  if (*in->pos != CX_PACK_VERSION) {
+    struct cx *cx = in->cx;
+    cx_error(cx, cx->row, cx->col, "Invalid pack version: %d", *in->pos);
+    return false;
+  }
+
+  in->pos++;
+  return cx_unpack_box(in, out);
+}
@@ -0,0 +1,50 @@
+#ifndef CX_PACK_H
+#define CX_PACK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "cixl/set.h"
+
+#define CX_PACK_VERSION 1
+#define CX_PACK_MAX_ID 255
+#define CX_PACK_CORE_TYPES 12
+#define CX_PACK_MAX_DEPTH 256
+
+struct cx;
+struct cx_box;
+struct cx_buf;
+struct cx_type;
+
+struct cx_unpack {
+  struct cx *cx;
+  const char *pos, *end;
+  struct cx_set *types;
+  int depth;
+  bool eof;
+};
+
+void cx_pack_uint(struct cx_buf *out, uint64_t v);
+void cx_pack_int(struct cx_buf *out, int64_t v);
+void cx_pack_bytes(struct cx_buf *out, const char *data, size_t len);
+bool cx_pack_id(struct cx *cx, const char *id, struct cx_buf *out);
+bool cx_pack_box(struct cx_box *v, struct cx_buf *out);
+bool cx_pack(struct cx_box *v, struct cx_buf *out);
+
+struct cx_unpack *cx_unpack_init(struct cx_unpack *in,
+				 struct cx *cx,
+				 const char *data,
+				 size_t len,
+				 struct cx_set *types);
+
+struct cx_set *cx_unpack_types_init(struct cx_set *types);
+
+bool cx_unpack_uint(struct cx_unpack *in, uint64_t *out);
+bool cx_unpack_int(struct cx_unpack *in, int64_t *out);
+const char *cx_unpack_bytes(struct cx_unpack *in, size_t *len);
+bool cx_unpack_id(struct cx_unpack *in, char *out);
+bool cx_unpack_box(struct cx_unpack *in, struct cx_box *out);
+bool cx_unpack(struct cx_unpack *in, struct cx_box *out);
+
+#endif
@@ -1,26 +1,27 @@
 #include "cixl/cx.h"
 #include "cixl/error.h"
 #include "cixl/malloc.h"
+#include "cixl/pack.h"
 #include "cixl/pair.h"
 
 struct cx_pair *cx_pair_new(struct cx *cx, struct cx_box *x, struct cx_box *y) {
   struct cx_pair *pair = cx_malloc(&cx->pair_alloc);
   if (x) { cx_copy(&pair->x, x); }
   if (y) { cx_copy(&pair->y, y); }
+  pair->frozen = false;
   pair->nrefs = 1;
   return pair;
 }
 
 struct cx_pair *cx_pair_ref(struct cx_pair *pair) {
-  pair->nrefs++;
+  cx_nrefs_inc(pair);
   return pair;
 }
 
 void cx_pair_deref(struct cx_pair *pair, struct cx *cx) {
   cx_test(pair->nrefs);
-  pair->nrefs--;
   
-  if (!pair->nrefs) {
+  if (!cx_nrefs_dec(pair)) {
     cx_box_deinit(&pair->x);
     cx_box_deinit(&pair->y);
     cx_free(&cx->pair_alloc, pair);
@@ -80,10 +81,45 @@ static void print_imp(struct cx_box *v, FILE *out) {
   cx_print(&v->as_pair->y, out);
 }
 
+static bool freeze_imp(struct cx_box *v) {
+  struct cx_pair *p = v->as_pair;
+  if (p->frozen) { return true; }
+  p->frozen = true;
+  return cx_freeze(&p->x) && cx_freeze(&p->y);
+}
+
+static bool frozen_imp(struct cx_box *v) {
+  return v->as_pair->frozen;
+}
+
 static void deinit_imp(struct cx_box *v) {
   cx_pair_deref(v->as_pair, v->type->lib->cx);
 }
 
+static bool pack_imp(struct cx_box *v, struct cx_buf *out) {
+  return
+    cx_pack_box(&v->as_pair->x, out) &&
+    cx_pack_box(&v->as_pair->y, out);
+}
+
+static bool unpack_imp(struct cx_type *t,
+		       struct cx_unpack *in,
+		       struct cx_box *out) {
+  struct cx_box x, y;
+  if (!cx_unpack_box(in, &x)) { return false; }
+
+  if (!cx_unpack_box(in, &y)) {
+    cx_box_deinit(&x);
+    return false;
+  }
+
+  struct cx_pair *p = cx_pair_new(in->cx, NULL, NULL);
+  p->x = x;
+  p->y = y;
+  cx_box_init(out, t)->as_pair = p;
+  return true;
+}
+
 struct cx_type *cx_init_pair_type(struct cx_lib *lib) {
   struct cx_type *t = cx_add_type(lib, "Pair", lib->cx->cmp_type);
   t->eqval = eqval_imp;
@@ -95,6 +131,10 @@ struct cx_type *cx_init_pair_type(struct cx_lib *lib) {
   t->write = write_imp;
   t->dump = dump_imp;
   t->print = print_imp;
+  t->pack = pack_imp;
+  t->unpack = unpack_imp;
+  t->freeze = freeze_imp;
+  t->frozen = frozen_imp;
   t->deinit = deinit_imp;
   return t;
 }
@@ -9,6 +9,7 @@ struct cx_type;
 
 struct cx_pair {
   struct cx_box x, y;
+  bool frozen;
   unsigned int nrefs;
 };
 
@@ -1,4 +1,7 @@
-#include <poll.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "cixl/box.h"
 #include "cixl/cx.h"
@@ -8,22 +11,147 @@
 
 static struct cx_poll_file *file_init(struct cx_poll_file *pf, int fd) {
   pf->fd = fd;
+  pf->events = 0;
+  pf->always = false;
   pf->read_data = pf->write_data = NULL;
   pf->read_fn = pf->write_fn = NULL;
+  pf->read_value.type = pf->write_value.type = NULL;
   return pf;
 }
 
-static void file_deinit(struct cx_poll_file *f, struct pollfd *pfd) {
-  if (pfd->events & POLLIN && !f->read_fn) { cx_box_deinit(&f->read_value); }
-  if (pfd->events & POLLOUT && !f->write_fn) { cx_box_deinit(&f->write_value); }
+static void file_clear_read(struct cx_poll_file *pf) {
+  if (pf->read_fn) {
+    pf->read_fn = NULL;
+    pf->read_data = NULL;
+  } else if (pf->read_value.type) {
+    cx_box_deinit(&pf->read_value);
+    pf->read_value.type = NULL;
+  }
+}
+
+static void file_clear_write(struct cx_poll_file *pf) {
+  if (pf->write_fn) {
+    pf->write_fn = NULL;
+    pf->write_data = NULL;
+  } else if (pf->write_value.type) {
+    cx_box_deinit(&pf->write_value);
+    pf->write_value.type = NULL;
+  }
+}
+
+static struct cx_poll_file *get_file(struct cx_poll *p, int fd) {
+  if (fd < 0 || fd >= p->files.count) { return NULL; }
+  struct cx_poll_file *pf = cx_vec_get(&p->files, fd);
+  return (pf->fd == fd) ? pf : NULL;
+}
+
+static void drop_always(struct cx_poll *p, int fd) {
+  cx_do_vec(&p->always, int, afd) {
+    if (*afd == fd) {
+      cx_vec_delete(&p->always, afd - (int *)cx_vec_start(&p->always));
+      break;
+    }
+  }
+}
+
+static void remove_file(struct cx_poll *p, struct cx_poll_file *pf) {
+  if (pf->always) { drop_always(p, pf->fd); }
+  file_clear_read(pf);
+  file_clear_write(pf);
+  pf->fd = -1;
+  p->nfiles--;
+}
+
+static struct cx_poll_file *add_file(struct cx_poll *p, int fd) {
+  if (fd < 0) {
+    errno = EBADF;
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) == -1) { return NULL; }
+  
+  while (p->files.count <= fd) { file_init(cx_vec_push(&p->files), -1); }
+  struct cx_poll_file *pf = cx_vec_get(&p->files, fd);
+
+  // Fds that were closed and reused without delete start over,
+  // epoll has already dropped them
+  if (pf->fd != -1 && (pf->dev != st.st_dev || pf->ino != st.st_ino)) {
+    remove_file(p, pf);
+  }
+  
+  if (pf->fd == -1) {
+    file_init(pf, fd);
+    pf->dev = st.st_dev;
+    pf->ino = st.st_ino;
+    p->nfiles++;
+  }
+  
+  return pf;
+}
+
+static bool update_file(struct cx_poll *p,
+			struct cx_poll_file *pf,
+			uint32_t events) {
+  uint32_t prev = pf->events;
+  pf->events = events;
+  if (pf->always || prev == events) { return true; }
+  
+  int op = prev
+    ? (events ? EPOLL_CTL_MOD : EPOLL_CTL_DEL)
+    : EPOLL_CTL_ADD;
+  
+  struct epoll_event e = {
+    .events = events | (p->edge ? EPOLLET : 0),
+    .data.fd = pf->fd
+  };
+
+  int res = epoll_ctl(p->fd, op, pf->fd, &e);
+
+  // Fds that were closed and reused without delete are gone from epoll
+  if (res == -1 && op == EPOLL_CTL_MOD && errno == ENOENT) {
+    res = epoll_ctl(p->fd, EPOLL_CTL_ADD, pf->fd, &e);
+  }
+  
+  if (res == -1) {
+    if (errno == EPERM) {
+      // Regular files don't support epoll and are always ready
+      pf->always = true;
+      *(int *)cx_vec_push(&p->always) = pf->fd;
+      return true;
+    }
+
+    if (op == EPOLL_CTL_DEL) { return true; }
+    pf->events = prev;
+    return false;
+  }
+
+  return true;
+}
+
+static struct cx_poll_file *add_events(struct cx_poll *p,
+				       struct cx_poll_file *pf,
+				       uint32_t events) {
+  if (update_file(p, pf, pf->events | events)) { return pf; }
+
+  // Files are only counted once registered
+  if (!pf->events) {
+    int err = errno;
+    remove_file(p, pf);
+    errno = err;
+  }
+
+  return NULL;
 }
 
 struct cx_poll *cx_poll_new() {
   struct cx_poll *p = malloc(sizeof(struct cx_poll));
-  cx_set_init(&p->files, sizeof(struct cx_poll_file), cx_cmp_cint);
-  p->files.key = offsetof(struct cx_poll_file, fd);
-  cx_set_init(&p->fds, sizeof(struct pollfd), cx_cmp_cint);
-  p->fds.key_offs = offsetof(struct pollfd, fd);
+  p->fd = epoll_create1(EPOLL_CLOEXEC);
+  p->edge = false;
+  cx_vec_init(&p->files, sizeof(struct cx_poll_file));
+  cx_vec_init(&p->always, sizeof(int));
+  p->nfiles = 0;
+  cx_wheel_init(&p->timers, cx_wheel_ms());
   p->nrefs = 1;
   return p;
 }
@@ -38,149 +166,146 @@ void cx_poll_deref(struct cx_poll *p) {
   p->nrefs--;
 
   if (!p->nrefs) {
-    struct cx_poll_file *f = cx_vec_start(&p->files.members);
-    struct pollfd *fd = cx_vec_start(&p->fds.members);
-
-    for (; f != cx_vec_end(&p->files.members); f++, fd++) {
-      file_deinit(f, cx_test(cx_set_get(&p->fds, &f->fd)));
+    cx_do_vec(&p->files, struct cx_poll_file, f) {
+      if (f->fd != -1) {
+	file_clear_read(f);
+	file_clear_write(f);
+      }
     }
     
-    cx_set_deinit(&p->files);
-    cx_set_deinit(&p->fds);
+    cx_vec_deinit(&p->files);
+    cx_vec_deinit(&p->always);
+    cx_wheel_deinit(&p->timers);
+    if (p->fd != -1) { close(p->fd); }
     free(p);
   }
 }
 
-struct cx_poll_file *cx_poll_read(struct cx_poll *p, int fd) {
-  void *found = NULL;
-  size_t i = cx_set_find(&p->files, &fd, 0, &found);
+bool cx_poll_edge(struct cx_poll *p) {
+  if (p->edge) { return true; }
+  p->edge = true;
   
-  struct cx_poll_file *pf = NULL;
-  struct pollfd *pfd = NULL;
-  
-  if (found) {
-    pf = found;
-    pfd = cx_vec_get(&p->fds.members, i);
-    
-    if (pfd->events & POLLIN) {
-      if (pf->read_fn) {
-	pf->read_fn = NULL;
-	pf->read_data = NULL;
-      } else {
-	cx_box_deinit(&pf->read_value);
-      }
+  cx_do_vec(&p->files, struct cx_poll_file, f) {
+    if (f->fd != -1 && f->events && !f->always) {
+      struct epoll_event e = {.events = f->events | EPOLLET, .data.fd = f->fd};
+      if (epoll_ctl(p->fd, EPOLL_CTL_MOD, f->fd, &e) == -1) { return false; }
     }
-  } else {
-    pf = file_init(cx_vec_insert(&p->files.members, i), fd);
-    pfd = cx_vec_insert(&p->fds.members, i);
-    pfd->fd = fd;
-    pfd->events = 0;
   }
 
-  pfd->events |= POLLIN;
-  return pf;
+  return true;
+}
+
+struct cx_poll_file *cx_poll_get(struct cx_poll *p, int fd) {
+  return get_file(p, fd);
+}
+
+struct cx_poll_file *cx_poll_read(struct cx_poll *p, int fd) {
+  struct cx_poll_file *pf = add_file(p, fd);
+  if (!pf) { return NULL; }
+  file_clear_read(pf);
+  return add_events(p, pf, EPOLLIN);
 }
 
 bool cx_poll_no_read(struct cx_poll *p, int fd) {
-  struct pollfd *pfd = cx_set_get(&p->fds, &fd);
-  if (!pfd) { return false; }
-  if (!(pfd->events & POLLIN)) { return false; }
-  pfd->events ^= POLLIN;
-  return true;
+  struct cx_poll_file *pf = get_file(p, fd);
+  if (!pf || !(pf->events & EPOLLIN)) { return false; }
+  return update_file(p, pf, pf->events & ~EPOLLIN);
 }
 
 struct cx_poll_file *cx_poll_write(struct cx_poll *p, int fd) {
-  void *found = NULL;
-  size_t i = cx_set_find(&p->files, &fd, 0, &found);
-  
-  struct cx_poll_file *pf = NULL;
-  struct pollfd *pfd = NULL;
-  
-  if (found) {
-    pf = found;
-    pfd = cx_vec_get(&p->fds.members, i);
-    
-    if (pfd->events & POLLOUT) {
-      if (pf->write_fn) {
-	pf->write_fn = NULL;
-	pf->write_data = NULL;
-      } else {
-	cx_box_deinit(&pf->write_value);
-      }
-    }
-  } else {
-    pf = file_init(cx_vec_insert(&p->files.members, i), fd);
-    pfd = cx_vec_insert(&p->fds.members, i);
-    pfd->fd = fd;
-    pfd->events = 0;
-  }
-
-  pfd->events |= POLLOUT;
-  return pf;
+  struct cx_poll_file *pf = add_file(p, fd);
+  if (!pf) { return NULL; }
+  file_clear_write(pf);
+  return add_events(p, pf, EPOLLOUT);
 }
 
 bool cx_poll_no_write(struct cx_poll *p, int fd) {
-  struct pollfd *pfd = cx_set_get(&p->fds, &fd);
-  if (!pfd) { return false; }
-  if (!(pfd->events & POLLOUT)) { return false; }
-  pfd->events ^= POLLOUT;
-  return true;
+  struct cx_poll_file *pf = get_file(p, fd);
+  if (!pf || !(pf->events & EPOLLOUT)) { return false; }
+  return update_file(p, pf, pf->events & ~EPOLLOUT);
 }
 
 bool cx_poll_delete(struct cx_poll *p, int fd) {
-  void *found = NULL;
-  size_t i = cx_set_find(&p->files, &fd, 0, &found);
-  if (!found) { return false; }
-  file_deinit(found, cx_vec_get(&p->fds.members, i));
-  cx_vec_delete(&p->files.members, i);
-  cx_vec_delete(&p->fds.members, i);
+  struct cx_poll_file *pf = get_file(p, fd);
+  if (!pf) { return false; }
+
+  if (!pf->always && pf->events) { epoll_ctl(p->fd, EPOLL_CTL_DEL, fd, NULL); }
+  remove_file(p, pf);
   return true;
 }
 
-int cx_poll_wait(struct cx_poll *p, int ms, struct cx_scope *s) {
-  struct cx_vec *fds = &p->fds.members; 
-
-  int
-    num = poll((struct pollfd *)fds->items, fds->count, ms),
-    rem = num;
-  
-  struct cx_poll_file
-    *f = cx_vec_start(&p->files.members),
-    *fend = cx_vec_end(&p->files.members);
-  
-  struct pollfd *fd = cx_vec_start(&p->fds.members);
+static bool dispatch(struct cx_poll *p,
+		     int fd,
+		     uint32_t events,
+		     struct cx_scope *s) {
+  struct cx_poll_file *pf = get_file(p, fd);
 
-  for (; f != fend && rem;) {
-    int prev_fd = f->fd;
-    
-    if (fd->revents) {
-      if (fd->revents & POLLIN) {
-	if (f->read_fn) {
-	  if (!f->read_fn(f->read_data)) { return -1; }
-	} else if (!cx_call(&f->read_value, s)) {
-	  return -1;
-	}
-	
-	rem--;
-      }
+  if (pf && events & (EPOLLIN | EPOLLHUP | EPOLLERR) && pf->events & EPOLLIN) {
+    if (pf->read_fn) {
+      if (!pf->read_fn(pf->read_data)) { return false; }
+    } else if (!cx_call(&pf->read_value, s)) {
+      return false;
+    }
 
-      if (f->fd == prev_fd && fd->revents & POLLOUT) {
-	if (f->write_fn) {
-	  if (!f->write_fn(f->write_data)) { return -1; }
-	} else if (!cx_call(&f->write_value, s)) {
-	  return -1;
-	}
+    pf = get_file(p, fd);
+  }
 
-	rem--;
-      }      
+  if (pf && events & (EPOLLOUT | EPOLLERR) && pf->events & EPOLLOUT) {
+    if (pf->write_fn) {
+      if (!pf->write_fn(pf->write_data)) { return false; }
+    } else if (!cx_call(&pf->write_value, s)) {
+      return false;
     }
+  }
+
+  return true;
+}
 
-    if (f->fd == prev_fd) {
-      f++;
-      fd++;
+int64_t cx_poll_timeout(struct cx_poll *p,
+			int64_t ms,
+			int64_t interval,
+			struct cx_box *action) {
+  return cx_wheel_add(&p->timers, cx_wheel_ms()+ms, interval, action);
+}
+
+bool cx_poll_cancel(struct cx_poll *p, int64_t id) {
+  return cx_wheel_cancel(&p->timers, id);
+}
+
+int cx_poll_wait(struct cx_poll *p, int ms, struct cx_scope *s) {
+  size_t nalways = p->always.count;
+  struct epoll_event events[CX_POLL_MAX_EVENTS];
+  int64_t now = cx_wheel_ms(), end = (ms < 0) ? -1 : now+ms;
+  int num = 0;
+
+  for (;;) {
+    int64_t next = cx_wheel_next(&p->timers);
+    if (end != -1 && (next == -1 || end < next)) { next = end; }
+    int timeout = nalways ? 0 : (next == -1) ? -1 : cx_max(next-now, 0);
+    num = epoll_wait(p->fd, events, CX_POLL_MAX_EVENTS, timeout);
+    if (num == -1) { return -1; }
+    now = cx_wheel_ms();
+    
+    for (struct epoll_event *e = events; e < events+num; e++) {
+      if (!dispatch(p, e->data.fd, e->events, s)) { return -1; }
     }
+
+    int n = cx_wheel_advance(&p->timers, now, s);
+    if (n == -1) { return -1; }
+    num += n;
+
+    // Waking up to cascade timers doesn't count as an event
+    if (num || nalways || (end != -1 && now >= end)) { break; }
   }
 
+  for (size_t i = 0; i < nalways && i < p->always.count; i++) {
+    int fd = *(int *)cx_vec_get(&p->always, i);
+    struct cx_poll_file *pf = get_file(p, fd);
+    if (!pf || !pf->events) { continue; }
+    if (!dispatch(p, fd, pf->events, s)) { return -1; }
+    num++;
+  }
+  
   return num;
 }
 
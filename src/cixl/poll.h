@@ -1,8 +1,14 @@
 #ifndef CX_POLL_H
 #define CX_POLL_H
 
+#include <stdint.h>
+#include <sys/types.h>
+
 #include "cixl/box.h"
-#include "cixl/set.h"
+#include "cixl/vec.h"
+#include "cixl/wheel.h"
+
+#define CX_POLL_MAX_EVENTS 256
 
 struct cx;
 struct cx_file;
@@ -10,7 +16,11 @@ struct cx_type;
 
 struct cx_poll_file {
   int fd;
-
+  dev_t dev;
+  ino_t ino;
+  uint32_t events;
+  bool always;
+  
   bool (*read_fn)(void *);
   bool (*write_fn)(void *);
   void *read_data, *write_data;
@@ -19,7 +29,11 @@ struct cx_poll_file {
 };
 
 struct cx_poll {
-  struct cx_set files, fds;
+  int fd;
+  bool edge;
+  struct cx_vec files, always;
+  size_t nfiles;
+  struct cx_wheel timers;
   unsigned int nrefs;
 };
 
@@ -27,11 +41,19 @@ struct cx_poll *cx_poll_new();
 struct cx_poll *cx_poll_ref(struct cx_poll *p);
 void cx_poll_deref(struct cx_poll *p);
 
+bool cx_poll_edge(struct cx_poll *p);
+struct cx_poll_file *cx_poll_get(struct cx_poll *p, int fd);
 struct cx_poll_file *cx_poll_read(struct cx_poll *p, int fd);
 bool cx_poll_no_read(struct cx_poll *p, int fd);
 struct cx_poll_file *cx_poll_write(struct cx_poll *p, int fd);
 bool cx_poll_no_write(struct cx_poll *p, int fd);
 bool cx_poll_delete(struct cx_poll *p, int fd);
+int64_t cx_poll_timeout(struct cx_poll *p,
+			int64_t ms,
+			int64_t interval,
+			struct cx_box *action);
+
+bool cx_poll_cancel(struct cx_poll *p, int64_t id);
 int cx_poll_wait(struct cx_poll *p, int ms, struct cx_scope *s);
 
 struct cx_type *cx_init_poll_type(struct cx_lib *lib);
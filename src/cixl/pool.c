@@ -0,0 +1,168 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "cixl/bin.h"
+#include "cixl/cx.h"
+#include "cixl/error.h"
+#include "cixl/pool.h"
+#include "cixl/scope.h"
+
+struct cx_pool *cx_pool_init(struct cx_pool *p,
+			     struct cx *cx,
+			     const char *code,
+			     unsigned int nworkers) {
+  p->cx = cx;
+  p->code = strdup(code);
+  p->error = NULL;
+  p->map = p->failed = false;
+  cx_vec_init(&p->env, sizeof(struct cx_msg));
+  cx_vec_init(&p->items, sizeof(struct cx_msg));
+  cx_vec_init(&p->results, sizeof(struct cx_msg));
+  cx_sched_init(&p->sched, nworkers, p);
+  return p;
+}
+
+static void clear_msgs(struct cx_vec *msgs) {
+  cx_do_vec(msgs, struct cx_msg, m) { cx_msg_deinit(m); }
+  cx_vec_clear(msgs);
+}
+
+struct cx_pool *cx_pool_deinit(struct cx_pool *p) {
+  clear_msgs(&p->env);
+  cx_vec_deinit(&p->env);
+  clear_msgs(&p->items);
+  cx_vec_deinit(&p->items);
+  clear_msgs(&p->results);
+  cx_vec_deinit(&p->results);
+  cx_sched_deinit(&p->sched);
+  free(p->code);
+  free(p->error);
+  return p;
+}
+
+static bool run_item(struct cx_pool *p,
+		     struct cx *cx,
+		     struct cx_box *act,
+		     size_t i) {
+  struct cx_scope *s = cx_scope(cx, 0);
+  
+  if (!cx_msg_get(cx_vec_get(&p->items, i), cx, cx_push(s))) {
+    cx_pop(s, false);
+    return false;
+  }
+
+  if (!cx_call(act, s)) { return false; }
+
+  if (p->map) {
+    struct cx_box *v = cx_pop(s, true);
+
+    if (!v) {
+      cx_error(cx, cx->row, cx->col, "Missing mapped value");
+      return false;
+    }
+    
+    bool ok = cx_msg_init(cx_vec_get(&p->results, i), cx, v);
+    cx_box_deinit(v);
+    if (!ok) { return false; }
+  }
+
+  cx_do_vec(&s->stack, struct cx_box, v) { cx_box_deinit(v); }
+  cx_vec_clear(&s->stack);
+  return true;
+}
+
+static bool init_worker(struct cx_pool *p, struct cx *cx, struct cx_box *act) {
+  if (!cx_use(cx, "cx")) { return false; }
+  struct cx_scope *s = cx_scope(cx, 0);
+
+  cx_do_vec(&p->env, struct cx_msg, m) {
+    if (!cx_msg_get(m, cx, cx_push(s))) {
+      cx_pop(s, false);
+      return false;
+    }
+  }
+
+  if (!cx_eval_str(cx, p->code)) { return false; }
+  struct cx_box *v = cx_pop(s, true);
+
+  if (!v) {
+    cx_error(cx, cx->row, cx->col, "Missing pool action");
+    return false;
+  }
+
+  *act = *v;
+  return true;
+}
+
+struct worker {
+  struct cx cx;
+  struct cx_box act;
+  bool has_act;
+};
+
+static bool start_worker(struct cx_sched_worker *sw) {
+  struct cx_pool *p = sw->sched->data;
+  struct worker *w = malloc(sizeof(struct worker));
+  sw->data = w;
+  cx_init(&w->cx);
+  cx_init_libs(&w->cx);
+  w->has_act = init_worker(p, &w->cx, &w->act);
+  return w->has_act;
+}
+
+static bool run_worker(struct cx_sched_worker *sw, size_t i) {
+  struct worker *w = sw->data;
+  return run_item(sw->sched->data, &w->cx, &w->act, i);
+}
+
+static void stop_worker(struct cx_sched_worker *sw, bool ok) {
+  struct cx_pool *p = sw->sched->data;
+  struct worker *w = sw->data;
+  if (w->has_act) { cx_box_deinit(&w->act); }
+
+  // The first failing worker reports, the rest stop at the next item
+  if (!ok && !__atomic_exchange_n(&p->failed, true, __ATOMIC_ACQ_REL)) {
+    size_t len = 0;
+    FILE *out = open_memstream(&p->error, &len);
+    cx_dump_errors(&w->cx, out);
+    fclose(out);
+  }
+
+  cx_deinit(&w->cx);
+  free(w);
+}
+
+bool cx_pool_run(struct cx_pool *p, bool map) {
+  struct cx *cx = p->cx;
+  size_t n = p->items.count;
+  p->map = map;
+  
+  if (map) {
+    cx_vec_grow(&p->results, n);
+    p->results.count = n;
+    
+    cx_do_vec(&p->results, struct cx_msg, m) {
+      m->chan = NULL;
+      m->str = NULL;
+      m->data = NULL;
+      m->len = 0;
+    }
+  }
+
+  p->sched.start = start_worker;
+  p->sched.run = run_worker;
+  p->sched.stop = stop_worker;
+  int res = cx_sched_run(&p->sched, n);
+  
+  if (p->error) {
+    cx_error(cx, cx->row, cx->col, "Worker failed:\n%s", p->error);
+    return false;
+  }
+
+  if (res) {
+    cx_error(cx, cx->row, cx->col, "Failed running workers: %d", res);
+    return false;
+  }
+
+  return true;
+}
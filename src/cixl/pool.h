@@ -0,0 +1,28 @@
+#ifndef CX_POOL_H
+#define CX_POOL_H
+
+#include <stdbool.h>
+
+#include "cixl/sched.h"
+#include "cixl/vec.h"
+
+struct cx;
+
+struct cx_pool {
+  struct cx *cx;
+  char *code, *error;
+  bool map, failed;
+  struct cx_vec env, items, results;
+  struct cx_sched sched;
+};
+
+struct cx_pool *cx_pool_init(struct cx_pool *p,
+			     struct cx *cx,
+			     const char *code,
+			     unsigned int nworkers);
+
+struct cx_pool *cx_pool_deinit(struct cx_pool *p);
+
+bool cx_pool_run(struct cx_pool *p, bool map);
+
+#endif
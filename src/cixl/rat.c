@@ -3,6 +3,7 @@
 #include "cixl/cx.h"
 #include "cixl/box.h"
 #include "cixl/error.h"
+#include "cixl/pack.h"
 #include "cixl/rat.h"
 #include "cixl/scope.h"
 
@@ -98,6 +99,35 @@ static void dump_imp(struct cx_box *v, FILE *out) {
   fprintf(out, "%s%" PRIu64 "/%" PRIu64, r->neg ? "-" : "", r->num, r->den);
 }
 
+static bool pack_imp(struct cx_box *v, struct cx_buf *out) {
+  struct cx_rat *r = &v->as_rat;
+  cx_pack_uint(out, r->neg);
+  cx_pack_uint(out, r->num);
+  cx_pack_uint(out, r->den);
+  return true;
+}
+
+static bool unpack_imp(struct cx_type *t,
+		       struct cx_unpack *in,
+		       struct cx_box *out) {
+  uint64_t neg = 0, num = 0, den = 0;
+
+  if (!cx_unpack_uint(in, &neg) ||
+      !cx_unpack_uint(in, &num) ||
+      !cx_unpack_uint(in, &den)) {
+    return false;
+  }
+
+  if (!den) {
+    struct cx *cx = in->cx;
+    cx_error(cx, cx->row, cx->col, "Invalid pack");
+    return false;
+  }
+  
+  cx_rat_init(&cx_box_init(out, t)->as_rat, num, den, neg);
+  return true;
+}
+
 struct cx_type *cx_init_rat_type(struct cx_lib *lib) {
   struct cx_type *t = cx_add_type(lib, "Rat", lib->cx->num_type);
   t->equid = equid_imp;
@@ -105,5 +135,7 @@ struct cx_type *cx_init_rat_type(struct cx_lib *lib) {
   t->ok = ok_imp;
   t->write = write_imp;
   t->dump = dump_imp;
+  t->pack = pack_imp;
+  t->unpack = unpack_imp;
   return t;
 }
@@ -1,7 +1,9 @@
 #include <stdlib.h>
+#include <string.h>
 
 #include "cixl/cx.h"
 #include "cixl/error.h"
+#include "cixl/pack.h"
 #include "cixl/rec.h"
 #include "cixl/scope.h"
 #include "cixl/file.h"
@@ -89,7 +91,7 @@ static bool emit_imp(struct cx_box *v, const char *exp, FILE *out) {
   struct cx_sym r_var = cx_gsym(cx, "r");
   
   fprintf(out,
-	  "struct cx_type *%s = %s();\n"
+	  "struct cx_type *%s = %s(cx);\n"
 	  "struct cx_rec *%s = cx_rec_new(cx_baseof(%s, struct cx_rec_type, imp));\n"
 	  "cx_box_init(%s, %s)->as_ptr = %s;\n",
 	  t_var.id, r->type->imp.emit_id,
@@ -113,6 +115,65 @@ static void deinit_imp(struct cx_box *v) {
   cx_rec_deref(v->as_ptr);
 }
 
+static bool pack_imp(struct cx_box *v, struct cx_buf *out) {
+  struct cx *cx = v->type->lib->cx;
+  struct cx_rec *r = v->as_ptr;
+  size_t n = 0;
+
+  cx_do_env(&r->fields, fv) {
+    if (fv->value.type != cx->nil_type) { n++; }
+  }
+
+  cx_pack_uint(out, n);
+
+  cx_do_env(&r->fields, fv) {
+    if (fv->value.type != cx->nil_type) {
+      if (!cx_pack_id(cx, fv->id.id, out) ||
+	  !cx_pack_box(&fv->value, out)) {
+	return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+static bool unpack_imp(struct cx_type *t,
+		       struct cx_unpack *in,
+		       struct cx_box *out) {
+  struct cx *cx = in->cx;
+  uint64_t n = 0;
+  if (!cx_unpack_uint(in, &n)) { return false; }
+  struct cx_rec_type *rt = cx_baseof(t, struct cx_rec_type, imp);
+  struct cx_rec *r = cx_rec_new(rt);
+  cx_box_init(out, t)->as_ptr = r;
+  
+  for (uint64_t i = 0; i < n; i++) {
+    char id[CX_PACK_MAX_ID+1];
+    struct cx_box v;
+    
+    if (!cx_unpack_id(in, id) || !cx_unpack_box(in, &v)) {
+      cx_box_deinit(out);
+      return false;
+    }
+
+    struct cx_sym fid = cx_sym(cx, id);
+    struct cx_field *f = cx_set_get(&rt->fields, &fid);
+
+    // Fields have to be declared, and values match their types
+    if (!f || (v.type != cx->nil_type && !cx_is(v.type, f->type))) {
+      cx_error(cx, cx->row, cx->col, "Invalid pack");
+      cx_box_deinit(&v);
+      cx_box_deinit(out);
+      return false;
+    }
+
+    *cx_rec_put(r, fid) = v;
+  }
+
+  return true;
+}
+
 static void *type_deinit_imp(struct cx_type *t) {
   struct cx_rec_type *rt = cx_baseof(t, struct cx_rec_type, imp);
   cx_set_deinit(&rt->fields);
@@ -136,6 +197,8 @@ struct cx_rec_type *cx_rec_type_init(struct cx_rec_type *type,
   type->imp.dump = dump_imp;
   type->imp.print = print_imp;
   type->imp.emit = emit_imp;
+  type->imp.pack = pack_imp;
+  type->imp.unpack = unpack_imp;
   type->imp.deinit = deinit_imp;
 
   type->imp.type_deinit = type_deinit_imp;
@@ -0,0 +1,623 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cixl/box.h"
+#include "cixl/buf.h"
+#include "cixl/cx.h"
+#include "cixl/error.h"
+#include "cixl/file.h"
+#include "cixl/ring.h"
+#include "cixl/scope.h"
+
+static int uring_setup(unsigned int entries, struct io_uring_params *p) {
+  return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int uring_enter(int fd,
+		       unsigned int to_submit,
+		       unsigned int min_complete,
+		       unsigned int flags) {
+  return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int uring_register(int fd, unsigned int op, void *arg, unsigned int nargs) {
+  return syscall(__NR_io_uring_register, fd, op, arg, nargs);
+}
+
+static bool uring_init(struct cx_ring *r) {
+  const char *force = getenv("CX_RING");
+  if (force && strcmp(force, "sync") == 0) { return false; }
+
+  struct io_uring_params p;
+  memset(&p, 0, sizeof(p));
+  r->fd = uring_setup(CX_RING_ENTRIES, &p);
+  if (r->fd == -1) { return false; }
+
+  r->sq_len = p.sq_off.array + p.sq_entries*sizeof(unsigned int);
+  r->cq_len = p.cq_off.cqes + p.cq_entries*sizeof(struct io_uring_cqe);
+
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    r->sq_len = r->cq_len = cx_max(r->sq_len, r->cq_len);
+  }
+
+  r->sq_ptr = mmap(NULL, r->sq_len, PROT_READ | PROT_WRITE,
+		   MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+
+  if (r->sq_ptr == MAP_FAILED) { goto fail; }
+
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    r->cq_ptr = r->sq_ptr;
+  } else {
+    r->cq_ptr = mmap(NULL, r->cq_len, PROT_READ | PROT_WRITE,
+		     MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+
+    if (r->cq_ptr == MAP_FAILED) {
+      munmap(r->sq_ptr, r->sq_len);
+      goto fail;
+    }
+  }
+
+  r->sqes_len = p.sq_entries*sizeof(struct io_uring_sqe);
+  r->sqes = mmap(NULL, r->sqes_len, PROT_READ | PROT_WRITE,
+		 MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+
+  if (r->sqes == MAP_FAILED) {
+    if (r->cq_ptr != r->sq_ptr) { munmap(r->cq_ptr, r->cq_len); }
+    munmap(r->sq_ptr, r->sq_len);
+    goto fail;
+  }
+
+  char *sq = r->sq_ptr, *cq = r->cq_ptr;
+  r->sq_head = (unsigned int *)(sq + p.sq_off.head);
+  r->sq_tail = (unsigned int *)(sq + p.sq_off.tail);
+  r->sq_mask = (unsigned int *)(sq + p.sq_off.ring_mask);
+  r->sq_entries = (unsigned int *)(sq + p.sq_off.ring_entries);
+  r->sq_array = (unsigned int *)(sq + p.sq_off.array);
+  r->cq_head = (unsigned int *)(cq + p.cq_off.head);
+  r->cq_tail = (unsigned int *)(cq + p.cq_off.tail);
+  r->cq_mask = (unsigned int *)(cq + p.cq_off.ring_mask);
+  r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+  r->bufs = malloc(CX_RING_NBUFS*CX_RING_BUF_SIZE);
+  struct iovec iovs[CX_RING_NBUFS];
+
+  for (int i = 0; i < CX_RING_NBUFS; i++) {
+    iovs[i].iov_base = r->bufs + i*CX_RING_BUF_SIZE;
+    iovs[i].iov_len = CX_RING_BUF_SIZE;
+    *(int *)cx_vec_push(&r->free_bufs) = CX_RING_NBUFS-i-1;
+  }
+
+  // Registering may fail on low memlock limits, plain ops still work
+  r->fixed = uring_register(r->fd,
+			    IORING_REGISTER_BUFFERS,
+			    iovs,
+			    CX_RING_NBUFS) == 0;
+  return true;
+ fail:
+  close(r->fd);
+  r->fd = -1;
+  return false;
+}
+
+struct cx_ring *cx_ring_new(struct cx *cx) {
+  struct cx_ring *r = malloc(sizeof(struct cx_ring));
+  r->cx = cx;
+  r->fd = -1;
+  r->fixed = false;
+  r->nsubmit = 0;
+  r->ops = NULL;
+  r->nops = 0;
+  r->bufs = NULL;
+  cx_vec_init(&r->queue, sizeof(struct cx_ring_op *));
+  cx_vec_init(&r->free_bufs, sizeof(int));
+  r->nrefs = 1;
+  uring_init(r);
+  return r;
+}
+
+struct cx_ring *cx_ring_ref(struct cx_ring *r) {
+  r->nrefs++;
+  return r;
+}
+
+static void release_buf(struct cx_ring *r, struct cx_ring_op *op) {
+  if (op->buf_idx != -1) {
+    *(int *)cx_vec_push(&r->free_bufs) = op->buf_idx;
+    op->buf_idx = -1;
+  }
+}
+
+static void free_op(struct cx_ring *r, struct cx_ring_op *op) {
+  if (op->prev) {
+    op->prev->next = op->next;
+  } else {
+    r->ops = op->next;
+  }
+
+  if (op->next) { op->next->prev = op->prev; }
+  release_buf(r, op);
+  cx_box_deinit(&op->file);
+  if (op->buf.type) { cx_box_deinit(&op->buf); }
+  if (op->act.type) { cx_box_deinit(&op->act); }
+  free(op);
+  r->nops--;
+}
+
+static struct io_uring_sqe *get_sqe(struct cx_ring *r);
+static void push_sqe(struct cx_ring *r);
+
+static bool uring_cancel(struct cx_ring *r) {
+  cx_do_vec(&r->queue, struct cx_ring_op *, op) { free_op(r, *op); }
+  cx_vec_clear(&r->queue);
+
+  // Ops in flight may still write to bufs, they are cancelled and reaped first
+  for (struct cx_ring_op *op = r->ops; op; op = op->next) {
+    struct io_uring_sqe *sqe = get_sqe(r);
+    if (!sqe) { return false; }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->addr = (uintptr_t)op;
+    push_sqe(r);
+  }
+
+  while (r->ops) {
+    int n = uring_enter(r->fd, r->nsubmit, 1, IORING_ENTER_GETEVENTS);
+
+    if (n == -1) {
+      if (errno == EINTR) { continue; }
+      return false;
+    }
+
+    r->nsubmit -= n;
+    unsigned int head = *r->cq_head;
+
+    while (head != __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE)) {
+      struct io_uring_cqe *cqe = r->cqes + (head & *r->cq_mask);
+      struct cx_ring_op *op = (struct cx_ring_op *)(uintptr_t)cqe->user_data;
+      head++;
+      __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+      if (op) { free_op(r, op); }
+    }
+  }
+
+  return true;
+}
+
+void cx_ring_deref(struct cx_ring *r) {
+  cx_test(r->nrefs);
+  r->nrefs--;
+
+  if (!r->nrefs) {
+    if (r->fd != -1) {
+      // Buffers are leaked rather than freed under ops that couldn't be reaped
+      if (!uring_cancel(r)) { r->bufs = NULL; }
+      close(r->fd);
+      munmap(r->sqes, r->sqes_len);
+      if (r->cq_ptr != r->sq_ptr) { munmap(r->cq_ptr, r->cq_len); }
+      munmap(r->sq_ptr, r->sq_len);
+    }
+
+    while (r->ops) { free_op(r, r->ops); }
+    cx_vec_deinit(&r->queue);
+    cx_vec_deinit(&r->free_bufs);
+    if (r->bufs) { free(r->bufs); }
+    free(r);
+  }
+}
+
+static struct io_uring_sqe *get_sqe(struct cx_ring *r) {
+  unsigned int
+    tail = *r->sq_tail,
+    head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+
+  if (tail - head >= *r->sq_entries) {
+    if (!cx_ring_submit(r)) { return NULL; }
+    head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+
+    if (tail - head >= *r->sq_entries) {
+      errno = EBUSY;
+      return NULL;
+    }
+  }
+
+  unsigned int i = tail & *r->sq_mask;
+  r->sq_array[i] = i;
+  struct io_uring_sqe *sqe = r->sqes + i;
+  memset(sqe, 0, sizeof(struct io_uring_sqe));
+  return sqe;
+}
+
+static void push_sqe(struct cx_ring *r) {
+  __atomic_store_n(r->sq_tail, *r->sq_tail+1, __ATOMIC_RELEASE);
+  r->nsubmit++;
+}
+
+static bool prep_op(struct cx_ring *r, struct cx_ring_op *op) {
+  if (op->type != CX_RING_ACCEPT && !r->free_bufs.count) {
+    errno = EBUSY;
+    return false;
+  }
+
+  struct io_uring_sqe *sqe = get_sqe(r);
+  if (!sqe) { return false; }
+  
+  if (op->type != CX_RING_ACCEPT) {
+    op->buf_idx = *(int *)cx_vec_pop(&r->free_bufs);
+  }
+
+  char *data = r->bufs + op->buf_idx*CX_RING_BUF_SIZE;
+  sqe->fd = op->file.as_file->fd;
+  sqe->user_data = (uintptr_t)op;
+
+  switch (op->type) {
+  case CX_RING_ACCEPT:
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->accept_flags = SOCK_NONBLOCK;
+    break;
+  case CX_RING_RECV:
+    sqe->opcode = IORING_OP_RECV;
+    break;
+  case CX_RING_SEND:
+    sqe->opcode = IORING_OP_SEND;
+    break;
+  case CX_RING_READ:
+    sqe->opcode = r->fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    sqe->off = -1;
+    break;
+  case CX_RING_WRITE:
+    sqe->opcode = r->fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    sqe->off = -1;
+    break;
+  }
+
+  if (op->type != CX_RING_ACCEPT) {
+    // Outgoing data is copied, the Buf may change before the op completes
+    if (op->type == CX_RING_SEND || op->type == CX_RING_WRITE) {
+      struct cx_buf *b = cx_baseof(op->buf.as_file, struct cx_buf, file);
+      op->len = cx_min(cx_buf_len(b), (size_t)CX_RING_BUF_SIZE);
+      memcpy(data, cx_buf_view(b, &op->len), op->len);
+    }
+
+    sqe->addr = (uintptr_t)data;
+    sqe->len = op->len;
+    sqe->buf_index = op->buf_idx;
+  }
+
+  push_sqe(r);
+  return true;
+}
+
+static bool poll_op(struct cx_ring *r, struct cx_ring_op *op) {
+  struct io_uring_sqe *sqe = get_sqe(r);
+  if (!sqe) { return false; }
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = op->file.as_file->fd;
+
+  sqe->poll32_events =
+    (op->type == CX_RING_SEND || op->type == CX_RING_WRITE) ? POLLOUT : POLLIN;
+
+  sqe->user_data = (uintptr_t)op;
+  op->polling = true;
+  push_sqe(r);
+  return true;
+}
+
+struct cx_ring_op *cx_ring_push(struct cx_ring *r,
+				enum cx_ring_op_type type,
+				struct cx_box *file,
+				struct cx_box *buf,
+				size_t len) {
+  struct cx_ring_op *op = malloc(sizeof(struct cx_ring_op));
+  op->type = type;
+  cx_copy(&op->file, file);
+  if (buf) { cx_copy(&op->buf, buf); } else { op->buf.type = NULL; }
+  op->act.type = NULL;
+
+  // Reads are capped at one ring buffer, with or without io_uring
+  op->len = cx_min(len, (size_t)CX_RING_BUF_SIZE);
+  op->buf_idx = -1;
+  op->polling = false;
+  op->prev = NULL;
+  op->next = r->ops;
+  if (r->ops) { r->ops->prev = op; }
+  r->ops = op;
+  r->nops++;
+
+  if (r->fd == -1 || r->queue.count) {
+    *(struct cx_ring_op **)cx_vec_push(&r->queue) = op;
+  } else if (!prep_op(r, op)) {
+    if (errno == EBUSY) {
+      // Out of buffers or entries, queued until completions free some up
+      *(struct cx_ring_op **)cx_vec_push(&r->queue) = op;
+      return op;
+    }
+    
+    int e = errno;
+    free_op(r, op);
+    errno = e;
+    return NULL;
+  }
+
+  return op;
+}
+
+bool cx_ring_submit(struct cx_ring *r) {
+  if (r->fd == -1 || !r->nsubmit) { return true; }
+
+  while (r->nsubmit) {
+    int n = uring_enter(r->fd, r->nsubmit, 0, 0);
+
+    if (n == -1) {
+      if (errno == EINTR) { continue; }
+      return false;
+    }
+
+    r->nsubmit -= n;
+  }
+
+  return true;
+}
+
+static bool complete(struct cx_ring *r,
+		     struct cx_ring_op *op,
+		     int res,
+		     struct cx_scope *s) {
+  struct cx *cx = r->cx;
+
+  if (res < 0 && res != -ECONNRESET && res != -EPIPE && res != -ECONNREFUSED) {
+    cx_error(cx, cx->row, cx->col, "Failed ring op: %d", -res);
+    free_op(r, op);
+    return false;
+  }
+
+  struct cx_box *out = cx_push(s);
+  struct cx_buf *b = op->buf.type
+    ? cx_baseof(op->buf.as_file, struct cx_buf, file)
+    : NULL;
+
+  switch (op->type) {
+  case CX_RING_ACCEPT:
+    if (res >= 0) {
+      cx_box_init(out, cx->tcp_client_type)->as_file =
+	cx_file_new(cx, res, "r+", NULL);
+    } else {
+      cx_box_init(out, cx->nil_type);
+    }
+    
+    break;
+  case CX_RING_RECV:
+  case CX_RING_READ:
+    if (res > 0) {
+      if (op->buf_idx != -1) {
+	cx_buf_write(b, r->bufs + op->buf_idx*CX_RING_BUF_SIZE, res);
+      }
+
+      cx_box_init(out, cx->int_type)->as_int = res;
+    } else {
+      cx_box_init(out, cx->nil_type);
+    }
+
+    break;
+  case CX_RING_SEND:
+  case CX_RING_WRITE:
+    if (res >= 0) {
+      cx_buf_consume(b, cx_min((size_t)res, cx_buf_len(b)));
+      cx_box_init(out, cx->int_type)->as_int = res;
+    } else {
+      cx_box_init(out, cx->nil_type);
+    }
+
+    break;
+  }
+
+  struct cx_box act = op->act;
+  op->act.type = NULL;
+  free_op(r, op);
+  bool ok = cx_call(&act, s);
+  cx_box_deinit(&act);
+  return ok;
+}
+
+static bool uring_drain(struct cx_ring *r) {
+  size_t i = 0;
+  bool ok = true;
+  
+  for (; i < r->queue.count; i++) {
+    struct cx_ring_op *op = *(struct cx_ring_op **)cx_vec_get(&r->queue, i);
+
+    if (!prep_op(r, op)) {
+      ok = errno == EBUSY;
+      break;
+    }
+  }
+
+  if (i) {
+    size_t n = r->queue.count - i;
+    memmove(r->queue.items,
+	    cx_vec_get(&r->queue, i),
+	    n*sizeof(struct cx_ring_op *));
+    r->queue.count = n;
+  }
+
+  return ok;
+}
+
+static int uring_wait(struct cx_ring *r, int ms, struct cx_scope *s) {
+  if (!uring_drain(r)) { return -1; }
+  
+  struct __kernel_timespec ts = {.tv_sec = ms / 1000,
+				 .tv_nsec = (ms % 1000) * 1000000};
+
+  if (ms > 0) {
+    struct io_uring_sqe *sqe = get_sqe(r);
+    if (!sqe) { return -1; }
+    sqe->opcode = IORING_OP_TIMEOUT;
+    sqe->addr = (uintptr_t)&ts;
+    sqe->len = 1;
+    sqe->off = 1;
+    push_sqe(r);
+  }
+
+  int n = uring_enter(r->fd, r->nsubmit, ms ? 1 : 0, IORING_ENTER_GETEVENTS);
+
+  if (n == -1) {
+    if (errno != EINTR && errno != ETIME) { return -1; }
+  } else {
+    r->nsubmit -= n;
+  }
+
+  int num = 0;
+  unsigned int head = *r->cq_head;
+
+  while (head != __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE)) {
+    struct io_uring_cqe *cqe = r->cqes + (head & *r->cq_mask);
+    struct cx_ring_op *op = (struct cx_ring_op *)(uintptr_t)cqe->user_data;
+    int res = cqe->res;
+    head++;
+    __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+
+    if (!op) { continue; }
+    
+    if (op->polling || res == -EAGAIN) {
+      // Non-blocking files report EAGAIN, wait for readiness and retry
+      bool retry = op->polling;
+      op->polling = false;
+      release_buf(r, op);
+      
+      if (!(retry ? prep_op(r, op) : poll_op(r, op))) {
+	if (errno == EBUSY) {
+	  *(struct cx_ring_op **)cx_vec_push(&r->queue) = op;
+	  continue;
+	}
+	
+	free_op(r, op);
+	return -1;
+      }
+
+      continue;
+    }
+    
+    if (!complete(r, op, res, s)) { return -1; }
+    num++;
+  }
+
+  return uring_drain(r) ? num : -1;
+}
+
+static int perform(struct cx_ring_op *op) {
+  int fd = op->file.as_file->fd, res = -1;
+  struct cx_buf *b = op->buf.type
+    ? cx_baseof(op->buf.as_file, struct cx_buf, file)
+    : NULL;
+
+  switch (op->type) {
+  case CX_RING_ACCEPT:
+    res = accept4(fd, NULL, NULL, SOCK_NONBLOCK);
+    break;
+  case CX_RING_RECV:
+  case CX_RING_READ: {
+    char *data = cx_buf_reserve(b, op->len);
+    res = (op->type == CX_RING_RECV)
+      ? recv(fd, data, op->len, 0)
+      : read(fd, data, op->len);
+    if (res > 0) { cx_buf_commit(b, res); }
+    break;
+  }
+  case CX_RING_SEND:
+  case CX_RING_WRITE: {
+    size_t len = cx_buf_len(b);
+    const char *data = cx_buf_view(b, &len);
+
+    res = (op->type == CX_RING_SEND)
+      ? send(fd, data, len, MSG_NOSIGNAL)
+      : write(fd, data, len);
+
+    // Consumed by complete()
+    break;
+  }
+  }
+
+  return (res == -1) ? -errno : res;
+}
+
+static int sync_wait(struct cx_ring *r, int ms, struct cx_scope *s) {
+  struct cx_vec ops = r->queue;
+  cx_vec_init(&r->queue, sizeof(struct cx_ring_op *));
+  struct pollfd *fds = malloc(sizeof(struct pollfd)*ops.count);
+  int num = 0;
+  bool ok = true;
+
+  for (size_t i = 0; i < ops.count; i++) {
+    struct cx_ring_op *op = *(struct cx_ring_op **)cx_vec_get(&ops, i);
+    fds[i].fd = op->file.as_file->fd;
+
+    fds[i].events =
+      (op->type == CX_RING_SEND || op->type == CX_RING_WRITE) ? POLLOUT : POLLIN;
+  }
+
+  if (poll(fds, ops.count, ms) == -1 && errno != EINTR) { ok = false; }
+
+  for (size_t i = 0; i < ops.count; i++) {
+    struct cx_ring_op *op = *(struct cx_ring_op **)cx_vec_get(&ops, i);
+    int res = -EAGAIN;
+    if (ok && fds[i].revents) { res = perform(op); }
+
+    if (!ok || res == -EAGAIN || res == -EWOULDBLOCK) {
+      *(struct cx_ring_op **)cx_vec_push(&r->queue) = op;
+    } else {
+      ok = complete(r, op, res, s);
+      num++;
+    }
+  }
+
+  free(fds);
+  cx_vec_deinit(&ops);
+  return ok ? num : -1;
+}
+
+int cx_ring_wait(struct cx_ring *r, int ms, struct cx_scope *s) {
+  if (!r->nops) { return cx_ring_submit(r) ? 0 : -1; }
+  return (r->fd == -1) ? sync_wait(r, ms, s) : uring_wait(r, ms, s);
+}
+
+static void new_imp(struct cx_box *out) {
+  out->as_ring = cx_ring_new(out->type->lib->cx);
+}
+
+static bool equid_imp(struct cx_box *x, struct cx_box *y) {
+  return x->as_ring == y->as_ring;
+}
+
+static void copy_imp(struct cx_box *dst, const struct cx_box *src) {
+  dst->as_ring = cx_ring_ref(src->as_ring);
+}
+
+static void dump_imp(struct cx_box *v, FILE *out) {
+  struct cx_ring *r = v->as_ring;
+  fprintf(out, "Ring(%p)r%d", r, r->nrefs);
+}
+
+static void deinit_imp(struct cx_box *v) {
+  cx_ring_deref(v->as_ring);
+}
+
+struct cx_type *cx_init_ring_type(struct cx_lib *lib) {
+  struct cx *cx = lib->cx;
+  struct cx_type *t = cx_add_type(lib, "Ring", cx->any_type);
+  t->new = new_imp;
+  t->equid = equid_imp;
+  t->copy = copy_imp;
+  t->dump = dump_imp;
+  t->deinit = deinit_imp;
+  return t;
+}
@@ -0,0 +1,71 @@
+#ifndef CX_RING_H
+#define CX_RING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "cixl/box.h"
+#include "cixl/vec.h"
+
+#define CX_RING_ENTRIES 256
+#define CX_RING_NBUFS 64
+#define CX_RING_BUF_SIZE 16384
+
+struct cx;
+struct cx_lib;
+struct cx_scope;
+struct cx_type;
+struct io_uring_cqe;
+struct io_uring_sqe;
+
+enum cx_ring_op_type {
+  CX_RING_ACCEPT, CX_RING_RECV, CX_RING_SEND, CX_RING_READ, CX_RING_WRITE
+};
+
+struct cx_ring_op {
+  enum cx_ring_op_type type;
+  struct cx_box file, buf, act;
+  size_t len;
+  int buf_idx;
+  bool polling;
+  struct cx_ring_op *prev, *next;
+};
+
+struct cx_ring {
+  struct cx *cx;
+  int fd;
+  bool fixed;
+
+  unsigned int *sq_head, *sq_tail, *sq_mask, *sq_entries, *sq_array;
+  unsigned int *cq_head, *cq_tail, *cq_mask;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  void *sq_ptr, *cq_ptr;
+  size_t sq_len, cq_len, sqes_len;
+  unsigned int nsubmit;
+
+  struct cx_ring_op *ops;
+  size_t nops;
+  struct cx_vec queue;
+
+  char *bufs;
+  struct cx_vec free_bufs;
+  unsigned int nrefs;
+};
+
+struct cx_ring *cx_ring_new(struct cx *cx);
+struct cx_ring *cx_ring_ref(struct cx_ring *r);
+void cx_ring_deref(struct cx_ring *r);
+
+struct cx_ring_op *cx_ring_push(struct cx_ring *r,
+				enum cx_ring_op_type type,
+				struct cx_box *file,
+				struct cx_box *buf,
+				size_t len);
+
+bool cx_ring_submit(struct cx_ring *r);
+int cx_ring_wait(struct cx_ring *r, int ms, struct cx_scope *s);
+
+struct cx_type *cx_init_ring_type(struct cx_lib *lib);
+
+#endif
@@ -0,0 +1,130 @@
+#include <errno.h>
+#include <stdlib.h>
+
+#include "cixl/sched.h"
+
+struct cx_sched *cx_sched_init(struct cx_sched *s,
+			       unsigned int nworkers,
+			       void *data) {
+  s->nworkers = nworkers;
+  s->workers = NULL;
+  s->data = data;
+  s->failed = false;
+  s->start = NULL;
+  s->run = NULL;
+  s->stop = NULL;
+  return s;
+}
+
+struct cx_sched *cx_sched_deinit(struct cx_sched *s) {
+  free(s->workers);
+  return s;
+}
+
+static uint64_t make_range(uint32_t lo, uint32_t hi) {
+  return lo | ((uint64_t)hi << 32);
+}
+
+static bool take(struct cx_sched_worker *w, size_t *i) {
+  uint64_t r = __atomic_load_n(&w->range, __ATOMIC_ACQUIRE);
+
+  while (true) {
+    uint32_t lo = r, hi = r >> 32;
+    if (lo >= hi) { return false; }
+    
+    if (__atomic_compare_exchange_n(&w->range, &r, make_range(lo+1, hi),
+				    true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+      *i = lo;
+      return true;
+    }
+  }
+}
+
+static bool steal(struct cx_sched_worker *w, size_t *i) {
+  struct cx_sched *s = w->sched;
+  size_t wi = w - s->workers;
+  
+  for (size_t j = 1; j < s->nworkers; j++) {
+    struct cx_sched_worker *v = s->workers + (wi+j) % s->nworkers;
+    uint64_t r = __atomic_load_n(&v->range, __ATOMIC_ACQUIRE);
+
+    while (true) {
+      uint32_t lo = r, hi = r >> 32;
+      if (lo >= hi) { break; }
+
+      // Half of what's left is moved over, the first item is returned
+      uint32_t n = (hi-lo+1) / 2;
+      
+      if (__atomic_compare_exchange_n(&v->range, &r, make_range(lo, hi-n),
+				      true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+	*i = hi-n;
+	__atomic_store_n(&w->range, make_range(hi-n+1, hi), __ATOMIC_RELEASE);
+	return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+static void *run(void *data) {
+  struct cx_sched_worker *w = data;
+  struct cx_sched *s = w->sched;
+  bool ok = !s->start || s->start(w);
+
+  if (ok) {
+    size_t i;
+    
+    while (!__atomic_load_n(&s->failed, __ATOMIC_RELAXED) &&
+	   (take(w, &i) || steal(w, &i))) {
+      if (!s->run(w, i)) {
+	ok = false;
+	break;
+      }
+    }
+  }
+
+  if (!ok) { __atomic_store_n(&s->failed, true, __ATOMIC_RELEASE); }
+  if (s->stop) { s->stop(w, ok); }
+  return NULL;
+}
+
+int cx_sched_run(struct cx_sched *s, size_t n) {
+  if (n > UINT32_MAX) { return EINVAL; }
+  s->failed = false;
+  
+  if (!s->workers &&
+      posix_memalign((void **)&s->workers,
+		     CX_CHAN_LINE,
+		     sizeof(struct cx_sched_worker) * s->nworkers)) {
+    s->workers = NULL;
+    return ENOMEM;
+  }
+
+  // Items start out evenly split, uneven work is evened out by stealing
+  for (unsigned int i = 0; i < s->nworkers; i++) {
+    struct cx_sched_worker *w = s->workers + i;
+    w->sched = s;
+    w->data = NULL;
+    w->range = make_range(n * i / s->nworkers, n * (i+1) / s->nworkers);
+  }
+
+  unsigned int started = 0;
+  int res = 0;
+  
+  for (; started < s->nworkers; started++) {
+    struct cx_sched_worker *w = s->workers + started;
+    res = pthread_create(&w->thread, NULL, run, w);
+    
+    if (res) {
+      __atomic_store_n(&s->failed, true, __ATOMIC_RELEASE);
+      break;
+    }
+  }
+
+  for (unsigned int i = 0; i < started; i++) {
+    pthread_join(s->workers[i].thread, NULL);
+  }
+
+  return res ? res : (s->failed ? -1 : 0);
+}
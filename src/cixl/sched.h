@@ -0,0 +1,43 @@
+#ifndef CX_SCHED_H
+#define CX_SCHED_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cixl/chan.h"
+
+#define CX_SCHED_MAX 64
+
+struct cx_sched;
+
+struct cx_sched_worker {
+  struct cx_sched *sched;
+  pthread_t thread;
+  void *data;
+  
+  // Remaining items as lo | hi << 32, stolen from the top
+  uint64_t range __attribute__((aligned(CX_CHAN_LINE)));
+};
+
+struct cx_sched {
+  unsigned int nworkers;
+  struct cx_sched_worker *workers;
+  void *data;
+  bool failed;
+  
+  bool (*start)(struct cx_sched_worker *);
+  bool (*run)(struct cx_sched_worker *, size_t);
+  void (*stop)(struct cx_sched_worker *, bool);
+};
+
+struct cx_sched *cx_sched_init(struct cx_sched *s,
+			       unsigned int nworkers,
+			       void *data);
+
+struct cx_sched *cx_sched_deinit(struct cx_sched *s);
+
+int cx_sched_run(struct cx_sched *s, size_t n);
+
+#endif
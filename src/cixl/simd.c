@@ -0,0 +1,364 @@
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cixl/simd.h"
+
+#if defined(__x86_64__)
+#define CX_SIMD_X86
+#include <immintrin.h>
+#endif
+
+enum scan_class { SCAN_CHAR, SCAN_EOL, SCAN_ALPHA };
+
+struct kernels {
+  void (*upper)(char *, size_t);
+  void (*lower)(char *, size_t);
+  size_t (*find)(const char *, size_t, enum scan_class, char, bool);
+  size_t (*find_str)(const char *, size_t, const char *, size_t);
+  void (*hex_encode)(const unsigned char *, size_t, char *);
+};
+
+static bool in_class(unsigned char c, enum scan_class cls, char cc) {
+  switch (cls) {
+  case SCAN_CHAR:
+    return c == (unsigned char)cc;
+  case SCAN_EOL:
+    return c == '\r' || c == '\n';
+  case SCAN_ALPHA:
+    return (unsigned char)((c | 0x20) - 'a') < 26;
+  }
+
+  return false;
+}
+
+static void upper_scalar(char *s, size_t len) {
+  for (char *c = s; c < s+len; c++) {
+    if ((unsigned char)(*c - 'a') < 26) { *c -= 0x20; }
+  }
+}
+
+static void lower_scalar(char *s, size_t len) {
+  for (char *c = s; c < s+len; c++) {
+    if ((unsigned char)(*c - 'A') < 26) { *c += 0x20; }
+  }
+}
+
+static size_t find_scalar(const char *s,
+			  size_t len,
+			  enum scan_class cls,
+			  char c,
+			  bool eq) {
+  if (cls == SCAN_CHAR && eq) {
+    const char *p = memchr(s, c, len);
+    return p ? p-s : len;
+  }
+
+  size_t i = 0;
+  while (i < len && in_class(s[i], cls, c) != eq) { i++; }
+  return i;
+}
+
+static size_t find_str_scalar(const char *s, size_t len,
+			      const char *needle, size_t needle_len) {
+  const char *p = memmem(s, len, needle, needle_len);
+  return p ? p-s : len;
+}
+
+static void hex_encode_scalar(const unsigned char *in, size_t len, char *out) {
+  static const char *hex = "0123456789abcdef";
+  
+  for (const unsigned char *c = in; c < in+len; c++) {
+    *out++ = hex[*c >> 4];
+    *out++ = hex[*c & 0xf];
+  }
+}
+
+static const struct kernels scalar_kernels = {
+  upper_scalar, lower_scalar, find_scalar, find_str_scalar, hex_encode_scalar
+};
+
+#ifdef CX_SIMD_X86
+
+static inline __m128i class_sse2(__m128i v, enum scan_class cls, __m128i c) {
+  switch (cls) {
+  case SCAN_CHAR:
+    return _mm_cmpeq_epi8(v, c);
+  case SCAN_EOL:
+    return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')),
+			_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+  case SCAN_ALPHA: {
+    __m128i t = _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)),
+			     _mm_set1_epi8('a'));
+    return _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(25)), t);
+  }
+  }
+
+  return _mm_setzero_si128();
+}
+
+static inline __m128i shift_case_sse2(__m128i v, char from, bool up) {
+  __m128i
+    t = _mm_sub_epi8(v, _mm_set1_epi8(from)),
+    m = _mm_and_si128(_mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(25)), t),
+		      _mm_set1_epi8(0x20));
+
+  return up ? _mm_sub_epi8(v, m) : _mm_add_epi8(v, m);
+}
+
+static void upper_sse2(char *s, size_t len) {
+  size_t i = 0;
+
+  for (; i+16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(s+i));
+    _mm_storeu_si128((__m128i *)(s+i), shift_case_sse2(v, 'a', true));
+  }
+
+  upper_scalar(s+i, len-i);
+}
+
+static void lower_sse2(char *s, size_t len) {
+  size_t i = 0;
+
+  for (; i+16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(s+i));
+    _mm_storeu_si128((__m128i *)(s+i), shift_case_sse2(v, 'A', false));
+  }
+
+  lower_scalar(s+i, len-i);
+}
+
+static size_t find_sse2(const char *s,
+			size_t len,
+			enum scan_class cls,
+			char c,
+			bool eq) {
+  __m128i cv = _mm_set1_epi8(c);
+  size_t i = 0;
+
+  for (; i+16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(s+i));
+    unsigned int m = _mm_movemask_epi8(class_sse2(v, cls, cv));
+    if (!eq) { m = ~m & 0xffff; }
+    if (m) { return i + __builtin_ctz(m); }
+  }
+
+  return i + find_scalar(s+i, len-i, cls, c, eq);
+}
+
+static size_t find_str_sse2(const char *s, size_t len,
+			    const char *needle, size_t needle_len) {
+  if (needle_len < 2 || needle_len > len) {
+    return find_str_scalar(s, len, needle, needle_len);
+  }
+
+  __m128i
+    first = _mm_set1_epi8(needle[0]),
+    last = _mm_set1_epi8(needle[needle_len-1]);
+
+  size_t i = 0;
+
+  for (; i+needle_len-1+16 <= len; i += 16) {
+    __m128i
+      bf = _mm_loadu_si128((const __m128i *)(s+i)),
+      bl = _mm_loadu_si128((const __m128i *)(s+i+needle_len-1));
+
+    unsigned int m = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(bf, first),
+						     _mm_cmpeq_epi8(bl, last)));
+
+    while (m) {
+      size_t j = i + __builtin_ctz(m);
+      if (!memcmp(s+j+1, needle+1, needle_len-2)) { return j; }
+      m &= m-1;
+    }
+  }
+
+  return i + find_str_scalar(s+i, len-i, needle, needle_len);
+}
+
+static inline __m128i hex_digits_sse2(__m128i n) {
+  __m128i gt = _mm_cmpgt_epi8(n, _mm_set1_epi8(9));
+  return _mm_add_epi8(_mm_add_epi8(n, _mm_set1_epi8('0')),
+		      _mm_and_si128(gt, _mm_set1_epi8('a'-'0'-10)));
+}
+
+static void hex_encode_sse2(const unsigned char *in, size_t len, char *out) {
+  __m128i mask = _mm_set1_epi8(0xf);
+  size_t i = 0;
+
+  for (; i+16 <= len; i += 16, out += 32) {
+    __m128i
+      v = _mm_loadu_si128((const __m128i *)(in+i)),
+      hi = hex_digits_sse2(_mm_and_si128(_mm_srli_epi16(v, 4), mask)),
+      lo = hex_digits_sse2(_mm_and_si128(v, mask));
+
+    _mm_storeu_si128((__m128i *)out, _mm_unpacklo_epi8(hi, lo));
+    _mm_storeu_si128((__m128i *)(out+16), _mm_unpackhi_epi8(hi, lo));
+  }
+
+  hex_encode_scalar(in+i, len-i, out);
+}
+
+static const struct kernels sse2_kernels = {
+  upper_sse2, lower_sse2, find_sse2, find_str_sse2, hex_encode_sse2
+};
+
+#define CX_AVX2 __attribute__((target("avx2")))
+
+static inline CX_AVX2 __m256i class_avx2(__m256i v,
+					 enum scan_class cls,
+					 __m256i c) {
+  switch (cls) {
+  case SCAN_CHAR:
+    return _mm256_cmpeq_epi8(v, c);
+  case SCAN_EOL:
+    return _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')),
+			   _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+  case SCAN_ALPHA: {
+    __m256i t = _mm256_sub_epi8(_mm256_or_si256(v, _mm256_set1_epi8(0x20)),
+				_mm256_set1_epi8('a'));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8(25)), t);
+  }
+  }
+
+  return _mm256_setzero_si256();
+}
+
+static inline CX_AVX2 __m256i shift_case_avx2(__m256i v, char from, bool up) {
+  __m256i
+    t = _mm256_sub_epi8(v, _mm256_set1_epi8(from)),
+    m = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8(25)),
+					   t),
+			 _mm256_set1_epi8(0x20));
+
+  return up ? _mm256_sub_epi8(v, m) : _mm256_add_epi8(v, m);
+}
+
+static CX_AVX2 void upper_avx2(char *s, size_t len) {
+  size_t i = 0;
+
+  for (; i+32 <= len; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(s+i));
+    _mm256_storeu_si256((__m256i *)(s+i), shift_case_avx2(v, 'a', true));
+  }
+
+  upper_sse2(s+i, len-i);
+}
+
+static CX_AVX2 void lower_avx2(char *s, size_t len) {
+  size_t i = 0;
+
+  for (; i+32 <= len; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(s+i));
+    _mm256_storeu_si256((__m256i *)(s+i), shift_case_avx2(v, 'A', false));
+  }
+
+  lower_sse2(s+i, len-i);
+}
+
+static CX_AVX2 size_t find_avx2(const char *s,
+				size_t len,
+				enum scan_class cls,
+				char c,
+				bool eq) {
+  __m256i cv = _mm256_set1_epi8(c);
+  size_t i = 0;
+
+  for (; i+32 <= len; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(s+i));
+    uint32_t m = _mm256_movemask_epi8(class_avx2(v, cls, cv));
+    if (!eq) { m = ~m; }
+    if (m) { return i + __builtin_ctz(m); }
+  }
+
+  return i + find_sse2(s+i, len-i, cls, c, eq);
+}
+
+static CX_AVX2 size_t find_str_avx2(const char *s, size_t len,
+				    const char *needle, size_t needle_len) {
+  if (needle_len < 2 || needle_len > len) {
+    return find_str_scalar(s, len, needle, needle_len);
+  }
+
+  __m256i
+    first = _mm256_set1_epi8(needle[0]),
+    last = _mm256_set1_epi8(needle[needle_len-1]);
+
+  size_t i = 0;
+
+  for (; i+needle_len-1+32 <= len; i += 32) {
+    __m256i
+      bf = _mm256_loadu_si256((const __m256i *)(s+i)),
+      bl = _mm256_loadu_si256((const __m256i *)(s+i+needle_len-1));
+
+    uint32_t m = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(bf, first),
+						       _mm256_cmpeq_epi8(bl, last)));
+
+    while (m) {
+      size_t j = i + __builtin_ctz(m);
+      if (!memcmp(s+j+1, needle+1, needle_len-2)) { return j; }
+      m &= m-1;
+    }
+  }
+
+  return i + find_str_sse2(s+i, len-i, needle, needle_len);
+}
+
+static const struct kernels avx2_kernels = {
+  upper_avx2, lower_avx2, find_avx2, find_str_avx2, hex_encode_sse2
+};
+
+#endif
+
+static const struct kernels *kernels = &scalar_kernels;
+
+__attribute__((constructor))
+static void init_kernels() {
+  const char *force = getenv("CX_SIMD");
+
+#ifdef CX_SIMD_X86
+  __builtin_cpu_init();
+
+  if (force && strcmp(force, "scalar") == 0) {
+    kernels = &scalar_kernels;
+  } else if ((!force || strcmp(force, "avx2") == 0) &&
+	     __builtin_cpu_supports("avx2")) {
+    kernels = &avx2_kernels;
+  } else {
+    kernels = &sse2_kernels;
+  }
+#else
+  kernels = &scalar_kernels;
+#endif
+}
+
+void cx_simd_upper(char *s, size_t len) {
+  kernels->upper(s, len);
+}
+
+void cx_simd_lower(char *s, size_t len) {
+  kernels->lower(s, len);
+}
+
+size_t cx_simd_find_char(const char *s, size_t len, char c, bool eq) {
+  return kernels->find(s, len, SCAN_CHAR, c, eq);
+}
+
+size_t cx_simd_find_eol(const char *s, size_t len, bool eq) {
+  return kernels->find(s, len, SCAN_EOL, 0, eq);
+}
+
+size_t cx_simd_find_alpha(const char *s, size_t len, bool eq) {
+  return kernels->find(s, len, SCAN_ALPHA, 0, eq);
+}
+
+size_t cx_simd_find_str(const char *s, size_t len,
+			const char *needle, size_t needle_len) {
+  return kernels->find_str(s, len, needle, needle_len);
+}
+
+void cx_simd_hex_encode(const unsigned char *in, size_t len, char *out) {
+  kernels->hex_encode(in, len, out);
+}
@@ -0,0 +1,19 @@
+#ifndef CX_SIMD_H
+#define CX_SIMD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+void cx_simd_upper(char *s, size_t len);
+void cx_simd_lower(char *s, size_t len);
+
+size_t cx_simd_find_char(const char *s, size_t len, char c, bool eq);
+size_t cx_simd_find_eol(const char *s, size_t len, bool eq);
+size_t cx_simd_find_alpha(const char *s, size_t len, bool eq);
+
+size_t cx_simd_find_str(const char *s, size_t len,
+			const char *needle, size_t needle_len);
+
+void cx_simd_hex_encode(const unsigned char *in, size_t len, char *out);
+
+#endif
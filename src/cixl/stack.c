@@ -6,6 +6,7 @@
 #include "cixl/error.h"
 #include "cixl/iter.h"
 #include "cixl/malloc.h"
+#include "cixl/pack.h"
 #include "cixl/stack.h"
 
 struct cx_stack_iter {
@@ -51,20 +52,20 @@ struct cx_stack *cx_stack_new(struct cx *cx) {
   v->cx = cx;
   cx_vec_init(&v->imp, sizeof(struct cx_box));
   v->imp.alloc = &cx->stack_items_alloc;
+  v->frozen = false;
   v->nrefs = 1;
   return v;
 }
 
 struct cx_stack *cx_stack_ref(struct cx_stack *stack) {
-  stack->nrefs++;
+  cx_nrefs_inc(stack);
   return stack;
 }
 
 void cx_stack_deref(struct cx_stack *stack) {
   cx_test(stack->nrefs);
-  stack->nrefs--;
 
-  if (!stack->nrefs) {
+  if (!cx_nrefs_dec(stack)) {
     cx_do_vec(&stack->imp, struct cx_box, b) { cx_box_deinit(b); }
     cx_vec_deinit(&stack->imp);
     cx_free(&stack->cx->stack_alloc, stack);
@@ -192,10 +193,57 @@ static bool emit_imp(struct cx_box *v, const char *exp, FILE *out) {
   return true;
 }
 
+static bool freeze_imp(struct cx_box *v) {
+  struct cx_stack *s = v->as_ptr;
+  if (s->frozen) { return true; }
+  s->frozen = true;
+  
+  cx_do_vec(&s->imp, struct cx_box, b) {
+    if (!cx_freeze(b)) { return false; }
+  }
+
+  return true;
+}
+
+static bool frozen_imp(struct cx_box *v) {
+  struct cx_stack *s = v->as_ptr;
+  return s->frozen;
+}
+
 static void deinit_imp(struct cx_box *v) {
   cx_stack_deref(v->as_ptr);
 }
 
+static bool pack_imp(struct cx_box *v, struct cx_buf *out) {
+  struct cx_stack *s = v->as_ptr;
+  cx_pack_uint(out, s->imp.count);
+
+  cx_do_vec(&s->imp, struct cx_box, sv) {
+    if (!cx_pack_box(sv, out)) { return false; }
+  }
+
+  return true;
+}
+
+static bool unpack_imp(struct cx_type *t,
+		       struct cx_unpack *in,
+		       struct cx_box *out) {
+  uint64_t n = 0;
+  if (!cx_unpack_uint(in, &n)) { return false; }
+  struct cx_stack *s = cx_stack_new(in->cx);
+  cx_box_init(out, t)->as_ptr = s;
+  
+  for (uint64_t i = 0; i < n; i++) {
+    if (!cx_unpack_box(in, cx_vec_push(&s->imp))) {
+      cx_vec_pop(&s->imp);
+      cx_box_deinit(out);
+      return false;
+    }
+  }
+
+  return true;
+}
+
 struct cx_type *cx_init_stack_type(struct cx_lib *lib) {
   struct cx *cx = lib->cx;
   struct cx_type *t = cx_add_type(lib, "Stack", cx->cmp_type, cx->seq_type);
@@ -211,6 +259,10 @@ struct cx_type *cx_init_stack_type(struct cx_lib *lib) {
   t->dump = dump_imp;
   t->print = print_imp;
   t->emit = emit_imp;
+  t->pack = pack_imp;
+  t->unpack = unpack_imp;
+  t->freeze = freeze_imp;
+  t->frozen = frozen_imp;
   t->deinit = deinit_imp;
   return t;
 }
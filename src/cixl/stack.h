@@ -9,6 +9,7 @@ struct cx_type;
 struct cx_stack {
   struct cx *cx;
   struct cx_vec imp;
+  bool frozen;
   unsigned int nrefs;
 };
 
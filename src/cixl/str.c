@@ -7,6 +7,7 @@
 #include "cixl/emit.h"
 #include "cixl/error.h"
 #include "cixl/iter.h"
+#include "cixl/pack.h"
 #include "cixl/scope.h"
 #include "cixl/str.h"
 
@@ -54,22 +55,160 @@ static struct cx_iter *char_iter_new(struct cx_str *str) {
 
 struct cx_str *cx_str_new(const char *data, size_t len) {
   struct cx_str *str = malloc(sizeof(struct cx_str)+len+1);
+  str->data = str->imp;
   if (data) { memcpy(str->data, data, len); }
   str->data[len] = 0;
   str->len = len;
   str->nrefs = 1;
+  str->base = NULL;
+  str->release = NULL;
+  str->sliced = str->cached = str->frozen = false;
   return str;
 }
 
+struct cx_str *cx_str_take(char *data, size_t len) {
+  struct cx_str *str = malloc(sizeof(struct cx_str));
+  str->data = data;
+  str->len = len;
+  str->nrefs = 1;
+  str->base = NULL;
+  str->release = NULL;
+  str->sliced = str->cached = str->frozen = false;
+  return str;
+}
+
+struct cx_str *cx_str_extern(char *data,
+			     size_t len,
+			     void (*release)(struct cx_str *)) {
+  struct cx_str *str = cx_str_take(data, len);
+  str->release = release;
+
+  // Never written to, mutating copies
+  str->sliced = true;
+  return str;
+}
+
+static void unslice(struct cx_str *str) {
+  char *data = malloc(str->len+1);
+  memcpy(data, str->data, str->len);
+  data[str->len] = 0;
+  cx_str_deref(str->base);
+  str->base = NULL;
+  str->data = data;
+}
+
+struct cx_str *cx_str_slice(struct cx_str *str, size_t offs, size_t len) {
+  cx_test(offs+len <= str->len);
+
+  if (!str->base && !str->release && !str->frozen && str->data != str->imp) {
+    struct cx_str *base = cx_str_new(str->data, str->len);
+    free(str->data);
+    str->data = base->data;
+    str->base = base;
+  }
+
+  struct cx_str *base = str->base ? str->base : str;
+  struct cx_str *s = malloc(sizeof(struct cx_str));
+  s->data = str->data+offs;
+  s->len = len;
+  s->nrefs = 1;
+  s->base = cx_str_ref(base);
+  s->release = NULL;
+  s->sliced = s->cached = s->frozen = false;
+  if (!base->sliced) { base->sliced = true; }
+  return s;
+}
+
 struct cx_str *cx_str_ref(struct cx_str *str) {
-  str->nrefs++;
+  cx_nrefs_inc(str);
   return str;
 }
 
 void cx_str_deref(struct cx_str *str) {
   cx_test(str->nrefs);
-  str->nrefs--;
-  if (!str->nrefs) { free(str); }
+
+  if (!cx_nrefs_dec(str)) {
+    if (str->base) {
+      cx_str_deref(str->base);
+    } else if (str->release) {
+      str->release(str);
+    } else if (str->data != str->imp) {
+      free(str->data);
+    }
+    
+    free(str);
+  }
+}
+
+const char *cx_str_cstr(struct cx_str *str) {
+  if (str->data[str->len]) { unslice(str); }
+  return str->data;
+}
+
+char *cx_str_mut(struct cx_str *str) {
+  str->cached = false;
+  
+  if (str->base) {
+    unslice(str);
+  } else if (str->sliced) {
+    char *data = malloc(str->len+1);
+    memcpy(data, str->data, str->len+1);
+    str->data = data;
+    str->release = NULL;
+    str->sliced = false;
+  }
+  
+  return str->data;
+}
+
+static void cache(struct cx_str *str) {
+  uint64_t p = 0;
+
+  if (str->len >= sizeof(p)) {
+    memcpy(&p, str->data, sizeof(p));
+    p = __builtin_bswap64(p);
+  } else {
+    for (size_t i = 0; i < sizeof(p); i++) {
+      p = (p << 8) | ((i < str->len) ? (unsigned char)str->data[i] : 0);
+    }
+  }
+  
+  str->prefix = p;
+  str->hash = 0;
+  str->cached = true;
+}
+
+static uint64_t get_prefix(struct cx_str *str) {
+  if (!str->cached) { cache(str); }
+  return str->prefix;
+}
+
+void cx_str_freeze(struct cx_str *str) {
+  if (str->frozen) { return; }
+
+  // Slices get their own copy, frozen strings never rewrite data
+  if (str->base) { unslice(str); }
+
+  // Lazy fields are filled in up front since readers may be on any thread
+  cx_str_hash(str);
+  str->sliced = true;
+  str->frozen = true;
+}
+
+uint64_t cx_str_hash(struct cx_str *str) {
+  if (!str->cached) { cache(str); }
+  
+  if (!str->hash) {
+    uint64_t h = 14695981039346656037UL;
+    
+    for (const char *c = str->data; c < str->data+str->len; c++) {
+      h = (h ^ (unsigned char)*c) * 1099511628211UL;
+    }
+
+    str->hash = h ? h : 1;
+  }
+
+  return str->hash;
 }
 
 static bool equid_imp(struct cx_box *x, struct cx_box *y) {
@@ -78,16 +217,27 @@ static bool equid_imp(struct cx_box *x, struct cx_box *y) {
 
 static bool eqval_imp(struct cx_box *x, struct cx_box *y) {
   struct cx_str *xs = x->as_str, *ys = y->as_str;
-  if (xs->len != ys->len) { return false; }
-  return strncmp(xs->data, ys->data, xs->len) == 0;
+  if (xs == ys) { return true; }
+  if (xs->len != ys->len || get_prefix(xs) != get_prefix(ys)) { return false; }
+  if (xs->len <= sizeof(xs->prefix)) { return true; }
+  if (cx_str_hash(xs) != cx_str_hash(ys)) { return false; }
+  return memcmp(xs->data, ys->data, xs->len) == 0;
 }
 
 static enum cx_cmp cmp_imp(const struct cx_box *x, const struct cx_box *y) {
   struct cx_str *xs = x->as_str, *ys = y->as_str;
-  int cmp = strncmp(xs->data, ys->data, cx_min(xs->len, ys->len));
-  if (!cmp) { cmp = cx_cmp_size(&xs->len, &ys->len); }
+  uint64_t xp = get_prefix(xs), yp = get_prefix(ys);
+  if (xp < yp) { return CX_CMP_LT; }
+  if (xp > yp) { return CX_CMP_GT; }
+  
+  size_t len = cx_min(xs->len, ys->len);
+  int cmp = (len > sizeof(xp))
+    ? memcmp(xs->data+sizeof(xp), ys->data+sizeof(xp), len-sizeof(xp))
+    : 0;
+
   if (cmp < 0) { return CX_CMP_LT; }
-  return (cmp > 0) ? CX_CMP_GT : CX_CMP_EQ;
+  if (cmp > 0) { return CX_CMP_GT; }
+  return cx_cmp_size(&xs->len, &ys->len);
 }
 
 static bool ok_imp(struct cx_box *v) {
@@ -139,15 +289,12 @@ static void write_imp(struct cx_box *v, FILE *out) {
 
 static void dump_imp(struct cx_box *v, FILE *out) {
   struct cx_str *s = v->as_str;
-  fprintf(out, "'%s'r%d", s->data, s->nrefs);
+  fprintf(out, "'%.*s'r%d", (int)s->len, s->data, s->nrefs);
 }
 
 static void print_imp(struct cx_box *v, FILE *out) {
   struct cx_str *s = v->as_str;
-  
-  for (char *c = s->data; c < s->data+s->len; c++) {
-    fputc(*c, out);
-  }
+  fwrite(s->data, 1, s->len, out);
 }
 
 void cx_cstr_cencode(const char *in, size_t len, FILE *out) {
@@ -194,10 +341,34 @@ static bool emit_imp(struct cx_box *v, const char *exp, FILE *out) {
   return true;
 }
 
+static bool freeze_imp(struct cx_box *v) {
+  cx_str_freeze(v->as_str);
+  return true;
+}
+
+static bool frozen_imp(struct cx_box *v) {
+  return v->as_str->frozen;
+}
+
 static void deinit_imp(struct cx_box *v) {
   cx_str_deref(v->as_str);
 }
 
+static bool pack_imp(struct cx_box *v, struct cx_buf *out) {
+  cx_pack_bytes(out, v->as_str->data, v->as_str->len);
+  return true;
+}
+
+static bool unpack_imp(struct cx_type *t,
+		       struct cx_unpack *in,
+		       struct cx_box *out) {
+  size_t len = 0;
+  const char *data = cx_unpack_bytes(in, &len);
+  if (!data) { return false; }
+  cx_box_init(out, t)->as_str = cx_str_new(data, len);
+  return true;
+}
+
 struct cx_type *cx_init_str_type(struct cx_lib *lib) {
   struct cx *cx = lib->cx;
   struct cx_type *t = cx_add_type(lib, "Str", cx->cmp_type, cx->seq_type);
@@ -212,6 +383,10 @@ struct cx_type *cx_init_str_type(struct cx_lib *lib) {
   t->dump = dump_imp;
   t->print = print_imp;
   t->emit = emit_imp;
+  t->pack = pack_imp;
+  t->unpack = unpack_imp;
+  t->freeze = freeze_imp;
+  t->frozen = frozen_imp;
   t->deinit = deinit_imp;
   return t;
 }
@@ -4,15 +4,35 @@
 struct cx;
 struct cx_type;
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 struct cx_str {
+  char *data;
   size_t len;
   unsigned int nrefs;
-  char data[];
+  struct cx_str *base;
+  void (*release)(struct cx_str *);
+  bool sliced, cached, frozen;
+  uint64_t prefix, hash;
+  char imp[];
 };
 
 struct cx_str *cx_str_new(const char *data, size_t len);
+struct cx_str *cx_str_take(char *data, size_t len);
+
+struct cx_str *cx_str_extern(char *data,
+			     size_t len,
+			     void (*release)(struct cx_str *));
+
+struct cx_str *cx_str_slice(struct cx_str *str, size_t offs, size_t len);
 struct cx_str *cx_str_ref(struct cx_str *str);
 void cx_str_deref(struct cx_str *str);
+const char *cx_str_cstr(struct cx_str *str);
+char *cx_str_mut(struct cx_str *str);
+void cx_str_freeze(struct cx_str *str);
+uint64_t cx_str_hash(struct cx_str *str);
 enum cx_cmp cx_cmp_str(const void *x, const void *y);
 
 void cx_cstr_cencode(const char *in, size_t len, FILE *out);
@@ -7,6 +7,7 @@
 #include "cixl/cx.h"
 #include "cixl/emit.h"
 #include "cixl/error.h"
+#include "cixl/pack.h"
 #include "cixl/scope.h"
 #include "cixl/str.h"
 #include "cixl/sym.h"
@@ -56,6 +57,19 @@ static bool emit_imp(struct cx_box *v, const char *exp, FILE *out) {
   return true;
 }
 
+static bool pack_imp(struct cx_box *v, struct cx_buf *out) {
+  return cx_pack_id(v->type->lib->cx, v->as_sym.id, out);
+}
+
+static bool unpack_imp(struct cx_type *t,
+		       struct cx_unpack *in,
+		       struct cx_box *out) {
+  char id[CX_PACK_MAX_ID+1];
+  if (!cx_unpack_id(in, id)) { return false; }
+  cx_box_init(out, t)->as_sym = cx_sym(in->cx, id);
+  return true;
+}
+
 struct cx_type *cx_init_sym_type(struct cx_lib *lib) {
   struct cx_type *t = cx_add_type(lib, "Sym", lib->cx->cmp_type);
   t->new = new_imp;
@@ -65,5 +79,7 @@ struct cx_type *cx_init_sym_type(struct cx_lib *lib) {
   t->dump = dump_imp;
   t->print = print_imp;
   t->emit = emit_imp;
+  t->pack = pack_imp;
+  t->unpack = unpack_imp;
   return t;
 }
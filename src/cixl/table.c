@@ -2,16 +2,11 @@
 #include "cixl/error.h"
 #include "cixl/iter.h"
 #include "cixl/malloc.h"
+#include "cixl/pack.h"
 #include "cixl/pair.h"
 #include "cixl/scope.h"
 #include "cixl/table.h"
 
-struct cx_table_iter {
-  struct cx_iter iter;
-  struct cx_table *table;
-  size_t i;
-};
-
 bool table_next(struct cx_iter *iter, struct cx_box *out, struct cx_scope *scope) {
   struct cx *cx = scope->cx;
   struct cx_table_iter *it = cx_baseof(iter, struct cx_table_iter, iter);
@@ -51,20 +46,20 @@ struct cx_table *cx_table_new(struct cx *cx) {
   t->cx = cx;
   cx_set_init(&t->entries, sizeof(struct cx_table_entry), cx_cmp_box);
   t->entries.key_offs = offsetof(struct cx_table_entry, key);
+  t->frozen = false;
   t->nrefs = 1;
   return t;
 }
 
 struct cx_table *cx_table_ref(struct cx_table *table) {
-  table->nrefs++;
+  cx_nrefs_inc(table);
   return table;
 }
 
 void cx_table_deref(struct cx_table *table) {
   cx_test(table->nrefs);
-  table->nrefs--;
   
-  if (!table->nrefs) {
+  if (!cx_nrefs_dec(table)) {
     cx_do_set(&table->entries, struct cx_table_entry, e) {
       cx_box_deinit(&e->key);
       cx_box_deinit(&e->val);
@@ -191,10 +186,70 @@ static void dump_imp(struct cx_box *v, FILE *out) {
   fprintf(out, ")r%d", t->nrefs);
 }
 
+static bool freeze_imp(struct cx_box *v) {
+  struct cx_table *t = v->as_ptr;
+  if (t->frozen) { return true; }
+  t->frozen = true;
+  
+  cx_do_set(&t->entries, struct cx_table_entry, e) {
+    if (!cx_freeze(&e->key) || !cx_freeze(&e->val)) { return false; }
+  }
+
+  return true;
+}
+
+static bool frozen_imp(struct cx_box *v) {
+  struct cx_table *t = v->as_ptr;
+  return t->frozen;
+}
+
 static void deinit_imp(struct cx_box *v) {
   cx_table_deref(v->as_table);
 }
 
+static bool pack_imp(struct cx_box *v, struct cx_buf *out) {
+  struct cx_table *t = v->as_table;
+  cx_pack_uint(out, t->entries.members.count);
+
+  cx_do_set(&t->entries, struct cx_table_entry, e) {
+    if (!cx_pack_box(&e->key, out) || !cx_pack_box(&e->val, out)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool unpack_imp(struct cx_type *t,
+		       struct cx_unpack *in,
+		       struct cx_box *out) {
+  uint64_t n = 0;
+  if (!cx_unpack_uint(in, &n)) { return false; }
+  struct cx_table *tbl = cx_table_new(in->cx);
+  cx_box_init(out, t)->as_table = tbl;
+  
+  for (uint64_t i = 0; i < n; i++) {
+    struct cx_box k, v;
+    
+    if (!cx_unpack_box(in, &k)) {
+      cx_box_deinit(out);
+      return false;
+    }
+
+    if (!cx_unpack_box(in, &v)) {
+      cx_box_deinit(&k);
+      cx_box_deinit(out);
+      return false;
+    }
+
+    cx_table_put(tbl, &k, &v);
+    cx_box_deinit(&k);
+    cx_box_deinit(&v);
+  }
+
+  return true;
+}
+
 struct cx_type *cx_init_table_type(struct cx_lib *lib) {
   struct cx *cx = lib->cx;
   struct cx_type *t = cx_add_type(lib, "Table", cx->cmp_type, cx->seq_type);
@@ -208,6 +263,10 @@ struct cx_type *cx_init_table_type(struct cx_lib *lib) {
   t->iter = iter_imp;
   t->write = write_imp;
   t->dump = dump_imp;
+  t->pack = pack_imp;
+  t->unpack = unpack_imp;
+  t->freeze = freeze_imp;
+  t->frozen = frozen_imp;
   t->deinit = deinit_imp;
   return t;
 }
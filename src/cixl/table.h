@@ -2,6 +2,7 @@
 #define CX_TABLE_H
 
 #include "cixl/box.h"
+#include "cixl/iter.h"
 #include "cixl/set.h"
 
 struct cx;
@@ -11,6 +12,7 @@ struct cx_lib;
 struct cx_table {
   struct cx *cx;
   struct cx_set entries;
+  bool frozen;
   unsigned int nrefs;
 };
 
@@ -18,6 +20,14 @@ struct cx_table_entry {
   struct cx_box key, val;
 }; 
 
+struct cx_table_iter {
+  struct cx_iter iter;
+  struct cx_table *table;
+  size_t i;
+};
+
+struct cx_table_iter *cx_table_iter_new(struct cx_table *table);
+
 struct cx_table *cx_table_new(struct cx *cx);
 struct cx_table *cx_table_ref(struct cx_table *table);
 void cx_table_deref(struct cx_table *table);
@@ -0,0 +1,168 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cixl/bin.h"
+#include "cixl/chan.h"
+#include "cixl/cx.h"
+#include "cixl/error.h"
+#include "cixl/scope.h"
+#include "cixl/stack.h"
+#include "cixl/task.h"
+
+struct cx_task *cx_task_new(struct cx *cx, const char *code) {
+  struct cx_task *t = malloc(sizeof(struct cx_task));
+  t->cx = cx;
+  t->code = strdup(code);
+  t->error = NULL;
+  cx_vec_init(&t->args, sizeof(struct cx_msg));
+  cx_vec_init(&t->results, sizeof(struct cx_msg));
+  t->joined = true;
+  t->nrefs = 1;
+  return t;
+}
+
+struct cx_task *cx_task_ref(struct cx_task *t) {
+  t->nrefs++;
+  return t;
+}
+
+static void clear_msgs(struct cx_vec *msgs) {
+  cx_do_vec(msgs, struct cx_msg, m) { cx_msg_deinit(m); }
+  cx_vec_clear(msgs);
+}
+
+void cx_task_deref(struct cx_task *t) {
+  cx_test(t->nrefs);
+  t->nrefs--;
+
+  if (!t->nrefs) {
+    // Dropped tasks are waited for, the thread still uses the struct
+    if (!t->joined) { pthread_join(t->thread, NULL); }
+    clear_msgs(&t->args);
+    cx_vec_deinit(&t->args);
+    clear_msgs(&t->results);
+    cx_vec_deinit(&t->results);
+    free(t->code);
+    free(t->error);
+    free(t);
+  }
+}
+
+static bool push_results(struct cx_task *t, struct cx *cx) {
+  struct cx_scope *s = cx_scope(cx, 0);
+
+  cx_do_vec(&s->stack, struct cx_box, v) {
+    if (!cx_msg_init(cx_vec_push(&t->results), cx, v)) {
+      t->results.count--;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static void *run(void *data) {
+  struct cx_task *t = data;
+  struct cx cx;
+  cx_init(&cx);
+  cx_init_libs(&cx);
+  bool ok = cx_use(&cx, "cx");
+  
+  if (ok) {
+    struct cx_scope *s = cx_scope(&cx, 0);
+    
+    cx_do_vec(&t->args, struct cx_msg, m) {
+      if (!cx_msg_get(m, &cx, cx_push(s))) {
+	cx_pop(s, false);
+	ok = false;
+	break;
+      }
+    }
+  }
+
+  ok = ok && cx_eval_str(&cx, t->code) && push_results(t, &cx);
+  
+  if (!ok) {
+    size_t len = 0;
+    FILE *out = open_memstream(&t->error, &len);
+    cx_dump_errors(&cx, out);
+    fclose(out);
+  }
+
+  cx_deinit(&cx);
+  return NULL;
+}
+
+bool cx_task_start(struct cx_task *t) {
+  struct cx *cx = t->cx;
+  int res = pthread_create(&t->thread, NULL, run, t);
+
+  if (res) {
+    cx_error(cx, cx->row, cx->col, "Failed starting task: %d", res);
+    return false;
+  }
+
+  t->joined = false;
+  return true;
+}
+
+bool cx_task_join(struct cx_task *t, struct cx_scope *scope) {
+  struct cx *cx = t->cx;
+
+  if (t->joined) {
+    cx_error(cx, cx->row, cx->col, "Task not running");
+    return false;
+  }
+
+  pthread_join(t->thread, NULL);
+  t->joined = true;
+  clear_msgs(&t->args);
+
+  if (t->error) {
+    cx_error(cx, cx->row, cx->col, "Task failed:\n%s", t->error);
+    return false;
+  }
+  
+  struct cx_stack *s = cx_stack_new(cx);
+  bool ok = true;
+  
+  cx_do_vec(&t->results, struct cx_msg, m) {
+    if (!cx_msg_get(m, cx, cx_vec_push(&s->imp))) {
+      s->imp.count--;
+      ok = false;
+      break;
+    }
+  }
+
+  clear_msgs(&t->results);
+  cx_box_init(cx_push(scope), cx->stack_type)->as_ptr = s;
+  return ok;
+}
+
+static bool equid_imp(struct cx_box *x, struct cx_box *y) {
+  return x->as_ptr == y->as_ptr;
+}
+
+static void copy_imp(struct cx_box *dst, const struct cx_box *src) {
+  dst->as_ptr = cx_task_ref(src->as_ptr);
+}
+
+static void dump_imp(struct cx_box *v, FILE *out) {
+  struct cx_task *t = v->as_ptr;
+  fprintf(out, "Task(%p)r%d", t, t->nrefs);
+}
+
+static void deinit_imp(struct cx_box *v) {
+  cx_task_deref(v->as_ptr);
+}
+
+struct cx_type *cx_init_task_type(struct cx_lib *lib) {
+  struct cx *cx = lib->cx;
+  struct cx_type *t = cx_add_type(lib, "Task", cx->any_type);
+  t->equid = equid_imp;
+  t->copy = copy_imp;
+  t->dump = dump_imp;
+  t->deinit = deinit_imp;
+  return t;
+}
@@ -0,0 +1,32 @@
+#ifndef CX_TASK_H
+#define CX_TASK_H
+
+#include <pthread.h>
+#include <stdbool.h>
+
+#include "cixl/vec.h"
+
+struct cx;
+struct cx_lib;
+struct cx_scope;
+struct cx_type;
+
+struct cx_task {
+  struct cx *cx;
+  pthread_t thread;
+  char *code, *error;
+  struct cx_vec args, results;
+  bool joined;
+  unsigned int nrefs;
+};
+
+struct cx_task *cx_task_new(struct cx *cx, const char *code);
+struct cx_task *cx_task_ref(struct cx_task *t);
+void cx_task_deref(struct cx_task *t);
+
+bool cx_task_start(struct cx_task *t);
+bool cx_task_join(struct cx_task *t, struct cx_scope *scope);
+
+struct cx_type *cx_init_task_type(struct cx_lib *lib);
+
+#endif
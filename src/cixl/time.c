@@ -7,6 +7,7 @@
 #include "cixl/box.h"
 #include "cixl/cx.h"
 #include "cixl/lib.h"
+#include "cixl/pack.h"
 #include "cixl/time.h"
 
 struct cx_time *cx_time_init(struct cx_time *time, int32_t months, int64_t ns) {
@@ -141,6 +142,21 @@ static void print_imp(struct cx_box *v, FILE *out) {
   }
 }
 
+static bool pack_imp(struct cx_box *v, struct cx_buf *out) {
+  cx_pack_int(out, v->as_time.months);
+  cx_pack_int(out, v->as_time.ns);
+  return true;
+}
+
+static bool unpack_imp(struct cx_type *t,
+		       struct cx_unpack *in,
+		       struct cx_box *out) {
+  int64_t months = 0, ns = 0;
+  if (!cx_unpack_int(in, &months) || !cx_unpack_int(in, &ns)) { return false; }
+  cx_time_init(&cx_box_init(out, t)->as_time, months, ns);
+  return true;
+}
+
 struct cx_type *cx_init_time_type(struct cx_lib *lib) {
   struct cx_type *t = cx_add_type(lib, "Time", lib->cx->cmp_type);
   t->equid = equid_imp;
@@ -149,5 +165,7 @@ struct cx_type *cx_init_time_type(struct cx_lib *lib) {
   t->write = write_imp;
   t->dump = dump_imp;
   t->print = print_imp;
+  t->pack = pack_imp;
+  t->unpack = unpack_imp;
   return t;
 }
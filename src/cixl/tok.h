@@ -7,13 +7,11 @@
 #define cx_tok_type(id, ...)			\
   struct cx_tok_type *id() {			\
     static struct cx_tok_type type;		\
-    static bool init = true;			\
 						\
-    if (init) {					\
-      init = false;				\
-      cx_tok_type_init(&type, #id);		\
-      __VA_ARGS__;				\
-    }						\
+    cx_once({					\
+	cx_tok_type_init(&type, #id);		\
+	__VA_ARGS__;				\
+      });					\
 						\
     return &type;				\
   }						\
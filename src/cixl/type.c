@@ -37,6 +37,10 @@ struct cx_type *cx_type_init(struct cx_type *type,
   type->dump = NULL;
   type->print = NULL;
   type->emit = NULL;
+  type->pack = NULL;
+  type->unpack = NULL;
+  type->freeze = NULL;
+  type->frozen = NULL;
   type->deinit = NULL;
 
   type->type_deinit = NULL;
@@ -119,7 +123,7 @@ static bool emit_imp(struct cx_box *v, const char *exp, FILE *out) {
   struct cx_type *t = v->as_ptr;
   
   fprintf(out,
-	  "cx_box_init(%s, cx->meta_type)->as_ptr = %s();\n",
+	  "cx_box_init(%s, cx->meta_type)->as_ptr = %s(cx);\n",
 	  exp, t->emit_id);
   
   return true;
@@ -7,8 +7,10 @@
 
 struct cx;
 struct cx_box;
+struct cx_buf;
 struct cx_iter;
 struct cx_scope;
+struct cx_unpack;
 
 struct cx_type {
   struct cx_lib *lib;
@@ -31,6 +33,10 @@ struct cx_type {
   void (*dump)(struct cx_box *, FILE *);
   void (*print)(struct cx_box *, FILE *);
   bool (*emit)(struct cx_box *, const char *, FILE *);
+  bool (*pack)(struct cx_box *, struct cx_buf *);
+  bool (*unpack)(struct cx_type *, struct cx_unpack *, struct cx_box *);
+  bool (*freeze)(struct cx_box *);
+  bool (*frozen)(struct cx_box *);
   void (*deinit)(struct cx_box *);
 
   void *(*type_deinit)(struct cx_type *);
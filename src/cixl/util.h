@@ -1,6 +1,7 @@
 #ifndef CX_UTIL_H
 #define CX_UTIL_H
 
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stddef.h>
@@ -16,6 +17,35 @@
 #define cx_gencid(prefix)			\
   cx_cid(prefix, __COUNTER__)			\
 
+#define cx_once(...) {						\
+    static int _once_done = 0;						\
+									\
+    if (!__atomic_load_n(&_once_done, __ATOMIC_ACQUIRE)) {		\
+      static pthread_mutex_t _once_lock = PTHREAD_MUTEX_INITIALIZER;	\
+      pthread_mutex_lock(&_once_lock);					\
+									\
+      if (!_once_done) {						\
+	__VA_ARGS__;							\
+	__atomic_store_n(&_once_done, 1, __ATOMIC_RELEASE);		\
+      }									\
+									\
+      pthread_mutex_unlock(&_once_lock);				\
+    }									\
+  }									\
+
+// Frozen values may be shared between threads and count atomically
+#define cx_nrefs_inc(x) do {					\
+    if ((x)->frozen) {						\
+      __atomic_add_fetch(&(x)->nrefs, 1, __ATOMIC_RELAXED);	\
+    } else {							\
+      (x)->nrefs++;						\
+    }								\
+  } while (0)							\
+
+#define cx_nrefs_dec(x) ((x)->frozen				\
+    ? __atomic_sub_fetch(&(x)->nrefs, 1, __ATOMIC_ACQ_REL)	\
+    : --(x)->nrefs)						\
+
 #define cx_min(x, y) ({				\
       typeof(x) _x = x;				\
       typeof(y) _y = y;				\
@@ -0,0 +1,225 @@
+#include <time.h>
+
+#include "cixl/box.h"
+#include "cixl/error.h"
+#include "cixl/util.h"
+#include "cixl/wheel.h"
+
+#define get_timer(w, i)					\
+  ((struct cx_wheel_timer *)cx_vec_get(&(w)->timers, i))
+
+int64_t cx_wheel_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec*1000 + ts.tv_nsec/1000000;
+}
+
+struct cx_wheel *cx_wheel_init(struct cx_wheel *w, int64_t now) {
+  w->now = now;
+
+  for (int l = 0; l < CX_WHEEL_LEVELS; l++) {
+    for (int i = 0; i < CX_WHEEL_SLOTS; i++) { w->slots[l][i] = -1; }
+  }
+
+  cx_vec_init(&w->timers, sizeof(struct cx_wheel_timer));
+  w->free = -1;
+  w->len = 0;
+  return w;
+}
+
+struct cx_wheel *cx_wheel_deinit(struct cx_wheel *w) {
+  cx_do_vec(&w->timers, struct cx_wheel_timer, t) {
+    if (t->state != CX_WHEEL_FREE) { cx_box_deinit(&t->action); }
+  }
+
+  cx_vec_deinit(&w->timers);
+  return w;
+}
+
+static void link_timer(struct cx_wheel *w, int32_t i) {
+  struct cx_wheel_timer *t = get_timer(w, i);
+  int64_t delta = t->deadline - w->now, at = t->deadline;
+  int l = 0;
+
+  while (l < CX_WHEEL_LEVELS-1 &&
+	 delta >= (int64_t)1 << (CX_WHEEL_BITS*(l+1))) {
+    l++;
+  }
+
+  if (delta >= (int64_t)1 << (CX_WHEEL_BITS*(l+1))) {
+    // Out of range, parked in the last slot and relinked when cascaded
+    at = w->now + ((int64_t)1 << (CX_WHEEL_BITS*(l+1))) - 1;
+  }
+
+  t->head = &w->slots[l][(at >> (CX_WHEEL_BITS*l)) & CX_WHEEL_MASK];
+  t->prev = -1;
+  t->next = *t->head;
+  if (t->next != -1) { get_timer(w, t->next)->prev = i; }
+  *t->head = i;
+  t->state = CX_WHEEL_ARMED;
+}
+
+static void unlink_timer(struct cx_wheel *w, int32_t i) {
+  struct cx_wheel_timer *t = get_timer(w, i);
+
+  if (t->prev == -1) {
+    *t->head = t->next;
+  } else {
+    get_timer(w, t->prev)->next = t->next;
+  }
+
+  if (t->next != -1) { get_timer(w, t->next)->prev = t->prev; }
+}
+
+static void free_timer(struct cx_wheel *w, int32_t i) {
+  struct cx_wheel_timer *t = get_timer(w, i);
+  t->state = CX_WHEEL_FREE;
+  t->gen++;
+  t->next = w->free;
+  w->free = i;
+  w->len--;
+}
+
+int64_t cx_wheel_add(struct cx_wheel *w,
+		     int64_t deadline,
+		     int64_t interval,
+		     struct cx_box *action) {
+  int32_t i = w->free;
+  struct cx_wheel_timer *t = NULL;
+
+  if (i == -1) {
+    i = w->timers.count;
+    t = cx_vec_push(&w->timers);
+    t->gen = 1;
+  } else {
+    t = get_timer(w, i);
+    w->free = t->next;
+  }
+
+  t->deadline = cx_max(deadline, w->now+1);
+  t->interval = interval;
+  cx_copy(&t->action, action);
+  w->len++;
+  link_timer(w, i);
+  return ((int64_t)t->gen << 32) | i;
+}
+
+static struct cx_wheel_timer *find_timer(struct cx_wheel *w, int64_t id) {
+  int64_t i = id & 0xffffffff;
+  if (id < 0 || i >= w->timers.count) { return NULL; }
+  struct cx_wheel_timer *t = get_timer(w, i);
+  return (t->state == CX_WHEEL_FREE || t->gen != (id >> 32)) ? NULL : t;
+}
+
+bool cx_wheel_cancel(struct cx_wheel *w, int64_t id) {
+  struct cx_wheel_timer *t = find_timer(w, id);
+  if (!t) { return false; }
+  int32_t i = id & 0xffffffff;
+
+  if (t->state == CX_WHEEL_FIRING) {
+    // Released by cx_wheel_advance once the action returns
+    t->interval = 0;
+    return true;
+  }
+
+  unlink_timer(w, i);
+  cx_box_deinit(&t->action);
+  free_timer(w, i);
+  return true;
+}
+
+int64_t cx_wheel_next(struct cx_wheel *w) {
+  if (!w->len) { return -1; }
+  int64_t next = -1;
+
+  for (int l = 0; l < CX_WHEEL_LEVELS; l++) {
+    int bits = CX_WHEEL_BITS*l;
+    int64_t pos = w->now >> bits;
+
+    for (int i = 1; i <= CX_WHEEL_SLOTS; i++) {
+      if (w->slots[l][(pos+i) & CX_WHEEL_MASK] != -1) {
+	// Higher levels report when the slot cascades, not the exact deadline
+	int64_t at = (pos+i) << bits;
+	if (next == -1 || at < next) { next = at; }
+	break;
+      }
+    }
+
+    if (next != -1 && next <= ((pos+1) << bits)) { break; }
+  }
+
+  return next;
+}
+
+static void cascade(struct cx_wheel *w, int l) {
+  int32_t *head = &w->slots[l][(w->now >> (CX_WHEEL_BITS*l)) & CX_WHEEL_MASK];
+  int32_t i = *head;
+  *head = -1;
+
+  while (i != -1) {
+    int32_t next = get_timer(w, i)->next;
+    link_timer(w, i);
+    i = next;
+  }
+}
+
+static bool fire(struct cx_wheel *w, int32_t i, struct cx_scope *s) {
+  struct cx_wheel_timer *t = get_timer(w, i);
+  unlink_timer(w, i);
+  struct cx_box action = t->action;
+
+  if (!t->interval) {
+    free_timer(w, i);
+    bool ok = cx_call(&action, s);
+    cx_box_deinit(&action);
+    return ok;
+  }
+
+  t->state = CX_WHEEL_FIRING;
+  cx_copy(&action, &t->action);
+  bool ok = cx_call(&action, s);
+  cx_box_deinit(&action);
+
+  // Actions may add timers and move the vector
+  t = get_timer(w, i);
+
+  if (t->interval) {
+    t->deadline += t->interval;
+    t->deadline = cx_max(t->deadline, w->now+1);
+    link_timer(w, i);
+  } else {
+    cx_box_deinit(&t->action);
+    free_timer(w, i);
+  }
+
+  return ok;
+}
+
+int cx_wheel_advance(struct cx_wheel *w, int64_t now, struct cx_scope *s) {
+  int num = 0;
+
+  while (w->now < now) {
+    if (!w->len) {
+      w->now = now;
+      break;
+    }
+
+    w->now++;
+
+    for (int l = 1;
+	 l < CX_WHEEL_LEVELS &&
+	   !(w->now & (((int64_t)1 << (CX_WHEEL_BITS*l)) - 1));
+	 l++) {
+      cascade(w, l);
+    }
+
+    int32_t *head = &w->slots[0][w->now & CX_WHEEL_MASK];
+
+    while (*head != -1) {
+      if (!fire(w, *head, s)) { return -1; }
+      num++;
+    }
+  }
+
+  return num;
+}
@@ -0,0 +1,48 @@
+#ifndef CX_WHEEL_H
+#define CX_WHEEL_H
+
+#include <stdint.h>
+
+#include "cixl/box.h"
+#include "cixl/vec.h"
+
+#define CX_WHEEL_BITS 6
+#define CX_WHEEL_SLOTS (1 << CX_WHEEL_BITS)
+#define CX_WHEEL_MASK (CX_WHEEL_SLOTS-1)
+#define CX_WHEEL_LEVELS 4
+
+struct cx_scope;
+
+enum cx_wheel_state {CX_WHEEL_FREE, CX_WHEEL_ARMED, CX_WHEEL_FIRING};
+
+struct cx_wheel_timer {
+  enum cx_wheel_state state;
+  uint32_t gen;
+  int64_t deadline, interval;
+  int32_t prev, next, *head;
+  struct cx_box action;
+};
+
+struct cx_wheel {
+  int64_t now;
+  int32_t slots[CX_WHEEL_LEVELS][CX_WHEEL_SLOTS];
+  struct cx_vec timers;
+  int32_t free;
+  size_t len;
+};
+
+int64_t cx_wheel_ms();
+
+struct cx_wheel *cx_wheel_init(struct cx_wheel *w, int64_t now);
+struct cx_wheel *cx_wheel_deinit(struct cx_wheel *w);
+
+int64_t cx_wheel_add(struct cx_wheel *w,
+		     int64_t deadline,
+		     int64_t interval,
+		     struct cx_box *action);
+
+bool cx_wheel_cancel(struct cx_wheel *w, int64_t id);
+int64_t cx_wheel_next(struct cx_wheel *w);
+int cx_wheel_advance(struct cx_wheel *w, int64_t now, struct cx_scope *s);
+
+#endif
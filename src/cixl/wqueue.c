@@ -0,0 +1,269 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#include "cixl/cx.h"
+#include "cixl/error.h"
+#include "cixl/file.h"
+#include "cixl/poll.h"
+#include "cixl/scope.h"
+#include "cixl/str.h"
+#include "cixl/wqueue.h"
+
+struct cx_wqueue *cx_wqueue_new(size_t high, struct cx_box *action) {
+  struct cx_wqueue *q = malloc(sizeof(struct cx_wqueue));
+  cx_vec_init(&q->items, sizeof(struct cx_wqueue_item));
+  q->head = q->offs = q->len = 0;
+  q->high = high;
+  q->above = false;
+  if (action) { cx_copy(&q->action, action); } else { q->action.type = NULL; }
+  q->poll = NULL;
+  return q;
+}
+
+static void item_deinit(struct cx_wqueue_item *i) {
+  if (i->str) {
+    cx_str_deref(i->str);
+  } else {
+    free(i->data);
+  }
+}
+
+void cx_wqueue_free(struct cx_wqueue *q) {
+  for (size_t i = q->head; i < q->items.count; i++) {
+    item_deinit(cx_vec_get(&q->items, i));
+  }
+
+  cx_vec_deinit(&q->items);
+  if (q->action.type) { cx_box_deinit(&q->action); }
+  if (q->poll) { cx_poll_deref(q->poll); }
+  free(q);
+}
+
+static bool push_len(struct cx_wqueue *q, size_t len) {
+  bool was_above = q->above;
+  q->len += len;
+  if (q->len >= q->high) { q->above = true; }
+  return q->above && !was_above;
+}
+
+bool cx_wqueue_push(struct cx_wqueue *q, const char *data, size_t len) {
+  struct cx_wqueue_item *i = (q->items.count > q->head)
+    ? cx_vec_peek(&q->items, 0)
+    : NULL;
+
+  // Small writes are packed into chunks to keep the number of iovecs down
+  if (!i || i->str || i->capac - i->len < len) {
+    i = cx_vec_push(&q->items);
+    i->str = NULL;
+    i->len = 0;
+    i->capac = cx_max(len, (size_t)CX_WQUEUE_CHUNK);
+    i->data = malloc(i->capac);
+  }
+
+  memcpy(i->data + i->len, data, len);
+  i->len += len;
+  return push_len(q, len);
+}
+
+bool cx_wqueue_push_str(struct cx_wqueue *q, struct cx_str *s) {
+  if (s->len < CX_WQUEUE_MIN_REF) { return cx_wqueue_push(q, s->data, s->len); }
+  struct cx_wqueue_item *i = cx_vec_push(&q->items);
+
+  // Queued as a slice to keep the bytes when s is mutated before flushing
+  i->str = cx_str_slice(s, 0, s->len);
+  i->data = i->str->data;
+  i->len = i->capac = s->len;
+  return push_len(q, s->len);
+}
+
+static void consume(struct cx_wqueue *q, size_t len) {
+  q->len -= len;
+
+  while (len) {
+    struct cx_wqueue_item *i = cx_vec_get(&q->items, q->head);
+    size_t n = cx_min(len, i->len - q->offs);
+    q->offs += n;
+    len -= n;
+
+    if (q->offs == i->len) {
+      item_deinit(i);
+      q->head++;
+      q->offs = 0;
+    }
+  }
+
+  if (q->head == q->items.count) {
+    cx_vec_clear(&q->items);
+    q->head = 0;
+  } else if (q->head > q->items.count / 2) {
+    size_t n = q->items.count - q->head;
+    memmove(q->items.items,
+	    cx_vec_get(&q->items, q->head),
+	    n*sizeof(struct cx_wqueue_item));
+    q->items.count = n;
+    q->head = 0;
+  }
+}
+
+ssize_t cx_wqueue_flush(struct cx_wqueue *q, int fd) {
+  struct iovec iov[IOV_MAX];
+  ssize_t total = 0;
+
+  while (q->len) {
+    int n = 0;
+    size_t len = 0;
+
+    for (size_t i = q->head; i < q->items.count && n < IOV_MAX; i++, n++) {
+      struct cx_wqueue_item *it = cx_vec_get(&q->items, i);
+      size_t offs = (i == q->head) ? q->offs : 0;
+      iov[n].iov_base = it->data + offs;
+      iov[n].iov_len = it->len - offs;
+      len += iov[n].iov_len;
+    }
+
+    ssize_t wlen = writev(fd, iov, n);
+
+    if (wlen == -1) {
+      if (errno == EAGAIN || errno == EINTR) { break; }
+      return -1;
+    }
+
+    consume(q, wlen);
+    total += wlen;
+    if (wlen < len) { break; }
+  }
+
+  return total;
+}
+
+static bool call_action(struct cx_wqueue *q, struct cx *cx, bool above) {
+  if (!q->action.type) { return true; }
+  struct cx_scope *s = cx_scope(cx, 0);
+  cx_box_init(cx_push(s), cx->bool_type)->as_bool = above;
+  struct cx_box a;
+  cx_copy(&a, &q->action);
+  bool ok = cx_call(&a, s);
+  cx_box_deinit(&a);
+  return ok;
+}
+
+static bool poll_flush(void *data) {
+  // The action may close or drop the file
+  struct cx_file *f = cx_file_ref(data);
+  struct cx_poll *p = cx_poll_ref(f->queue->poll);
+  bool ok = cx_file_flush(f);
+  if (f->queue && !f->queue->len) { cx_poll_no_write(p, f->fd); }
+  cx_poll_deref(p);
+  cx_file_deref(f);
+  return ok;
+}
+
+bool cx_file_queue(struct cx_file *f, size_t high, struct cx_box *action) {
+  struct cx *cx = f->cx;
+
+  // Queues are flushed by writing to the fd, Bufs don't have one
+  if (f->fd == -1) {
+    cx_error(cx, cx->row, cx->col, "Queueing writes needs an fd");
+    return false;
+  }
+
+  if (f->_ptr && fflush(f->_ptr)) {
+    cx_error(cx, cx->row, cx->col, "Failed flushing file: %d", errno);
+    return false;
+  }
+
+  if (f->queue) {
+    f->queue->high = high;
+    if (f->queue->action.type) { cx_box_deinit(&f->queue->action); }
+
+    if (action) {
+      cx_copy(&f->queue->action, action);
+    } else {
+      f->queue->action.type = NULL;
+    }
+  } else {
+    f->queue = cx_wqueue_new(high, action);
+  }
+
+  return true;
+}
+
+bool cx_file_poll(struct cx_file *f, struct cx_poll *p) {
+  struct cx_wqueue *q = f->queue;
+  if (q->poll) { cx_poll_deref(q->poll); }
+  q->poll = cx_poll_ref(p);
+  if (!q->len) { return true; }
+  struct cx_poll_file *pf = cx_poll_write(p, f->fd);
+  if (!pf) { return false; }
+  pf->write_fn = poll_flush;
+  pf->write_data = f;
+  return true;
+}
+
+bool cx_file_enqueue(struct cx_file *f, struct cx_box *v, bool print) {
+  struct cx *cx = f->cx;
+  struct cx_wqueue *q = f->queue;
+  bool was_empty = !q->len, crossed = false;
+
+  if (v->type == cx->str_type && print) {
+    crossed = cx_wqueue_push_str(q, v->as_str);
+  } else {
+    char *data = NULL;
+    size_t len = 0;
+    FILE *out = open_memstream(&data, &len);
+
+    if (print) {
+      cx_print(v, out);
+      fclose(out);
+    } else {
+      bool ok = cx_write(v, out);
+      fclose(out);
+
+      if (!ok) {
+	free(data);
+	return false;
+      }
+    }
+
+    crossed = cx_wqueue_push(q, data, len);
+    free(data);
+  }
+
+  if (was_empty && q->len && q->poll) {
+    struct cx_poll_file *pf = cx_poll_write(q->poll, f->fd);
+
+    if (!pf) {
+      cx_error(cx, cx->row, cx->col, "Failed polling: %d", errno);
+      return false;
+    }
+
+    pf->write_fn = poll_flush;
+    pf->write_data = f;
+  }
+
+  return !crossed || call_action(q, cx, true);
+}
+
+bool cx_file_flush(struct cx_file *f) {
+  struct cx *cx = f->cx;
+  struct cx_wqueue *q = f->queue;
+
+  if (cx_wqueue_flush(q, f->fd) == -1) {
+    cx_error(cx, cx->row, cx->col, "Failed writing: %d", errno);
+    return false;
+  }
+
+  // Backpressure is released once the queue is down to half the mark
+  if (q->above && q->len <= q->high/2) {
+    q->above = false;
+    return call_action(q, cx, false);
+  }
+
+  return true;
+}
@@ -0,0 +1,43 @@
+#ifndef CX_WQUEUE_H
+#define CX_WQUEUE_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include "cixl/box.h"
+#include "cixl/vec.h"
+
+#define CX_WQUEUE_CHUNK 4096
+#define CX_WQUEUE_MIN_REF 64
+
+struct cx_file;
+struct cx_poll;
+struct cx_str;
+
+struct cx_wqueue_item {
+  struct cx_str *str;
+  char *data;
+  size_t len, capac;
+};
+
+struct cx_wqueue {
+  struct cx_vec items;
+  size_t head, offs, len, high;
+  bool above;
+  struct cx_box action;
+  struct cx_poll *poll;
+};
+
+struct cx_wqueue *cx_wqueue_new(size_t high, struct cx_box *action);
+void cx_wqueue_free(struct cx_wqueue *q);
+
+bool cx_wqueue_push(struct cx_wqueue *q, const char *data, size_t len);
+bool cx_wqueue_push_str(struct cx_wqueue *q, struct cx_str *s);
+ssize_t cx_wqueue_flush(struct cx_wqueue *q, int fd);
+
+bool cx_file_queue(struct cx_file *f, size_t high, struct cx_box *action);
+bool cx_file_poll(struct cx_file *f, struct cx_poll *p);
+bool cx_file_enqueue(struct cx_file *f, struct cx_box *v, bool print);
+bool cx_file_flush(struct cx_file *f);
+
+#endif
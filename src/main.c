@@ -85,7 +85,7 @@ int main(int argc, char *argv[]) {
 	  }
 	}
 
-	fputs(" -Bdynamic -ldl", cmd.stream);
+	fputs(" -Bdynamic -ldl -lpthread", cmd.stream);
 	for (; argi < argc; argi++) { fprintf(cmd.stream, " %s", argv[argi]); }
 	cx_mfile_close(&cmd);
 